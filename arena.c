@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arena.h"
+
+static __thread arena *active = NULL;
+
+static size_t round_up(size_t bytes) {
+    return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+int arena_init(arena *a, size_t size) {
+    memset(a, 0, sizeof(*a));
+    void *base = NULL;
+    if (posix_memalign(&base, ARENA_ALIGN, size > 0 ? size : ARENA_ALIGN) != 0) {
+        fprintf(stderr, "Error: Could not allocate a %zu-byte arena\n", size);
+        return -1;
+    }
+    memset(base, 0, size);
+    a->base = (unsigned char *)base;
+    a->size = size;
+    return 0;
+}
+
+void arena_init_measure(arena *a) {
+    memset(a, 0, sizeof(*a));
+    a->measuring = 1;
+}
+
+void arena_release(arena *a) {
+    free(a->base);
+    memset(a, 0, sizeof(*a));
+}
+
+arena *arena_enter(arena *a) {
+    arena *previous = active;
+    active = a;
+    return previous;
+}
+
+void *arena_alloc(size_t bytes) {
+    arena *a = active;
+    if (a == NULL) {
+        return malloc(bytes);
+    }
+    size_t need = round_up(bytes > 0 ? bytes : 1);
+    if (a->measuring) {
+        a->used += need;
+        return malloc(bytes);
+    }
+    if (need > a->size - a->used) {
+        return NULL;
+    }
+    void *p = a->base + a->used;
+    a->used += need;
+    return p;
+}
+
+void *arena_calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    arena *a = active;
+    if (a == NULL || a->measuring) {
+        void *p = arena_alloc(count * size);
+        if (p != NULL) {
+            memset(p, 0, count * size);
+        }
+        return p;
+    }
+    return arena_alloc(count * size);
+}
+
+void arena_free(void *p) {
+    arena *a = active;
+    if (a != NULL && a->base != NULL && (unsigned char *)p >= a->base && (unsigned char *)p < a->base + a->size) {
+        return;
+    }
+    free(p);
+}
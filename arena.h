@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64  // every block starts on a cache line (and any SIMD width)
+
+// One aligned block that a filter is built in. Allocation bumps a pointer
+// and nothing is freed until the whole arena is released, so a filter whose
+// allocations all come from an arena costs one malloc and one free however
+// many buffers and FFT plans it has, and nothing it does after it is built
+// can reach the heap.
+//
+// The DSP modules allocate through arena_alloc/arena_free. Those go to the
+// arena the calling thread has entered, and to the heap when there is none,
+// so the modules are unchanged for callers that never use an arena. The size
+// a filter needs is found by building it once in a measuring arena, which
+// takes its memory from the heap and adds up what was asked for.
+typedef struct {
+    unsigned char *base;
+    size_t size;
+    size_t used;
+    int measuring;
+} arena;
+
+// Allocate size bytes, zeroed. Returns 0, or -1 with a message.
+int arena_init(arena *a, size_t size);
+
+// An arena that only counts: used grows by what a real arena would consume
+void arena_init_measure(arena *a);
+
+void arena_release(arena *a);
+
+// Route this thread's arena_alloc calls to a (NULL: the heap). Returns the
+// arena that was active, to enter again when done.
+arena *arena_enter(arena *a);
+
+// NULL when the active arena is full. Memory from a real arena is already
+// zeroed, so arena_calloc costs nothing extra there.
+void *arena_alloc(size_t bytes);
+void *arena_calloc(size_t count, size_t size);
+
+// Free a block from arena_alloc: heap blocks go back to the heap, arena
+// blocks stay until their arena is released
+void arena_free(void *p);
+
+#endif
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "async_io.h"
+#include "thread_pool.h"
+
+#define ASYNC_IO_RING_ENTRIES 8   // submissions are entered one at a time, so a few suffice
+#define ASYNC_IO_WORKERS 2        // thread backend: both halves of a double buffer in flight
+
+// The kernel's rings, mapped from the io_uring file descriptor. Head and
+// tail indices are shared with the kernel and accessed with acquire/release
+// ordering; the masks and array positions are fixed at setup.
+typedef struct {
+    int fd;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+} uring;
+
+struct async_io {
+    async_io_backend backend;
+    uring ring;
+    int inFlight;             // io_uring: requests not yet finished
+
+    thread_pool *pool;        // thread backend
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void uring_unmap(uring *r) {
+    if (r->sqes != NULL) {
+        munmap(r->sqes, r->sqesSize);
+    }
+    if (r->cqRing != NULL && r->cqRing != r->sqRing) {
+        munmap(r->cqRing, r->cqRingSize);
+    }
+    if (r->sqRing != NULL) {
+        munmap(r->sqRing, r->sqRingSize);
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+static int uring_setup(uring *r) {
+    memset(r, 0, sizeof(*r));
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = sys_io_uring_setup(ASYNC_IO_RING_ENTRIES, &p);
+    if (r->fd < 0) {
+        return -1;
+    }
+
+    r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int singleMap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap && r->cqRingSize > r->sqRingSize) {
+        r->sqRingSize = r->cqRingSize;
+    }
+    void *sq = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        uring_unmap(r);
+        return -1;
+    }
+    r->sqRing = sq;
+    void *cq = sq;
+    if (!singleMap) {
+        cq = mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            uring_unmap(r);
+            return -1;
+        }
+    }
+    r->cqRing = cq;
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        uring_unmap(r);
+        return -1;
+    }
+    r->sqes = (struct io_uring_sqe *)sqes;
+
+    unsigned char *s = (unsigned char *)sq;
+    unsigned char *c = (unsigned char *)cq;
+    r->sqHead = (unsigned *)(void *)(s + p.sq_off.head);
+    r->sqTail = (unsigned *)(void *)(s + p.sq_off.tail);
+    r->sqMask = (unsigned *)(void *)(s + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(void *)(s + p.sq_off.array);
+    r->cqHead = (unsigned *)(void *)(c + p.cq_off.head);
+    r->cqTail = (unsigned *)(void *)(c + p.cq_off.tail);
+    r->cqMask = (unsigned *)(void *)(c + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(void *)(c + p.cq_off.cqes);
+    return 0;
+}
+
+int async_io_uring_supported(void) {
+    uring r;
+    if (uring_setup(&r) != 0) {
+        return 0;
+    }
+    uring_unmap(&r);
+    return 1;
+}
+
+// Queue what is left of req and hand it to the kernel
+static int uring_queue(async_io *io, async_io_req *req) {
+    uring *r = &io->ring;
+    unsigned tail = *r->sqTail;
+    unsigned index = tail & *r->sqMask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+
+    req->iov.iov_base = (unsigned char *)req->buf + req->done;
+    req->iov.iov_len = req->len - req->done;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = req->fd;
+    sqe->off = (uint64_t)(req->offset + (off_t)req->done);
+    sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    r->sqArray[index] = index;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int entered;
+    while ((entered = sys_io_uring_enter(r->fd, 1, 0, 0)) < 0 && errno == EINTR) {
+    }
+    return entered < 0 ? -1 : 0;
+}
+
+static void finish(async_io *io, async_io_req *req, int error) {
+    req->error = error;
+    req->finished = 1;
+    io->inFlight--;
+}
+
+// Consume one completion, resubmitting the rest of a short transfer.
+// Returns 0 if the completion queue was empty.
+static int uring_reap(async_io *io) {
+    uring *r = &io->ring;
+    unsigned head = *r->cqHead;
+    if (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    const struct io_uring_cqe *cqe = &r->cqes[head & *r->cqMask];
+    async_io_req *req = (async_io_req *)(uintptr_t)cqe->user_data;
+    int res = cqe->res;
+    __atomic_store_n(r->cqHead, head + 1, __ATOMIC_RELEASE);
+
+    if (res > 0) {
+        req->done += (size_t)res;
+    }
+    if (res < 0 && res != -EINTR && res != -EAGAIN) {
+        finish(io, req, -res);
+    } else if (res == 0 || req->done == req->len) {
+        finish(io, req, 0);  // done, or the end of the file
+    } else if (uring_queue(io, req) != 0) {
+        finish(io, req, errno);
+    }
+    return 1;
+}
+
+static void run_request(void *arg) {
+    async_io_req *req = (async_io_req *)arg;
+    int error = 0;
+    while (req->done < req->len) {
+        void *p = (unsigned char *)req->buf + req->done;
+        size_t left = req->len - req->done;
+        off_t at = req->offset + (off_t)req->done;
+        ssize_t n = req->write ? pwrite(req->fd, p, left, at) : pread(req->fd, p, left, at);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            error = n < 0 ? errno : 0;
+            break;
+        }
+        req->done += (size_t)n;
+    }
+
+    async_io *io = req->owner;
+    pthread_mutex_lock(&io->lock);
+    req->error = error;
+    req->finished = 1;
+    pthread_cond_broadcast(&io->finished);
+    pthread_mutex_unlock(&io->lock);
+}
+
+async_io *async_io_create(async_io_backend backend) {
+    async_io *io = (async_io *)calloc(1, sizeof(async_io));
+    if (io == NULL) {
+        return NULL;
+    }
+    io->backend = backend;
+    io->ring.fd = -1;
+    if (backend == ASYNC_IO_URING) {
+        if (uring_setup(&io->ring) != 0) {
+            free(io);
+            return NULL;
+        }
+        return io;
+    }
+
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->finished, NULL);
+    io->pool = thread_pool_create(ASYNC_IO_WORKERS);
+    if (io->pool == NULL) {
+        async_io_destroy(io);
+        return NULL;
+    }
+    return io;
+}
+
+void async_io_destroy(async_io *io) {
+    if (io == NULL) {
+        return;
+    }
+    if (io->backend == ASYNC_IO_URING) {
+        // The kernel may still be filling buffers the caller is about to free
+        while (io->inFlight > 0) {
+            if (!uring_reap(io) && sys_io_uring_enter(io->ring.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                break;
+            }
+        }
+        uring_unmap(&io->ring);
+    } else {
+        thread_pool_destroy(io->pool);  // runs what is still queued
+        pthread_cond_destroy(&io->finished);
+        pthread_mutex_destroy(&io->lock);
+    }
+    free(io);
+}
+
+int async_io_submit(async_io *io, async_io_req *req) {
+    req->done = 0;
+    req->error = 0;
+    req->finished = 0;
+    req->owner = io;
+    if (io->backend == ASYNC_IO_URING) {
+        if (uring_queue(io, req) != 0) {
+            return -1;
+        }
+        io->inFlight++;
+        return 0;
+    }
+    return thread_pool_submit(io->pool, run_request, req);
+}
+
+ssize_t async_io_wait(async_io *io, async_io_req *req) {
+    if (io->backend == ASYNC_IO_URING) {
+        while (!req->finished) {
+            if (uring_reap(io)) {
+                continue;
+            }
+            if (sys_io_uring_enter(io->ring.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                finish(io, req, errno);  // the ring itself failed; give up on the request
+            }
+        }
+    } else {
+        pthread_mutex_lock(&io->lock);
+        while (!req->finished) {
+            pthread_cond_wait(&io->finished, &io->lock);
+        }
+        pthread_mutex_unlock(&io->lock);
+    }
+    return req->error != 0 ? -1 : (ssize_t)req->done;
+}
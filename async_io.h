@@ -0,0 +1,53 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Positioned reads and writes that run while the caller keeps computing.
+// The io_uring backend drives the kernel rings through the raw system calls
+// (no liburing); where io_uring is missing or disabled the same requests run
+// as pread/pwrite jobs on a thread pool. One async_io belongs to one thread.
+
+typedef enum {
+    ASYNC_IO_URING,
+    ASYNC_IO_THREADS
+} async_io_backend;
+
+typedef struct async_io async_io;
+
+// One transfer, owned by the caller; it must stay put until waited for
+typedef struct {
+    int fd;
+    void *buf;
+    size_t len;
+    off_t offset;
+    int write;
+
+    // Completion, filled in by the backend
+    size_t done;          // bytes transferred so far
+    int error;            // errno of a failed transfer, 0 otherwise
+    int finished;
+    struct iovec iov;     // the io_uring backend's view of the remainder
+    async_io *owner;
+} async_io_req;
+
+// 1 if this kernel lets the process set up an io_uring
+int async_io_uring_supported(void);
+
+// NULL if the backend cannot be started
+async_io *async_io_create(async_io_backend backend);
+
+// Waits for every request still in flight
+void async_io_destroy(async_io *io);
+
+// Start moving req->len bytes between req->buf and req->fd at req->offset.
+// Returns 0, or -1 if the request could not be queued.
+int async_io_submit(async_io *io, async_io_req *req);
+
+// Block until req has finished. Returns the bytes transferred, which fall
+// short of req->len only at the end of the file, or -1 with req->error set.
+ssize_t async_io_wait(async_io *io, async_io_req *req);
+
+#endif
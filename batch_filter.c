@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "wav_processor.h"
+
+// The engine one worker keeps for the whole batch. It is rebuilt only when
+// a file has a different sample rate or channel count.
+typedef struct {
+    eq_engine *engine;
+} batch_worker;
+
+typedef struct {
+    const filter_options *opts;
+    thread_pool *pool;
+    batch_worker *workers;  // one per pool worker, plus one for the caller
+    int numWorkers;
+} batch_state;
+
+typedef struct {
+    batch_state *batch;
+    const char *input;
+    char *output;       // outputDir/basename(input)
+    int status;
+    sf_count_t frames;
+    int sampleRate;
+} batch_item;
+
+static void batch_worker_free(batch_worker *w) {
+    eq_engine_destroy(w->engine);
+    w->engine = NULL;
+}
+
+// Make w ready for a stream with this layout, reusing whatever it already has
+static int batch_worker_prepare(batch_worker *w, const filter_options *opts, int sampleRate, int channels) {
+    eq_engine *e = w->engine;
+    if (e != NULL && eq_engine_sample_rate(e) == sampleRate && eq_engine_channels(e) == channels) {
+        eq_engine_reset(e);
+        return 0;
+    }
+    batch_worker_free(w);
+    w->engine = eq_engine_create(sampleRate, channels, opts, NULL);
+    return w->engine != NULL ? 0 : -1;
+}
+
+static void run_batch_item(void *arg) {
+    batch_item *item = (batch_item *)arg;
+    batch_state *batch = item->batch;
+    int index = thread_pool_worker_index(batch->pool);
+    batch_worker *w = &batch->workers[index >= 0 ? index : batch->numWorkers - 1];
+
+    item->status = -1;
+    wav_reader in;
+    if (wav_reader_open(&in, item->input) != 0) {
+        return;
+    }
+    int channels = in.info.channels;
+    int sampleRate = in.info.samplerate;
+
+    wav_writer out;
+    int outOpen = wav_writer_open(&out, item->output, sampleRate, channels, in.info.frames, &in) == 0;
+
+    if (outOpen && batch_worker_prepare(w, batch->opts, sampleRate, channels) == 0) {
+        item->status = stream_filter_engine(&in, &out, w->engine);
+        item->frames = in.info.frames;
+        item->sampleRate = sampleRate;
+    }
+    if (outOpen && wav_writer_close(&out) != 0) {
+        item->status = -1;
+    }
+    if (item->status != 0) {
+        fprintf(stderr, "Error: Failed to filter '%s'\n", item->input);
+    }
+
+    wav_reader_close(&in);
+}
+
+static int has_wav_extension(const char *name) {
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".wav") == 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int add_path(char ***paths, int *count, int *capacity, const char *dir, const char *name) {
+    if (*count == *capacity) {
+        int grown = *capacity > 0 ? *capacity * 2 : 64;
+        char **more = (char **)realloc(*paths, sizeof(char *) * grown);
+        if (more == NULL) {
+            return -1;
+        }
+        *paths = more;
+        *capacity = grown;
+    }
+    size_t len = (dir != NULL ? strlen(dir) + 1 : 0) + strlen(name) + 1;
+    char *path = (char *)malloc(len);
+    if (path == NULL) {
+        return -1;
+    }
+    if (dir != NULL) {
+        snprintf(path, len, "%s/%s", dir, name);
+    } else {
+        snprintf(path, len, "%s", name);
+    }
+    (*paths)[(*count)++] = path;
+    return 0;
+}
+
+// The .wav files of a directory in name order, or the lines of a list file
+static int list_inputs(const char *input, char ***paths, int *count) {
+    int capacity = 0;
+    int status = 0;
+    *paths = NULL;
+    *count = 0;
+
+    struct stat info;
+    if (stat(input, &info) != 0) {
+        fprintf(stderr, "Error: Could not open batch input '%s'\n", input);
+        return -1;
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+        DIR *dir = opendir(input);
+        if (dir == NULL) {
+            fprintf(stderr, "Error: Could not open directory '%s'\n", input);
+            return -1;
+        }
+        struct dirent *entry;
+        while (status == 0 && (entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.' && has_wav_extension(entry->d_name)) {
+                status = add_path(paths, count, &capacity, input, entry->d_name);
+            }
+        }
+        closedir(dir);
+        qsort(*paths, *count, sizeof(char *), compare_paths);
+    } else {
+        // One path per line; blank lines and "#" comments are skipped
+        FILE *f = fopen(input, "r");
+        if (f == NULL) {
+            fprintf(stderr, "Error: Could not open file list '%s'\n", input);
+            return -1;
+        }
+        char line[4096];
+        while (status == 0 && fgets(line, sizeof(line), f) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0' && line[0] != '#') {
+                status = add_path(paths, count, &capacity, NULL, line);
+            }
+        }
+        fclose(f);
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    }
+    return status;
+}
+
+static char *output_path(const char *outputDir, const char *input) {
+    const char *slash = strrchr(input, '/');
+    const char *name = slash != NULL ? slash + 1 : input;
+    size_t len = strlen(outputDir) + strlen(name) + 2;
+    char *path = (char *)malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%s", outputDir, name);
+    }
+    return path;
+}
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    int index;
+} file_id;
+
+static int compare_ids(const void *a, const void *b) {
+    const file_id *x = (const file_id *)a, *y = (const file_id *)b;
+    if (x->dev != y->dev) {
+        return x->dev < y->dev ? -1 : 1;
+    }
+    return x->ino < y->ino ? -1 : x->ino > y->ino;
+}
+
+static int compare_outputs(const void *a, const void *b) {
+    const batch_item *x = *(const batch_item *const *)a, *y = *(const batch_item *const *)b;
+    int c = strcmp(x->output, y->output);
+    return c != 0 ? c : (x < y ? -1 : x > y);
+}
+
+// Every file is written in place, truncated first, so two inputs with the
+// same name would overwrite each other and an output that is an input
+// would be destroyed before it is read. Returns -1 with a message for each.
+static int check_outputs(batch_item *items, int count) {
+    batch_item **byOutput = (batch_item **)calloc(count, sizeof(batch_item *));
+    file_id *ids = (file_id *)calloc(count, sizeof(file_id));
+    if (byOutput == NULL || ids == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(byOutput);
+        free(ids);
+        return -1;
+    }
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        byOutput[i] = &items[i];
+    }
+    qsort(byOutput, count, sizeof(batch_item *), compare_outputs);
+    for (int i = 1; i < count; i++) {
+        if (strcmp(byOutput[i]->output, byOutput[i - 1]->output) == 0) {
+            fprintf(stderr, "Error: '%s' and '%s' would both be written to '%s'\n", byOutput[i - 1]->input,
+                    byOutput[i]->input, byOutput[i]->output);
+            status = -1;
+        }
+    }
+
+    // An input that cannot be stat'ed fails on its own when it is opened
+    int numIds = 0;
+    for (int i = 0; i < count; i++) {
+        struct stat info;
+        if (stat(items[i].input, &info) == 0) {
+            ids[numIds++] = (file_id){info.st_dev, info.st_ino, i};
+        }
+    }
+    qsort(ids, numIds, sizeof(file_id), compare_ids);
+    for (int i = 0; i < count; i++) {
+        struct stat info;
+        if (stat(items[i].output, &info) != 0) {
+            continue;  // not there yet, so not an input either
+        }
+        file_id key = {info.st_dev, info.st_ino, 0};
+        const file_id *hit = (const file_id *)bsearch(&key, ids, numIds, sizeof(file_id), compare_ids);
+        if (hit != NULL) {
+            fprintf(stderr, "Error: Output '%s' for '%s' is the input '%s'\n", items[i].output, items[i].input,
+                    items[hit->index].input);
+            status = -1;
+        }
+    }
+    free(byOutput);
+    free(ids);
+    return status;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void batch_free(batch_state *batch, batch_item *items, char **paths, int count) {
+    for (int w = 0; w < batch->numWorkers; w++) {
+        batch_worker_free(&batch->workers[w]);
+    }
+    free(batch->workers);
+    for (int i = 0; i < count; i++) {
+        free(items[i].output);
+        free(paths[i]);
+    }
+    free(items);
+    free(paths);
+}
+
+int batch_filter(const char *input, const char *outputDir, const filter_options *opts, thread_pool *pool) {
+    char **paths;
+    int count;
+    if (list_inputs(input, &paths, &count) != 0) {
+        for (int i = 0; i < count; i++) {
+            free(paths[i]);
+        }
+        free(paths);
+        return -1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "Warning: No input files in '%s'\n", input);
+        free(paths);
+        return 0;
+    }
+
+    batch_state batch;
+    batch.opts = opts;
+    batch.pool = pool;
+    batch.numWorkers = (pool != NULL ? thread_pool_size(pool) : 0) + 1;
+    batch.workers = (batch_worker *)calloc(batch.numWorkers, sizeof(batch_worker));
+    batch_item *items = (batch_item *)calloc(count, sizeof(batch_item));
+    if (batch.workers == NULL || items == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(batch.workers);
+        free(items);
+        for (int i = 0; i < count; i++) {
+            free(paths[i]);
+        }
+        free(paths);
+        return -1;
+    }
+
+    int status = 0;
+    for (int i = 0; status == 0 && i < count; i++) {
+        items[i].batch = &batch;
+        items[i].input = paths[i];
+        items[i].output = output_path(outputDir, paths[i]);
+        if (items[i].output == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+            status = -1;
+        }
+    }
+    if (status == 0) {
+        status = check_outputs(items, count);
+    }
+    if (status != 0) {
+        batch_free(&batch, items, paths, count);
+        return -1;
+    }
+
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        if (pool == NULL || thread_pool_submit(pool, run_batch_item, &items[i]) != 0) {
+            run_batch_item(&items[i]);
+        }
+    }
+    if (pool != NULL) {
+        thread_pool_wait(pool);
+    }
+    double elapsed = now_seconds() - start;
+
+    int failed = 0;
+    double audioSeconds = 0.0;
+    for (int i = 0; i < count; i++) {
+        if (items[i].status != 0) {
+            failed++;
+        } else if (items[i].sampleRate > 0) {
+            audioSeconds += (double)items[i].frames / items[i].sampleRate;
+        }
+    }
+    if (elapsed <= 0.0) {
+        elapsed = 1e-9;
+    }
+    fprintf(stderr, "Batch: %d file(s), %d failed, %.1f s of audio in %.3f s: %.1f files/s, %.1fx realtime\n",
+            count, failed, audioSeconds, elapsed, (count - failed) / elapsed, audioSeconds / elapsed);
+
+    batch_free(&batch, items, paths, count);
+    return failed == 0 ? 0 : -1;
+}
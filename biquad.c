@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "biquad.h"
+#include "stats.h"
+#include "arena.h"
+
+// The edge steps must round like the kernels, which never fuse
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+void biquad_free(biquad_state *st) {
+    stats_memory(-(long long)st->bufferBytes);
+    arena_free(st->coef);
+    arena_free(st->state);
+    arena_free(st->coef64);
+    arena_free(st->state64);
+    arena_free(st->scratch);
+    memset(st, 0, sizeof(*st));
+}
+
+int biquad_init(biquad_state *st, const eq_preset *eq, int sampleRate, int precision) {
+    memset(st, 0, sizeof(*st));
+    if (precision != 32 && precision != 64) {
+        fprintf(stderr, "Error: Biquad precision must be 32 or 64 bits, got %d\n", precision);
+        return -1;
+    }
+    st->precision = precision;
+    st->lanes = precision == 32 ? BIQUAD_LANES : BIQUAD_LANES_F64;
+    int sections = eq->numBands > 0 ? eq->numBands : 1;  // a lone preamp still needs one
+    st->numGroups = (sections + st->lanes - 1) / st->lanes;
+
+    size_t coefs = (size_t)st->numGroups * 5 * st->lanes;
+    size_t states = (size_t)st->numGroups * 3 * st->lanes;
+    double *design = (double *)arena_alloc(sizeof(double) * coefs);
+    if (precision == 32) {
+        st->coef = (float *)arena_alloc(sizeof(float) * coefs);
+        st->state = (float *)arena_calloc(states, sizeof(float));
+        st->bufferBytes = sizeof(float) * (coefs + states);
+    } else {
+        st->coef64 = (double *)arena_alloc(sizeof(double) * coefs);
+        st->state64 = (double *)arena_calloc(states, sizeof(double));
+        st->scratch = (double *)arena_alloc(sizeof(double) * BIQUAD_CHUNK);
+        st->bufferBytes = sizeof(double) * (coefs + states + BIQUAD_CHUNK);
+    }
+    if (design == NULL || (precision == 32 ? st->coef == NULL || st->state == NULL
+                                           : st->coef64 == NULL || st->state64 == NULL || st->scratch == NULL)) {
+        fprintf(stderr, "Error: Failed to allocate memory for biquad buffers.\n");
+        arena_free(design);
+        st->bufferBytes = 0;
+        biquad_free(st);
+        return -1;
+    }
+    stats_memory((long long)st->bufferBytes);
+
+    // Section s is lane s % lanes of group s / lanes; unused lanes pass
+    // their input through (b0 = 1, everything else 0)
+    memset(design, 0, sizeof(double) * coefs);
+    double preamp = pow(10.0, eq->preampDb / 20.0);
+    for (int s = 0; s < st->numGroups * st->lanes; s++) {
+        double *c = design + (size_t)(s / st->lanes) * 5 * st->lanes + s % st->lanes;
+        eq_biquad bq = {1.0, 0.0, 0.0, 0.0, 0.0};
+        if (s < eq->numBands) {
+            eq_band_design(&eq->bands[s], sampleRate, &bq);
+        }
+        double gain = s == 0 ? preamp : 1.0;
+        c[0] = bq.b0 * gain;
+        c[st->lanes] = bq.b1 * gain;
+        c[2 * st->lanes] = bq.b2 * gain;
+        c[3 * st->lanes] = bq.a1;
+        c[4 * st->lanes] = bq.a2;
+    }
+    for (size_t i = 0; i < coefs; i++) {
+        if (precision == 32) {
+            st->coef[i] = (float)design[i];
+        } else {
+            st->coef64[i] = design[i];
+        }
+    }
+    arena_free(design);
+    st->kern = dsp_kernels_get();
+    return 0;
+}
+
+void biquad_reset(biquad_state *st) {
+    size_t states = (size_t)st->numGroups * 3 * st->lanes;
+    if (st->precision == 32) {
+        memset(st->state, 0, sizeof(float) * states);
+    } else {
+        memset(st->state64, 0, sizeof(double) * states);
+    }
+}
+
+// Wavefront steps [from, to) of a pass over n samples in which only some
+// sections have a sample: section b works on sample t - b while that lies
+// in [0, n). Same arithmetic and order as the biquad kernels.
+static void edge_steps(const float *coef, float *state, int lanes, const float *in, float *out, int n, int from, int to) {
+    const float *b0 = coef, *b1 = coef + lanes, *b2 = coef + 2 * lanes, *a1 = coef + 3 * lanes, *a2 = coef + 4 * lanes;
+    float *y = state, *s1 = state + lanes, *s2 = state + 2 * lanes;
+    for (int t = from; t < to; t++) {
+        int lo = t - n + 1 > 0 ? t - n + 1 : 0;
+        int hi = t < lanes - 1 ? t : lanes - 1;
+        for (int b = hi; b >= lo; b--) {
+            float x = b > 0 ? y[b - 1] : in[t];
+            float v = b0[b] * x + s1[b];
+            s1[b] = b1[b] * x - a1[b] * v + s2[b];
+            s2[b] = b2[b] * x - a2[b] * v;
+            y[b] = v;
+        }
+        if (hi == lanes - 1 && lo <= hi) {
+            out[t - (lanes - 1)] = y[lanes - 1];
+        }
+    }
+}
+
+static void edge_steps_f64(const double *coef, double *state, int lanes, const double *in, double *out, int n, int from, int to) {
+    const double *b0 = coef, *b1 = coef + lanes, *b2 = coef + 2 * lanes, *a1 = coef + 3 * lanes, *a2 = coef + 4 * lanes;
+    double *y = state, *s1 = state + lanes, *s2 = state + 2 * lanes;
+    for (int t = from; t < to; t++) {
+        int lo = t - n + 1 > 0 ? t - n + 1 : 0;
+        int hi = t < lanes - 1 ? t : lanes - 1;
+        for (int b = hi; b >= lo; b--) {
+            double x = b > 0 ? y[b - 1] : in[t];
+            double v = b0[b] * x + s1[b];
+            s1[b] = b1[b] * x - a1[b] * v + s2[b];
+            s2[b] = b2[b] * x - a2[b] * v;
+            y[b] = v;
+        }
+        if (hi == lanes - 1 && lo <= hi) {
+            out[t - (lanes - 1)] = y[lanes - 1];
+        }
+    }
+}
+
+// One group over n samples, in to out (which may be in): the wavefront
+// fills for lanes - 1 steps, runs full in the kernel, then drains, so the
+// group's state afterwards is as if each sample had gone through alone
+static void run_group(const biquad_state *st, int g, const float *in, float *out, int n) {
+    int lanes = st->lanes;
+    const float *coef = st->coef + (size_t)g * 5 * lanes;
+    float *state = st->state + (size_t)g * 3 * lanes;
+    int steps = n + lanes - 1;
+    if (n >= lanes) {
+        edge_steps(coef, state, lanes, in, out, n, 0, lanes - 1);
+        st->kern->biquad(coef, state, in + lanes - 1, out, n - lanes + 1);
+        edge_steps(coef, state, lanes, in, out, n, n, steps);
+    } else {
+        edge_steps(coef, state, lanes, in, out, n, 0, steps);
+    }
+}
+
+static void run_group_f64(const biquad_state *st, int g, double *buf, int n) {
+    int lanes = st->lanes;
+    const double *coef = st->coef64 + (size_t)g * 5 * lanes;
+    double *state = st->state64 + (size_t)g * 3 * lanes;
+    int steps = n + lanes - 1;
+    if (n >= lanes) {
+        edge_steps_f64(coef, state, lanes, buf, buf, n, 0, lanes - 1);
+        st->kern->biquad_f64(coef, state, buf + lanes - 1, buf, n - lanes + 1);
+        edge_steps_f64(coef, state, lanes, buf, buf, n, n, steps);
+    } else {
+        edge_steps_f64(coef, state, lanes, buf, buf, n, 0, steps);
+    }
+}
+
+void biquad_process(biquad_state *st, const float *in, float *out, int count) {
+    uint64_t t = stats_begin();
+    if (st->precision == 32) {
+        for (int g = 0; g < st->numGroups; g++) {
+            run_group(st, g, g == 0 ? in : out, out, count);
+        }
+    } else {
+        for (int pos = 0; pos < count; pos += BIQUAD_CHUNK) {
+            int n = count - pos < BIQUAD_CHUNK ? count - pos : BIQUAD_CHUNK;
+            for (int i = 0; i < n; i++) {
+                st->scratch[i] = in[pos + i];
+            }
+            for (int g = 0; g < st->numGroups; g++) {
+                run_group_f64(st, g, st->scratch, n);
+            }
+            for (int i = 0; i < n; i++) {
+                out[pos + i] = (float)st->scratch[i];
+            }
+        }
+    }
+    stats_lap(STATS_FILTER, t);
+}
@@ -0,0 +1,46 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stddef.h>
+#include "eq.h"
+#include "dsp_kernels.h"
+
+#define BIQUAD_CHUNK 256  // samples converted to double at a time
+
+// The EQ bands as a cascade of IIR biquads (eq_band_design) in transposed
+// direct form II, one section per band with the preamp folded into the
+// first. Filtering is sample by sample: there is no frame and no lookahead,
+// so every input sample's output is ready when the call returns and the
+// filter adds no latency. Arithmetic is float or double throughout.
+//
+// A cascade is serial within a sample, so the sections run as a wavefront
+// instead (dsp_kernels biquad): section b filters sample t - b while section
+// 0 takes sample t, and a group of BIQUAD_LANES sections (BIQUAD_LANES_F64
+// in double) advances together in one SIMD register per coefficient.
+// Groups are padded with pass-through sections and run one after another.
+// The few steps at each end of a call where the wavefront is filling or
+// draining run in scalar code of the same arithmetic.
+typedef struct {
+    int precision;         // 32 or 64
+    int lanes;             // sections per group
+    int numGroups;
+    float *coef;           // float: per group b0, b1, b2, a1, a2, lanes entries each
+    float *state;          // float: per group y, s1, s2
+    double *coef64;        // the same in double precision
+    double *state64;
+    double *scratch;       // double: BIQUAD_CHUNK samples in flight
+    const dsp_kernels *kern;
+    size_t bufferBytes;    // heap buffers above, for the stats report
+} biquad_state;
+
+// precision is 32 (float) or 64 (double)
+int biquad_init(biquad_state *st, const eq_preset *eq, int sampleRate, int precision);
+void biquad_free(biquad_state *st);
+
+// Clear the filter memory so a new stream can start
+void biquad_reset(biquad_state *st);
+
+// Filter count samples; out may be in
+void biquad_process(biquad_state *st, const float *in, float *out, int count);
+
+#endif
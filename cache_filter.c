@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wav_processor.h"
+#include "spectrum_cache.h"
+
+// One channel's view of the cache, passed to its STFT hooks. Blocks arrive
+// in order; count is how many did, so a stream of the wrong length (a WAV
+// header that disagrees with the data) is caught instead of overrunning.
+typedef struct {
+    spectrum_cache *cache;
+    int channel;
+    long long count;
+} cache_channel;
+
+static void record_tap(void *ctx, long long block, fft_cpx *spectrum, int numBins) {
+    (void)numBins;
+    cache_channel *cc = (cache_channel *)ctx;
+    if (block < cc->cache->key.numBlocks) {
+        spectrum_cache_store(cc->cache, cc->channel, block, spectrum);
+    }
+    cc->count++;
+}
+
+static void replay_source(void *ctx, long long block, fft_cpx *spectrum, int numBins) {
+    cache_channel *cc = (cache_channel *)ctx;
+    if (block < cc->cache->key.numBlocks) {
+        spectrum_cache_load(cc->cache, cc->channel, block, spectrum);
+    } else {
+        memset(spectrum, 0, sizeof(fft_cpx) * numBins);
+    }
+    cc->count++;
+}
+
+// The cached spectra stand in for the input: the filters are pushed silence
+// of the input's length, which only drives the block schedule, and every
+// block takes its spectrum from the cache
+static int replay(const wav_reader *in, wav_writer *out, eq_engine *e) {
+    float *const *inPlanes = eq_engine_input(e);
+    for (int c = 0; c < in->info.channels; c++) {
+        memset(inPlanes[c], 0, sizeof(float) * STREAM_CHUNK_FRAMES);
+    }
+
+    int status = 0;
+    for (sf_count_t left = in->info.frames; status == 0 && left > 0;) {
+        int frames = left < STREAM_CHUNK_FRAMES ? (int)left : STREAM_CHUNK_FRAMES;
+        status = eq_engine_run(e, frames, wav_writer_sink, out);
+        left -= frames;
+    }
+    if (status == 0) {
+        status = eq_engine_flush(e, wav_writer_sink, out);
+    }
+    return status;
+}
+
+int cache_filter(const char *inputFile, wav_reader *in, wav_writer *out, const filter_options *opts,
+                 const char *cachePath, int precision, thread_pool *pool) {
+    int channels = in->info.channels;
+    if (in->info.frames <= 0) {
+        fprintf(stderr, "Warning: Input length unknown; filtering without the spectrum cache\n");
+        return stream_filter(in, out, opts, pool);
+    }
+
+    spectrum_cache_key key;
+    memset(&key, 0, sizeof(key));
+    if (spectrum_cache_hash_file(inputFile, &key.inputHash, &key.inputBytes) != 0) {
+        return -1;
+    }
+    key.sampleRate = in->info.samplerate;
+    key.channels = channels;
+    key.precision = precision;
+    key.stft = opts->stft;
+    key.numBlocks = stft_block_count(&opts->stft, in->info.frames);
+
+    spectrum_cache cache;
+    const char *why = NULL;
+    int replaying = spectrum_cache_open(&cache, cachePath, &key, &why) == 0;
+    if (!replaying && spectrum_cache_create(&cache, cachePath, &key) != 0) {
+        fprintf(stderr, "Warning: Filtering without the spectrum cache\n");
+        return stream_filter(in, out, opts, pool);
+    }
+
+    eq_engine *e = eq_engine_create(in->info.samplerate, channels, opts, pool);
+    cache_channel *views = (cache_channel *)calloc(channels, sizeof(cache_channel));
+    int status = e != NULL && views != NULL ? 0 : -1;
+    if (e != NULL && views == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    }
+    for (int c = 0; status == 0 && c < channels; c++) {
+        views[c].cache = &cache;
+        views[c].channel = c;
+        stft_state *st = &eq_engine_channel(e, c)->st;
+        st->spectrumCtx = &views[c];
+        if (replaying) {
+            st->source = replay_source;
+        } else {
+            st->tap = record_tap;
+        }
+    }
+
+    if (status == 0) {
+        status = replaying ? replay(in, out, e) : stream_filter_engine(in, out, e);
+    }
+    for (int c = 0; status == 0 && c < channels; c++) {
+        if (views[c].count != key.numBlocks) {
+            fprintf(stderr, "Error: Spectrum cache expected %lld blocks per channel but %lld ran\n",
+                    key.numBlocks, views[c].count);
+            status = -1;
+        }
+    }
+
+    double megabytes = cache.mapSize / 1e6;
+    if (replaying) {
+        fprintf(stderr, "Spectrum cache: replayed %lld blocks per channel from %s\n", key.numBlocks, cachePath);
+        spectrum_cache_close(&cache);
+    } else if (status == 0 && spectrum_cache_commit(&cache) == 0) {
+        fprintf(stderr, "Spectrum cache: %s; saved %s (%.1f MB, %d-bit)\n", why, cachePath, megabytes, precision);
+    } else {
+        spectrum_cache_close(&cache);
+    }
+
+    eq_engine_destroy(e);
+    free(views);
+    return status;
+}
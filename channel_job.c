@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "channel_job.h"
+#include "arena.h"
+#include "stats.h"
+
+void filter_options_default(filter_options *opts) {
+    stft_config_default(&opts->stft);
+    eq_preset_default(&opts->eq);
+    opts->useComplexFft = 0;
+    opts->fixedPoint = 0;
+    opts->lowLatency = 0;
+    opts->iir = 0;
+    opts->blockSize = 128;
+    opts->taps = 8192;
+}
+
+static int channel_sink(void *ctx, const float *samples, int count) {
+    channel_job *job = (channel_job *)ctx;
+    memcpy(job->out + job->outCount, samples, count * sizeof(float));
+    job->outCount += count;
+    return 0;
+}
+
+// The fixed-point filter's samples go back to float scaled by 1/32767, the
+// inverse of the PCM16 conversion on output, so a PCM16 file gets exactly
+// the integers the filter produced
+static int channel_sink_fixed(void *ctx, const int16_t *samples, int count) {
+    channel_job *job = (channel_job *)ctx;
+    float *out = job->out + job->outCount;
+    for (int i = 0; i < count; i++) {
+        out[i] = samples[i] * (1.0f / 32767.0f);
+    }
+    job->outCount += count;
+    return 0;
+}
+
+// Float to Q15: exact for samples read from PCM16, saturated otherwise
+static void to_q15(int16_t *dst, const float *src, int n) {
+    for (int i = 0; i < n; i++) {
+        float v = rintf(src[i] * 32768.0f);
+        dst[i] = (int16_t)(v > 32767.0f ? 32767.0f : v < -32768.0f ? -32768.0f : v);
+    }
+}
+
+int channel_job_init(channel_job *job, const filter_options *opts, int sampleRate) {
+    memset(job, 0, sizeof(*job));
+    job->iir = opts->iir;
+    job->lowLatency = opts->lowLatency && !opts->iir;
+    job->fixedPoint = opts->fixedPoint && !opts->lowLatency && !opts->iir;
+    int maxBlock;
+    if (job->iir) {
+        if (biquad_init(&job->bq, &opts->eq, sampleRate, opts->iir) != 0) {
+            return -1;
+        }
+        maxBlock = 0;  // one sample out for every sample in
+    } else if (job->lowLatency) {
+        // The EQ as an FIR: its impulse response truncated to opts->taps
+        float *ir = (float *)arena_alloc(sizeof(float) * opts->taps);
+        if (ir == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+            return -1;
+        }
+        eq_impulse_response(&opts->eq, sampleRate, ir, opts->taps);
+        int status = pfconv_init(&job->conv, ir, opts->taps, opts->blockSize);
+        arena_free(ir);
+        if (status != 0) {
+            return -1;
+        }
+        maxBlock = opts->blockSize;
+    } else if (job->fixedPoint) {
+        if (stft_fixed_init(&job->fst, &opts->stft, sampleRate, &opts->eq) != 0) {
+            return -1;
+        }
+        maxBlock = opts->stft.frameSize;
+        // Also holds the priming history, which is shorter than a frame
+        job->fixedIn = (int16_t *)arena_alloc(sizeof(int16_t) * (STREAM_CHUNK_FRAMES + maxBlock));
+    } else {
+        if (stft_init(&job->st, &opts->stft, sampleRate, &opts->eq, opts->useComplexFft) != 0) {
+            return -1;
+        }
+        maxBlock = opts->stft.frameSize;
+    }
+    job->in = (float *)arena_alloc(sizeof(float) * STREAM_CHUNK_FRAMES);
+    job->out = (float *)arena_alloc(sizeof(float) * (STREAM_CHUNK_FRAMES + maxBlock));
+    if (job->in == NULL || job->out == NULL || (job->fixedPoint && job->fixedIn == NULL)) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        channel_job_free(job);
+        return -1;
+    }
+    stats_memory((long long)(sizeof(float) * (2 * STREAM_CHUNK_FRAMES + maxBlock)));
+    return 0;
+}
+
+void channel_job_free(channel_job *job) {
+    if (job->in != NULL && job->out != NULL) {
+        stats_memory(-(long long)(sizeof(float) * (STREAM_CHUNK_FRAMES + channel_job_max_output(job))));
+    }
+    if (job->iir) {
+        biquad_free(&job->bq);
+    } else if (job->lowLatency) {
+        pfconv_free(&job->conv);
+    } else if (job->fixedPoint) {
+        stft_fixed_free(&job->fst);
+    } else {
+        stft_free(&job->st);
+    }
+    arena_free(job->in);
+    arena_free(job->out);
+    arena_free(job->fixedIn);
+    job->in = NULL;
+    job->out = NULL;
+    job->fixedIn = NULL;
+}
+
+int channel_job_max_output(const channel_job *job) {
+    int maxBlock = job->iir ? 0 : job->lowLatency ? job->conv.blockSize
+                 : job->fixedPoint ? job->fst.cfg.frameSize : job->st.cfg.frameSize;
+    return STREAM_CHUNK_FRAMES + maxBlock;
+}
+
+void channel_job_reset(channel_job *job) {
+    if (job->iir) {
+        biquad_reset(&job->bq);
+    } else if (job->lowLatency) {
+        pfconv_reset(&job->conv);
+    } else if (job->fixedPoint) {
+        stft_fixed_reset(&job->fst);
+    } else {
+        stft_reset(&job->st);
+    }
+    job->inCount = 0;
+    job->outCount = 0;
+    job->flush = 0;
+    job->status = 0;
+}
+
+void channel_job_prime(channel_job *job, const float *history) {
+    if (job->fixedPoint) {
+        to_q15(job->fixedIn, history, job->fst.cfg.frameSize - job->fst.cfg.hopSize);
+        stft_fixed_prime(&job->fst, job->fixedIn);
+    } else {
+        stft_prime(&job->st, history);
+    }
+}
+
+void run_channel_job(void *arg) {
+    channel_job *job = (channel_job *)arg;
+    job->outCount = 0;
+    if (job->iir) {
+        // Nothing is held back, so the end of the stream has no tail to run
+        if (!job->flush) {
+            biquad_process(&job->bq, job->in, job->out, job->inCount);
+            job->outCount = job->inCount;
+        }
+        job->status = 0;
+    } else if (job->lowLatency) {
+        if (job->flush) {
+            job->status = pfconv_flush(&job->conv, channel_sink, job);
+        } else {
+            job->status = pfconv_push(&job->conv, job->in, job->inCount, channel_sink, job);
+        }
+    } else if (job->fixedPoint) {
+        if (job->flush) {
+            job->status = stft_fixed_flush(&job->fst, channel_sink_fixed, job);
+        } else {
+            to_q15(job->fixedIn, job->in, job->inCount);
+            job->status = stft_fixed_push(&job->fst, job->fixedIn, job->inCount, channel_sink_fixed, job);
+        }
+    } else if (job->flush) {
+        job->status = stft_flush(&job->st, channel_sink, job);
+    } else {
+        job->status = stft_push(&job->st, job->in, job->inCount, channel_sink, job);
+    }
+}
+
+int channel_jobs_run(channel_job *jobs, int channels, thread_pool *pool) {
+    if (pool != NULL) {
+        for (int c = 0; c < channels; c++) {
+            thread_pool_submit_job(pool, &jobs[c].node, run_channel_job, &jobs[c]);
+        }
+        thread_pool_wait(pool);
+    } else {
+        for (int c = 0; c < channels; c++) {
+            run_channel_job(&jobs[c]);
+        }
+    }
+
+    // Every channel has the same configuration and input length, so they
+    // all emit the same number of samples
+    for (int c = 0; c < channels; c++) {
+        if (jobs[c].status != 0 || jobs[c].outCount != jobs[0].outCount) {
+            fprintf(stderr, "Error: Channel %d failed to filter its block\n", c);
+            return -1;
+        }
+    }
+    return jobs[0].outCount;
+}
@@ -0,0 +1,71 @@
+#ifndef CHANNEL_JOB_H
+#define CHANNEL_JOB_H
+
+#include "stft.h"
+#include "stft_fixed.h"
+#include "eq.h"
+#include "pfconv.h"
+#include "biquad.h"
+#include "thread_pool.h"
+
+#define STREAM_CHUNK_FRAMES 4096  // frames per channel in one filter step
+
+// Everything the command line controls about the filter
+typedef struct {
+    stft_config stft;
+    eq_preset eq;
+    int useComplexFft;
+    int fixedPoint;  // integer STFT filter (stft_fixed.h) instead of the float one
+    int lowLatency;  // partitioned convolution instead of the STFT filter
+    int iir;         // biquad cascade (biquad.h) in 32- or 64-bit floats instead; 0 for off
+    int blockSize;   // low-latency block size
+    int taps;        // low-latency FIR length
+} filter_options;
+
+// The command-line defaults: 1024-point Hamming/rect STFT with hop 512, the
+// default EQ preset, 128-sample blocks and 8192 taps for low latency
+void filter_options_default(filter_options *opts);
+
+// One channel of the stream: its own filter state plus planar (single
+// channel) input and output buffers for the current chunk
+typedef struct {
+    int lowLatency;      // which of the four engines below is in use
+    int fixedPoint;
+    int iir;             // precision of the biquad cascade, 0 if not in use
+    stft_state st;
+    stft_fixed_state fst;
+    pfconv_state conv;
+    biquad_state bq;
+    int16_t *fixedIn;    // in as Q15, fixed point only
+    float *in;           // deinterleaved input, STREAM_CHUNK_FRAMES samples
+    int inCount;
+    float *out;          // finished output, STREAM_CHUNK_FRAMES + one block/frame
+    int outCount;
+    int flush;           // run the end-of-stream tail instead of pushing input
+    int status;
+    thread_pool_job node;  // queues the job on a pool without allocating
+} channel_job;
+
+// Buffers come from arena_alloc, so a job built inside an arena lives there
+int channel_job_init(channel_job *job, const filter_options *opts, int sampleRate);
+void channel_job_free(channel_job *job);
+
+// Largest number of samples one step can leave in job->out
+int channel_job_max_output(const channel_job *job);
+
+// Ready a job for the next stream without rebuilding its filter
+void channel_job_reset(channel_job *job);
+
+// stft_prime for the job's STFT filter (not for low latency or the IIR
+// cascade, whose state depends on the whole history)
+void channel_job_prime(channel_job *job, const float *history);
+
+// Push job->in (or flush, if job->flush is set) through the channel's filter,
+// replacing job->out with whatever came out. Matches thread_pool_fn.
+void run_channel_job(void *arg);
+
+// Run one step (push or flush) on every channel, on the pool when there is
+// one. Returns the frames now in each job's out, or -1 with a message.
+int channel_jobs_run(channel_job *jobs, int channels, thread_pool *pool);
+
+#endif
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cic.h"
+
+void cic_config_default(cic_config *cfg) {
+    cfg->stages = 5;
+    cfg->rate = 4;
+    cfg->diffDelay = 1;
+    cfg->inputWidth = 8;
+    cfg->outputWidth = 18;
+}
+
+int cic_full_width(const cic_config *cfg) {
+    int growth = 0;
+    while ((1L << growth) < (long)cfg->rate * cfg->diffDelay) {
+        growth++;
+    }
+    return cfg->inputWidth + cfg->stages * growth;
+}
+
+const char *cic_config_check(const cic_config *cfg) {
+    if (cfg->stages < 1 || cfg->stages > CIC_MAX_STAGES) {
+        return "the number of stages must be 1..8";
+    }
+    if (cfg->rate < 2 || cfg->rate > 4096) {
+        return "the rate must be 2..4096";
+    }
+    if (cfg->diffDelay < 1 || cfg->diffDelay > 2) {
+        return "the differential delay must be 1 or 2";
+    }
+    if (cfg->inputWidth < 1 || cfg->inputWidth > 32) {
+        return "the input width must be 1..32 bits";
+    }
+    if (cic_full_width(cfg) > 32) {
+        return "the full-precision width exceeds 32 bits";
+    }
+    // With fewer output bits the IP prunes stage widths, which is not modelled
+    if (cfg->outputWidth != cic_full_width(cfg)) {
+        return "only full-precision output widths are modelled";
+    }
+    return NULL;
+}
+
+// Two's complement value of the low `width` bits of v
+static int32_t sign_extend(uint64_t v, int width) {
+    uint64_t sign = 1ULL << (width - 1);
+    v &= (sign << 1) - 1;
+    return (int32_t)(int64_t)((v ^ sign) - sign);
+}
+
+int cic_ref_init(cic_ref *st, const cic_config *cfg) {
+    memset(st, 0, sizeof(*st));
+    const char *problem = cic_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid CIC configuration: %s\n", problem);
+        return -1;
+    }
+    st->cfg = *cfg;
+    st->mask = (1ULL << cfg->outputWidth) - 1;
+    st->delay = (uint64_t *)calloc((size_t)cfg->stages * cfg->diffDelay, sizeof(uint64_t));
+    if (st->delay == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    return 0;
+}
+
+void cic_ref_free(cic_ref *st) {
+    free(st->delay);
+    memset(st, 0, sizeof(*st));
+}
+
+void cic_ref_reset(cic_ref *st) {
+    memset(st->integ, 0, sizeof(st->integ));
+    memset(st->delay, 0, sizeof(uint64_t) * st->cfg.stages * st->cfg.diffDelay);
+    st->phase = 0;
+}
+
+size_t cic_ref_process(cic_ref *st, const int32_t *in, size_t count, int32_t *out) {
+    int n = st->cfg.stages;
+    int m = st->cfg.diffDelay;
+    size_t produced = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        // Integrators at the input rate, each register wrapping at outputWidth bits
+        uint64_t x = (uint64_t)(int64_t)sign_extend((uint64_t)(int64_t)in[i], st->cfg.inputWidth);
+        st->integ[0] = (st->integ[0] + x) & st->mask;
+        for (int s = 1; s < n; s++) {
+            st->integ[s] = (st->integ[s] + st->integ[s - 1]) & st->mask;
+        }
+        if (++st->phase < st->cfg.rate) {
+            continue;
+        }
+        st->phase = 0;
+
+        // Combs at the output rate: y = x - x delayed by M outputs
+        uint64_t v = st->integ[n - 1];
+        for (int s = 0; s < n; s++) {
+            uint64_t *d = st->delay + (size_t)s * m;
+            uint64_t y = (v - d[m - 1]) & st->mask;
+            memmove(d + 1, d, sizeof(uint64_t) * (m - 1));
+            d[0] = v;
+            v = y;
+        }
+        out[produced++] = sign_extend(v, st->cfg.outputWidth);
+    }
+    return produced;
+}
+
+int cic_pdm_init(cic_pdm *st, const cic_config *cfg) {
+    memset(st, 0, sizeof(*st));
+    const char *problem = cic_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid CIC configuration: %s\n", problem);
+        return -1;
+    }
+    int span = cfg->rate * cfg->diffDelay;
+    int taps = cfg->stages * (span - 1) + 1;
+    if (taps > CIC_MAX_TAPS) {
+        fprintf(stderr, "Error: A %d-tap CIC response is too long for the packed PDM model (max %d)\n",
+                taps, CIC_MAX_TAPS);
+        return -1;
+    }
+    st->cfg = *cfg;
+    st->taps = taps;
+    st->numTables = (taps + 7) / 8;
+
+    // Impulse response: the boxcar of length R*M convolved with itself N times
+    int64_t h[CIC_MAX_TAPS] = {1};
+    int len = 1;
+    for (int s = 0; s < cfg->stages; s++) {
+        for (int j = len + span - 2; j >= 0; j--) {
+            int64_t acc = 0;
+            for (int k = 0; k < span; k++) {
+                if (j - k >= 0 && j - k < len) {
+                    acc += h[j - k];
+                }
+            }
+            h[j] = acc;
+        }
+        len += span - 1;
+    }
+
+    // Byte t of the window holds taps 8t..8t+7, newest input in its top bit
+    for (int t = 0; t < st->numTables; t++) {
+        for (int byte = 0; byte < 256; byte++) {
+            int64_t sum = 0;
+            for (int i = 0; i < 8 && 8 * t + i < taps; i++) {
+                if (byte & (0x80 >> i)) {
+                    sum += h[8 * t + i];
+                }
+            }
+            st->table[t][byte] = (int32_t)sum;
+        }
+    }
+    cic_pdm_reset(st);
+    return 0;
+}
+
+void cic_pdm_reset(cic_pdm *st) {
+    st->prev = 0;
+    st->nextEnd = st->cfg.rate - 1;
+}
+
+size_t cic_pdm_process(cic_pdm *st, const uint64_t *words, size_t numBits, int32_t *out) {
+    int rate = st->cfg.rate;
+    int width = st->cfg.outputWidth;
+    size_t numWords = (numBits + 63) / 64;
+    size_t produced = 0;
+
+    for (size_t k = 0; k < numWords; k++) {
+        uint64_t w = words[k];
+        int valid = (k + 1 < numWords || numBits % 64 == 0) ? 64 : (int)(numBits % 64);
+        int e = st->nextEnd;
+        for (; e < valid; e += rate) {
+            // The 64 bits ending at bit e, newest in the top bit
+            uint64_t v = w << (63 - e);
+            if (e < 63) {
+                v |= st->prev >> (e + 1);
+            }
+            int64_t sum = 0;
+            for (int t = 0; t < st->numTables; t++) {
+                sum += st->table[t][(v >> (56 - 8 * t)) & 0xff];
+            }
+            out[produced++] = sign_extend((uint64_t)sum, width);
+        }
+        st->nextEnd = e - 64;
+        st->prev = w;
+    }
+    return produced;
+}
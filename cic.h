@@ -0,0 +1,79 @@
+#ifndef CIC_H
+#define CIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Software model of the Xilinx CIC Compiler decimator used by pdm_mic.sv
+// (cic_compiler_0: 5 stages, rate 4, differential delay 1, 8-bit input,
+// full-precision 18-bit output). Two implementations share one
+// configuration:
+//
+//   cic_ref   the Hogenauer structure as the IP builds it: N integrators at
+//             the input rate, then N combs at the output rate, every
+//             register outputWidth bits wide and wrapping on overflow
+//   cic_pdm   1-bit PDM packed 64 per word; each output is a table lookup
+//             over the last N*(R*M-1)+1 input bits, several per word
+//
+// Both start from the IP's reset state (all registers zero). Output m is
+// produced once input R*m + R-1 has been taken, so the first output covers
+// the first R inputs. Outputs are the IP's m_axis_data_tdata values
+// sign-extended to 32 bits.
+
+typedef struct {
+    int stages;       // N
+    int rate;         // R
+    int diffDelay;    // M
+    int inputWidth;   // bits, two's complement
+    int outputWidth;  // bits; must be the full-precision width
+} cic_config;
+
+// cic_compiler_0 as configured in mic_eq
+void cic_config_default(cic_config *cfg);
+
+// Full-precision output width: inputWidth + N * ceil(log2(R * M))
+int cic_full_width(const cic_config *cfg);
+
+// Returns NULL if the configuration can be modelled, otherwise why not
+const char *cic_config_check(const cic_config *cfg);
+
+#define CIC_MAX_STAGES 8
+#define CIC_MAX_TAPS 64   // longest impulse response cic_pdm handles
+
+// Register-level reference model, one input sample per step
+typedef struct {
+    cic_config cfg;
+    uint64_t mask;                            // outputWidth bits
+    uint64_t integ[CIC_MAX_STAGES];
+    uint64_t *delay;                          // stages * diffDelay comb delay registers
+    int phase;                                // inputs since the last output
+} cic_ref;
+
+int cic_ref_init(cic_ref *st, const cic_config *cfg);
+void cic_ref_free(cic_ref *st);
+void cic_ref_reset(cic_ref *st);
+
+// Push count samples (inputWidth-bit values); returns the outputs written
+size_t cic_ref_process(cic_ref *st, const int32_t *in, size_t count, int32_t *out);
+
+// Packed-PDM fast model. A PDM bit b feeds the IP as the 8-bit sample b
+// (0 or +1), as pdm_mic.sv does with {7'b0, bit}. Bit i of the stream is
+// bit i % 64 of word i / 64 (LSB first).
+typedef struct {
+    cic_config cfg;
+    int taps;                                 // N * (R*M - 1) + 1
+    int numTables;                            // ceil(taps / 8)
+    int32_t table[CIC_MAX_TAPS / 8][256];     // partial sums per byte of the bit window
+    uint64_t prev;                            // previous input word
+    int nextEnd;                              // bit offset, in the next word, of the next output's last input
+} cic_pdm;
+
+int cic_pdm_init(cic_pdm *st, const cic_config *cfg);
+void cic_pdm_reset(cic_pdm *st);
+
+// Decimate numBits bits of words. Calls may be chained as long as every call
+// but the last passes a multiple of 64 bits. Returns the outputs written,
+// at most numBits / R + 1.
+size_t cic_pdm_process(cic_pdm *st, const uint64_t *words, size_t numBits, int32_t *out);
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cic.h"
+#include "pdm_file.h"
+
+// Runs a PDM bit file through the model of cic_compiler_0 and writes the
+// decimated samples as decimal text, one per line: the values pdm_mic.sv
+// puts on pcm_data, without an xsim run.
+//
+//   ./cic_model pdm_positive_full_scale.txt golden.txt
+//
+// The input is $readmemb text with one bit per entry, as read_pdm_from_file.sv
+// loads it, or the same bits in a packed .pdm capture. --check also runs the
+// register-level reference and fails on any difference; --repeat N times the
+// packed model over N passes.
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// All bits of a packed capture
+static long read_packed(const char *path, uint64_t **wordsOut) {
+    pdm_reader r;
+    if (pdm_reader_open(&r, path) != 0) {
+        return -1;
+    }
+    if (r.info.channels != 1) {
+        fprintf(stderr, "Error: '%s' holds %d channels; the CIC model takes one\n", path, r.info.channels);
+        pdm_reader_close(&r);
+        return -1;
+    }
+    uint64_t *words = (uint64_t *)malloc(sizeof(uint64_t) * (r.info.numBits / 64 + 1));
+    if (words == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        pdm_reader_close(&r);
+        return -1;
+    }
+    long bits = (long)pdm_reader_read(&r, words, (size_t)(r.info.numBits / 64 + 1) * 64);
+    pdm_reader_close(&r);
+    *wordsOut = words;
+    return bits;
+}
+
+// The reference model on the same bits, one 8-bit sample per bit
+static int check_reference(const cic_config *cfg, const uint64_t *words, long bits, const int32_t *expected, size_t count) {
+    cic_ref ref;
+    if (cic_ref_init(&ref, cfg) != 0) {
+        return -1;
+    }
+    int32_t *samples = (int32_t *)malloc(sizeof(int32_t) * (bits > 0 ? bits : 1));
+    int32_t *out = (int32_t *)malloc(sizeof(int32_t) * (bits / cfg->rate + 1));
+    if (samples == NULL || out == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(samples);
+        free(out);
+        cic_ref_free(&ref);
+        return -1;
+    }
+    for (long i = 0; i < bits; i++) {
+        samples[i] = (int32_t)((words[i / 64] >> (i % 64)) & 1);
+    }
+    size_t got = cic_ref_process(&ref, samples, (size_t)bits, out);
+    int status = got == count ? 0 : -1;
+    for (size_t i = 0; status == 0 && i < count; i++) {
+        if (out[i] != expected[i]) {
+            fprintf(stderr, "Error: Output %zu differs: packed model %d, reference %d\n", i, expected[i], out[i]);
+            status = -1;
+        }
+    }
+    if (got != count) {
+        fprintf(stderr, "Error: Packed model gave %zu outputs, reference %zu\n", count, got);
+    }
+    free(samples);
+    free(out);
+    cic_ref_free(&ref);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    int check = 0;
+    int repeat = 1;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--check") == 0) {
+            check = 1;
+        } else if (strcmp(argv[argi], "--repeat") == 0 && argi + 1 < argc) {
+            repeat = atoi(argv[++argi]);
+            if (repeat < 1) {
+                fprintf(stderr, "Error: --repeat needs a positive count\n");
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[argi]);
+            return 1;
+        }
+    }
+    if (argc - argi != 2) {
+        fprintf(stderr, "Usage: %s [--check] [--repeat N] <pdm_bits.txt|.pdm> <pcm.txt>\n", argv[0]);
+        return 1;
+    }
+
+    cic_config cfg;
+    cic_config_default(&cfg);
+    cic_pdm cic;
+    if (cic_pdm_init(&cic, &cfg) != 0) {
+        return 1;
+    }
+
+    uint64_t *words = NULL;
+    long bits = pdm_file_probe(argv[argi]) ? read_packed(argv[argi], &words) : pdm_read_readmemb(argv[argi], &words);
+    if (bits < 0) {
+        return 1;
+    }
+    int32_t *pcm = (int32_t *)malloc(sizeof(int32_t) * (bits / cfg.rate + 1));
+    if (pcm == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(words);
+        return 1;
+    }
+
+    size_t count = 0;
+    double start = now_seconds();
+    for (int r = 0; r < repeat; r++) {
+        cic_pdm_reset(&cic);
+        count = cic_pdm_process(&cic, words, (size_t)bits, pcm);
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "CIC: %ld bits -> %zu samples; %.1f Mbit/s\n", bits, count,
+            elapsed > 0.0 ? (double)bits * repeat / elapsed / 1e6 : 0.0);
+
+    int status = 0;
+    if (check) {
+        status = check_reference(&cfg, words, bits, pcm, count);
+        if (status == 0) {
+            fprintf(stderr, "CIC: packed model matches the register-level reference\n");
+        }
+    }
+
+    FILE *out = status == 0 ? fopen(argv[argi + 1], "w") : NULL;
+    if (status == 0 && out == NULL) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", argv[argi + 1]);
+        status = -1;
+    }
+    if (out != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            fprintf(out, "%d\n", pcm[i]);
+        }
+        if (fclose(out) != 0) {
+            fprintf(stderr, "Error: Could not write '%s'\n", argv[argi + 1]);
+            status = -1;
+        }
+    }
+    free(words);
+    free(pcm);
+    return status == 0 ? 0 : 1;
+}
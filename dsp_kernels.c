@@ -0,0 +1,1092 @@
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "dsp_kernels.h"
+
+// Variants must match the scalar code bit for bit, so multiplies and adds
+// may never be fused into FMAs, whatever -march the file is built with
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSP_X86 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference; the SIMD variants also use these for their tails
+
+static void mul_scalar(float *dst, const float *a, const float *b, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = a[i] * b[i];
+    }
+}
+
+static void mul_add_scalar(float *acc, const float *a, const float *b, int n) {
+    for (int i = 0; i < n; i++) {
+        acc[i] += a[i] * b[i];
+    }
+}
+
+static void cmul_scalar(fft_cpx *x, const fft_cpx *g, int n) {
+    for (int k = 0; k < n; k++) {
+        float r = x[k].r * g[k].r - x[k].i * g[k].i;
+        float i = x[k].r * g[k].i + x[k].i * g[k].r;
+        x[k].r = r;
+        x[k].i = i;
+    }
+}
+
+static void cmul_add_scalar(fft_cpx *acc, const fft_cpx *x, const fft_cpx *h, int n) {
+    for (int k = 0; k < n; k++) {
+        acc[k].r += x[k].r * h[k].r - x[k].i * h[k].i;
+        acc[k].i += x[k].r * h[k].i + x[k].i * h[k].r;
+    }
+}
+
+// The dot product keeps eight partial sums, term i going to sum i % 8, and
+// adds them in a fixed tree: the order an 8-lane register gives, so every
+// variant rounds alike. Terms from start on are added into acc.
+static float dot_from(const float *a, const float *b, int start, int n, float *acc) {
+    for (int i = start; i < n; i++) {
+        acc[i % 8] += a[i] * b[i];
+    }
+    return ((acc[0] + acc[4]) + (acc[2] + acc[6])) + ((acc[1] + acc[5]) + (acc[3] + acc[7]));
+}
+
+static float dot_scalar(const float *a, const float *b, int n) {
+    float acc[8] = {0};
+    return dot_from(a, b, 0, n, acc);
+}
+
+// Fixed-point kernels. Integer results are exact, so the SIMD variants only
+// have to saturate at the same points as these.
+
+static int32_t sat32(int64_t x) {
+    return (int32_t)(x > INT32_MAX ? INT32_MAX : x < INT32_MIN ? INT32_MIN : x);
+}
+
+static void window_q15_scalar(int32_t *dst, const int16_t *x, const int16_t *w, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = ((int32_t)x[i] * w[i] + 1) >> 1;
+    }
+}
+
+static void butterfly_q31_scalar(fft_fixed_cpx *a, fft_fixed_cpx *b, const fft_fixed_cpx *tw, int n) {
+    for (int j = 0; j < n; j++) {
+        int32_t tr = (int32_t)(((int64_t)b[j].r * tw[j].r - (int64_t)b[j].i * tw[j].i + (1LL << 30)) >> 31);
+        int32_t ti = (int32_t)(((int64_t)b[j].r * tw[j].i + (int64_t)b[j].i * tw[j].r + (1LL << 30)) >> 31);
+        int32_t ar = a[j].r, ai = a[j].i;
+        a[j].r = (ar + tr + 1) >> 1;
+        a[j].i = (ai + ti + 1) >> 1;
+        b[j].r = (ar - tr + 1) >> 1;
+        b[j].i = (ai - ti + 1) >> 1;
+    }
+}
+
+static int32_t clamp_fixed(int64_t x) {
+    return (int32_t)(x > FFT_FIXED_MAX ? FFT_FIXED_MAX : x < -FFT_FIXED_MAX ? -FFT_FIXED_MAX : x);
+}
+
+static void cmul_q31_scalar(fft_fixed_cpx *x, const fft_fixed_cpx *g, int shift, int n) {
+    int64_t round = 1LL << (shift - 1);
+    for (int k = 0; k < n; k++) {
+        int64_t r = (int64_t)x[k].r * g[k].r - (int64_t)x[k].i * g[k].i;
+        int64_t i = (int64_t)x[k].r * g[k].i + (int64_t)x[k].i * g[k].r;
+        x[k].r = clamp_fixed((r + round) >> shift);
+        x[k].i = clamp_fixed((i + round) >> shift);
+    }
+}
+
+static void mul_add_q15_scalar(int32_t *acc, const fft_fixed_cpx *y, const int16_t *w, int n) {
+    for (int i = 0; i < n; i++) {
+        acc[i] = sat32((int64_t)acc[i] + (((int64_t)y[i].r * w[i] + (1 << 14)) >> 15));
+    }
+}
+
+// Half precision with the same rounding and NaN handling as F16C's
+// conversions, so the AVX2 variant matches bit for bit
+
+static uint16_t float_to_half(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+    uint32_t a = x & 0x7fffffff;
+    if (a > 0x7f800000) {
+        return sign | 0x7e00 | (uint16_t)((a >> 13) & 0x3ff);  // quiet NaN, payload kept
+    }
+    if (a >= 0x477ff000) {
+        return sign | 0x7c00;  // 65520 and up round to infinity
+    }
+    if (a >= 0x38800000) {
+        // Normal: rebias the exponent, round away the low 13 mantissa bits
+        a -= 0x38000000;
+        a += 0xfff + ((a >> 13) & 1);
+        return sign | (uint16_t)(a >> 13);
+    }
+    if (a <= 0x33000000) {
+        return sign;  // 2^-25 and below round to zero
+    }
+    // Subnormal: the mantissa in units of 2^-24
+    uint32_t m = (a & 0x7fffff) | 0x800000;
+    int shift = 126 - (int)(a >> 23);
+    uint32_t q = m >> shift;
+    uint32_t rem = m & ((1u << shift) - 1);
+    uint32_t half = 1u << (shift - 1);
+    q += rem > half || (rem == half && (q & 1));
+    return sign | (uint16_t)q;
+}
+
+static float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t e = (h >> 10) & 0x1f;
+    uint32_t m = h & 0x3ff;
+    uint32_t x;
+    if (e == 0x1f) {
+        x = sign | 0x7f800000 | (m != 0 ? 0x400000 : 0) | (m << 13);
+    } else if (e != 0) {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    } else {
+        float f = m * (1.0f / 16777216.0f);  // subnormal, exact
+        memcpy(&x, &f, sizeof(x));
+        x |= sign;
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static void to_half_scalar(uint16_t *dst, const float *src, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = float_to_half(src[i]);
+    }
+}
+
+static void from_half_scalar(float *dst, const uint16_t *src, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+// The frame loops below take a starting frame so SIMD variants can hand
+// their leftover frames (and layouts they do not specialize) to them
+
+static void deinterleave_from(const float *src, int channels, float *const *planes, int start, int frames) {
+    for (int c = 0; c < channels; c++) {
+        float *dst = planes[c];
+        for (int i = start; i < frames; i++) {
+            dst[i] = src[(size_t)i * channels + c];
+        }
+    }
+}
+
+static void interleave_from(const float *const *planes, int channels, float *dst, int start, int frames) {
+    for (int c = 0; c < channels; c++) {
+        const float *src = planes[c];
+        for (int i = start; i < frames; i++) {
+            dst[(size_t)i * channels + c] = src[i];
+        }
+    }
+}
+
+static void deinterleave_s16_from(const int16_t *src, int channels, float *const *planes, int start, int frames) {
+    for (int c = 0; c < channels; c++) {
+        float *dst = planes[c];
+        for (int i = start; i < frames; i++) {
+            dst[i] = src[(size_t)i * channels + c] * (1.0f / 32768.0f);
+        }
+    }
+}
+
+static int16_t float_to_s16(float x) {
+    // Same scale libsndfile uses when writing floats to PCM16, clipped
+    double d = x * 32767.0;
+    return (int16_t)lrint(d > 32767.0 ? 32767.0 : d < -32768.0 ? -32768.0 : d);
+}
+
+static void interleave_s16_from(const float *const *planes, int channels, int16_t *dst, int start, int frames) {
+    for (int c = 0; c < channels; c++) {
+        const float *src = planes[c];
+        for (int i = start; i < frames; i++) {
+            dst[(size_t)i * channels + c] = float_to_s16(src[i]);
+        }
+    }
+}
+
+static void deinterleave_scalar(const float *src, int channels, float *const *planes, int frames) {
+    deinterleave_from(src, channels, planes, 0, frames);
+}
+
+static void interleave_scalar(const float *const *planes, int channels, float *dst, int frames) {
+    interleave_from(planes, channels, dst, 0, frames);
+}
+
+static void deinterleave_s16_scalar(const int16_t *src, int channels, float *const *planes, int frames) {
+    deinterleave_s16_from(src, channels, planes, 0, frames);
+}
+
+static void interleave_s16_scalar(const float *const *planes, int channels, int16_t *dst, int frames) {
+    interleave_s16_from(planes, channels, dst, 0, frames);
+}
+
+// One wavefront step over every section, last section first so each still
+// reads what its predecessor produced on the previous step
+static void biquad_scalar(const float *coef, float *state, const float *in, float *out, int steps) {
+    const int L = BIQUAD_LANES;
+    const float *b0 = coef, *b1 = coef + L, *b2 = coef + 2 * L, *a1 = coef + 3 * L, *a2 = coef + 4 * L;
+    float *y = state, *s1 = state + L, *s2 = state + 2 * L;
+    for (int i = 0; i < steps; i++) {
+        for (int b = L - 1; b >= 0; b--) {
+            float x = b > 0 ? y[b - 1] : in[i];
+            float v = b0[b] * x + s1[b];
+            s1[b] = b1[b] * x - a1[b] * v + s2[b];
+            s2[b] = b2[b] * x - a2[b] * v;
+            y[b] = v;
+        }
+        out[i] = y[L - 1];
+    }
+}
+
+static void biquad_f64_scalar(const double *coef, double *state, const double *in, double *out, int steps) {
+    const int L = BIQUAD_LANES_F64;
+    const double *b0 = coef, *b1 = coef + L, *b2 = coef + 2 * L, *a1 = coef + 3 * L, *a2 = coef + 4 * L;
+    double *y = state, *s1 = state + L, *s2 = state + 2 * L;
+    for (int i = 0; i < steps; i++) {
+        for (int b = L - 1; b >= 0; b--) {
+            double x = b > 0 ? y[b - 1] : in[i];
+            double v = b0[b] * x + s1[b];
+            s1[b] = b1[b] * x - a1[b] * v + s2[b];
+            s2[b] = b2[b] * x - a2[b] * v;
+            y[b] = v;
+        }
+        out[i] = y[L - 1];
+    }
+}
+
+static void sd_bits_scalar(const uint32_t *sums, int count, int shift, uint64_t *words) {
+    for (int k = 0; 64 * k < count; k++) {
+        int n = count - 64 * k < 64 ? count - 64 * k : 64;
+        const uint32_t *s = sums + 64 * k;
+        uint64_t w = 0;
+        for (int i = 0; i < n; i++) {
+            w |= (uint64_t)(((s[i + 1] ^ s[i]) >> shift) != 0) << i;
+        }
+        words[k] = w;
+    }
+}
+
+static const dsp_kernels kernels_scalar = {
+    "scalar",
+    mul_scalar, mul_add_scalar, cmul_scalar, cmul_add_scalar, dot_scalar,
+    window_q15_scalar, butterfly_q31_scalar, cmul_q31_scalar, mul_add_q15_scalar,
+    to_half_scalar, from_half_scalar,
+    biquad_scalar, biquad_f64_scalar, sd_bits_scalar,
+    deinterleave_scalar, interleave_scalar, deinterleave_s16_scalar, interleave_s16_scalar,
+};
+
+#ifdef DSP_X86
+
+// ---------------------------------------------------------------------------
+// SSE2: 4 floats / 2 complex bins per step
+
+__attribute__((target("sse2")))
+static void mul_sse2(float *dst, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    mul_scalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void mul_add_sse2(float *acc, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), p));
+    }
+    mul_add_scalar(acc + i, a + i, b + i, n - i);
+}
+
+// Two interleaved complex products: (xr*gr - xi*gi, xi*gr + xr*gi)
+__attribute__((target("sse2")))
+static __m128 cmul2_sse2(__m128 x, __m128 g) {
+    const __m128 negEven = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+    __m128 gr = _mm_shuffle_ps(g, g, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 gi = _mm_shuffle_ps(g, g, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 t1 = _mm_mul_ps(x, gr);
+    __m128 t2 = _mm_mul_ps(xs, gi);
+    return _mm_add_ps(t1, _mm_xor_ps(t2, negEven));
+}
+
+__attribute__((target("sse2")))
+static void cmul_sse2(fft_cpx *x, const fft_cpx *g, int n) {
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        float *px = (float *)(x + k);
+        _mm_storeu_ps(px, cmul2_sse2(_mm_loadu_ps(px), _mm_loadu_ps((const float *)(g + k))));
+    }
+    cmul_scalar(x + k, g + k, n - k);
+}
+
+__attribute__((target("sse2")))
+static void cmul_add_sse2(fft_cpx *acc, const fft_cpx *x, const fft_cpx *h, int n) {
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        float *pa = (float *)(acc + k);
+        __m128 p = cmul2_sse2(_mm_loadu_ps((const float *)(x + k)), _mm_loadu_ps((const float *)(h + k)));
+        _mm_storeu_ps(pa, _mm_add_ps(_mm_loadu_ps(pa), p));
+    }
+    cmul_add_scalar(acc + k, x + k, h + k, n - k);
+}
+
+// Partial sums 0-3 in lo, 4-7 in hi
+__attribute__((target("sse2")))
+static float dot_sse2(const float *a, const float *b, int n) {
+    __m128 lo = _mm_setzero_ps();
+    __m128 hi = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float acc[8];
+    _mm_storeu_ps(acc, lo);
+    _mm_storeu_ps(acc + 4, hi);
+    return dot_from(a, b, i, n, acc);
+}
+
+// 32-bit products of eight int16 pairs from their low and high halves.
+// SSE2 has no signed 32 x 32 -> 64 multiply, so the other fixed-point
+// kernels stay scalar on this variant.
+__attribute__((target("sse2")))
+static void window_q15_sse2(int32_t *dst, const int16_t *x, const int16_t *w, int n) {
+    const __m128i one = _mm_set1_epi32(1);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i lo = _mm_mullo_epi16(a, b);
+        __m128i hi = _mm_mulhi_epi16(a, b);
+        __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), one), 1);
+        __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), one), 1);
+        _mm_storeu_si128((__m128i *)(dst + i), p0);
+        _mm_storeu_si128((__m128i *)(dst + i + 4), p1);
+    }
+    window_q15_scalar(dst + i, x + i, w + i, n - i);
+}
+
+// Mono and stereo are specialized; other layouts use the scalar loops
+__attribute__((target("sse2")))
+static void deinterleave_sse2(const float *src, int channels, float *const *planes, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        memcpy(planes[0], src, sizeof(float) * frames);
+        return;
+    }
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(src + 2 * i);
+            __m128 b = _mm_loadu_ps(src + 2 * i + 4);
+            _mm_storeu_ps(planes[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(planes[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+    deinterleave_from(src, channels, planes, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void interleave_sse2(const float *const *planes, int channels, float *dst, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        memcpy(dst, planes[0], sizeof(float) * frames);
+        return;
+    }
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 l = _mm_loadu_ps(planes[0] + i);
+            __m128 r = _mm_loadu_ps(planes[1] + i);
+            _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+        }
+    }
+    interleave_from(planes, channels, dst, i, frames);
+}
+
+// Sign-extend the low/high four int16 lanes and scale to [-1, 1)
+__attribute__((target("sse2")))
+static __m128 s16_lo_sse2(__m128i v) {
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), _mm_set1_ps(1.0f / 32768.0f));
+}
+
+__attribute__((target("sse2")))
+static __m128 s16_hi_sse2(__m128i v) {
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), _mm_set1_ps(1.0f / 32768.0f));
+}
+
+__attribute__((target("sse2")))
+static void deinterleave_s16_sse2(const int16_t *src, int channels, float *const *planes, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_ps(planes[0] + i, s16_lo_sse2(v));
+            _mm_storeu_ps(planes[0] + i + 4, s16_hi_sse2(v));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            __m128 a = s16_lo_sse2(v);
+            __m128 b = s16_hi_sse2(v);
+            _mm_storeu_ps(planes[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(planes[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+    deinterleave_s16_from(src, channels, planes, i, frames);
+}
+
+// Four floats to four int32, through double exactly like float_to_s16
+__attribute__((target("sse2")))
+static __m128i to_s32_sse2(__m128 x) {
+    const __m128d scale = _mm_set1_pd(32767.0);
+    const __m128d hi = _mm_set1_pd(32767.0);
+    const __m128d lo = _mm_set1_pd(-32768.0);
+    __m128d d0 = _mm_mul_pd(_mm_cvtps_pd(x), scale);
+    __m128d d1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), scale);
+    d0 = _mm_max_pd(_mm_min_pd(d0, hi), lo);
+    d1 = _mm_max_pd(_mm_min_pd(d1, hi), lo);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(d0), _mm_cvtpd_epi32(d1));
+}
+
+__attribute__((target("sse2")))
+static void interleave_s16_sse2(const float *const *planes, int channels, int16_t *dst, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            __m128i a = to_s32_sse2(_mm_loadu_ps(planes[0] + i));
+            __m128i b = to_s32_sse2(_mm_loadu_ps(planes[0] + i + 4));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 l = _mm_loadu_ps(planes[0] + i);
+            __m128 r = _mm_loadu_ps(planes[1] + i);
+            __m128i a = to_s32_sse2(_mm_unpacklo_ps(l, r));
+            __m128i b = to_s32_sse2(_mm_unpackhi_ps(l, r));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_packs_epi32(a, b));
+        }
+    }
+    interleave_s16_from(planes, channels, dst, i, frames);
+}
+
+// Biquad wavefront: sections 0-3 and 4-7 in two registers (float), 0-1 and
+// 2-3 (double). Shifting the outputs up one lane makes the next inputs.
+__attribute__((target("sse2")))
+static void biquad_sse2(const float *coef, float *state, const float *in, float *out, int steps) {
+    const int L = BIQUAD_LANES;
+    __m128 b0a = _mm_loadu_ps(coef), b0b = _mm_loadu_ps(coef + 4);
+    __m128 b1a = _mm_loadu_ps(coef + L), b1b = _mm_loadu_ps(coef + L + 4);
+    __m128 b2a = _mm_loadu_ps(coef + 2 * L), b2b = _mm_loadu_ps(coef + 2 * L + 4);
+    __m128 a1a = _mm_loadu_ps(coef + 3 * L), a1b = _mm_loadu_ps(coef + 3 * L + 4);
+    __m128 a2a = _mm_loadu_ps(coef + 4 * L), a2b = _mm_loadu_ps(coef + 4 * L + 4);
+    __m128 ya = _mm_loadu_ps(state), yb = _mm_loadu_ps(state + 4);
+    __m128 s1a = _mm_loadu_ps(state + L), s1b = _mm_loadu_ps(state + L + 4);
+    __m128 s2a = _mm_loadu_ps(state + 2 * L), s2b = _mm_loadu_ps(state + 2 * L + 4);
+    for (int i = 0; i < steps; i++) {
+        __m128 xa = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(ya), 4));
+        __m128 xb = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yb), 4));
+        xa = _mm_move_ss(xa, _mm_set_ss(in[i]));
+        xb = _mm_move_ss(xb, _mm_shuffle_ps(ya, ya, _MM_SHUFFLE(3, 3, 3, 3)));
+        ya = _mm_add_ps(_mm_mul_ps(b0a, xa), s1a);
+        yb = _mm_add_ps(_mm_mul_ps(b0b, xb), s1b);
+        s1a = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1a, xa), _mm_mul_ps(a1a, ya)), s2a);
+        s1b = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1b, xb), _mm_mul_ps(a1b, yb)), s2b);
+        s2a = _mm_sub_ps(_mm_mul_ps(b2a, xa), _mm_mul_ps(a2a, ya));
+        s2b = _mm_sub_ps(_mm_mul_ps(b2b, xb), _mm_mul_ps(a2b, yb));
+        out[i] = _mm_cvtss_f32(_mm_shuffle_ps(yb, yb, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    _mm_storeu_ps(state, ya);
+    _mm_storeu_ps(state + 4, yb);
+    _mm_storeu_ps(state + L, s1a);
+    _mm_storeu_ps(state + L + 4, s1b);
+    _mm_storeu_ps(state + 2 * L, s2a);
+    _mm_storeu_ps(state + 2 * L + 4, s2b);
+}
+
+__attribute__((target("sse2")))
+static void biquad_f64_sse2(const double *coef, double *state, const double *in, double *out, int steps) {
+    const int L = BIQUAD_LANES_F64;
+    __m128d b0a = _mm_loadu_pd(coef), b0b = _mm_loadu_pd(coef + 2);
+    __m128d b1a = _mm_loadu_pd(coef + L), b1b = _mm_loadu_pd(coef + L + 2);
+    __m128d b2a = _mm_loadu_pd(coef + 2 * L), b2b = _mm_loadu_pd(coef + 2 * L + 2);
+    __m128d a1a = _mm_loadu_pd(coef + 3 * L), a1b = _mm_loadu_pd(coef + 3 * L + 2);
+    __m128d a2a = _mm_loadu_pd(coef + 4 * L), a2b = _mm_loadu_pd(coef + 4 * L + 2);
+    __m128d ya = _mm_loadu_pd(state), yb = _mm_loadu_pd(state + 2);
+    __m128d s1a = _mm_loadu_pd(state + L), s1b = _mm_loadu_pd(state + L + 2);
+    __m128d s2a = _mm_loadu_pd(state + 2 * L), s2b = _mm_loadu_pd(state + 2 * L + 2);
+    for (int i = 0; i < steps; i++) {
+        __m128d xa = _mm_unpacklo_pd(_mm_set_sd(in[i]), ya);
+        __m128d xb = _mm_shuffle_pd(ya, yb, 1);
+        ya = _mm_add_pd(_mm_mul_pd(b0a, xa), s1a);
+        yb = _mm_add_pd(_mm_mul_pd(b0b, xb), s1b);
+        s1a = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1a, xa), _mm_mul_pd(a1a, ya)), s2a);
+        s1b = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1b, xb), _mm_mul_pd(a1b, yb)), s2b);
+        s2a = _mm_sub_pd(_mm_mul_pd(b2a, xa), _mm_mul_pd(a2a, ya));
+        s2b = _mm_sub_pd(_mm_mul_pd(b2b, xb), _mm_mul_pd(a2b, yb));
+        out[i] = _mm_cvtsd_f64(_mm_unpackhi_pd(yb, yb));
+    }
+    _mm_storeu_pd(state, ya);
+    _mm_storeu_pd(state + 2, yb);
+    _mm_storeu_pd(state + L, s1a);
+    _mm_storeu_pd(state + L + 2, s1b);
+    _mm_storeu_pd(state + 2 * L, s2a);
+    _mm_storeu_pd(state + 2 * L + 2, s2b);
+}
+
+// Sigma-delta bits, 4 per compare: a lane whose shifted xor is zero made no 1
+__attribute__((target("sse2")))
+static void sd_bits_sse2(const uint32_t *sums, int count, int shift, uint64_t *words) {
+    __m128i sh = _mm_cvtsi32_si128(shift), zero = _mm_setzero_si128();
+    int k = 0;
+    for (; 64 * k + 64 <= count; k++) {
+        const uint32_t *s = sums + 64 * k;
+        uint64_t w = 0;
+        for (int i = 0; i < 64; i += 4) {
+            __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(s + i + 1)), _mm_loadu_si128((const __m128i *)(s + i)));
+            int same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_srl_epi32(d, sh), zero)));
+            w |= (uint64_t)(same ^ 0xf) << i;
+        }
+        words[k] = w;
+    }
+    sd_bits_scalar(sums + 64 * k, count - 64 * k, shift, words + k);
+}
+
+static const dsp_kernels kernels_sse2 = {
+    "sse2",
+    mul_sse2, mul_add_sse2, cmul_sse2, cmul_add_sse2, dot_sse2,
+    window_q15_sse2, butterfly_q31_scalar, cmul_q31_scalar, mul_add_q15_scalar,
+    to_half_scalar, from_half_scalar,
+    biquad_sse2, biquad_f64_sse2, sd_bits_sse2,
+    deinterleave_sse2, interleave_sse2, deinterleave_s16_sse2, interleave_s16_sse2,
+};
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 floats / 4 complex bins per step
+
+__attribute__((target("avx2")))
+static void mul_avx2(float *dst, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    mul_scalar(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void mul_add_avx2(float *acc, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 p = _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), p));
+    }
+    mul_add_scalar(acc + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static __m256 cmul4_avx2(__m256 x, __m256 g) {
+    __m256 t1 = _mm256_mul_ps(x, _mm256_moveldup_ps(g));
+    __m256 t2 = _mm256_mul_ps(_mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)), _mm256_movehdup_ps(g));
+    return _mm256_addsub_ps(t1, t2);
+}
+
+__attribute__((target("avx2")))
+static void cmul_avx2(fft_cpx *x, const fft_cpx *g, int n) {
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float *px = (float *)(x + k);
+        _mm256_storeu_ps(px, cmul4_avx2(_mm256_loadu_ps(px), _mm256_loadu_ps((const float *)(g + k))));
+    }
+    cmul_scalar(x + k, g + k, n - k);
+}
+
+__attribute__((target("avx2")))
+static void cmul_add_avx2(fft_cpx *acc, const fft_cpx *x, const fft_cpx *h, int n) {
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        float *pa = (float *)(acc + k);
+        __m256 p = cmul4_avx2(_mm256_loadu_ps((const float *)(x + k)), _mm256_loadu_ps((const float *)(h + k)));
+        _mm256_storeu_ps(pa, _mm256_add_ps(_mm256_loadu_ps(pa), p));
+    }
+    cmul_add_scalar(acc + k, x + k, h + k, n - k);
+}
+
+// The tail and the reduction stay in registers: handing them to dot_from
+// would mix legacy SSE code into a dirty AVX state, which costs more than
+// the loop. Lanes past the end add -0.0, which leaves any sum unchanged.
+__attribute__((target("avx2")))
+static float dot_avx2(const float *a, const float *b, int n) {
+    __m256 sum = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    if (i < n) {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256 p = _mm256_mul_ps(_mm256_maskload_ps(a + i, mask), _mm256_maskload_ps(b + i, mask));
+        p = _mm256_blendv_ps(_mm256_set1_ps(-0.0f), p, _mm256_castsi256_ps(mask));
+        sum = _mm256_add_ps(sum, p);
+    }
+    // (0+4, 1+5, 2+6, 3+7), then (0+4 + 2+6, 1+5 + 3+7), then their sum
+    __m128 q = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    q = _mm_add_ps(q, _mm_movehl_ps(q, q));
+    q = _mm_add_ss(q, _mm_shuffle_ps(q, q, 1));
+    return _mm_cvtss_f32(q);
+}
+
+__attribute__((target("avx2")))
+static void window_q15_avx2(int32_t *dst, const int16_t *x, const int16_t *w, int n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        __m256i lo = _mm256_mullo_epi16(a, b);
+        __m256i hi = _mm256_mulhi_epi16(a, b);
+        // Samples 0-3 | 8-11 and 4-7 | 12-15; put the 128-bit halves back in order
+        __m256i p0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), one), 1);
+        __m256i p1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), one), 1);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i + 8), _mm256_permute2x128_si256(p0, p1, 0x31));
+    }
+    window_q15_scalar(dst + i, x + i, w + i, n - i);
+}
+
+// Four complex products x * g as 64-bit real (re) and imaginary (im) sums.
+// _mm256_mul_epi32 multiplies the even 32-bit lanes, which hold the real
+// parts; swapping or shifting brings the imaginary parts there.
+__attribute__((target("avx2")))
+static void cmul4_q31_avx2(__m256i x, __m256i g, __m256i *re, __m256i *im) {
+    __m256i xs = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m256i gi = _mm256_srli_epi64(g, 32);
+    *re = _mm256_sub_epi64(_mm256_mul_epi32(x, g), _mm256_mul_epi32(xs, gi));
+    *im = _mm256_add_epi64(_mm256_mul_epi32(x, gi), _mm256_mul_epi32(xs, g));
+}
+
+// Low 32 bits of re and im back into interleaved complex lanes. AVX2 has no
+// 64-bit arithmetic shift, but a logical one leaves the same low 32 bits.
+__attribute__((target("avx2")))
+static __m256i join4_q31_avx2(__m256i re, __m256i im) {
+    return _mm256_blend_epi32(re, _mm256_slli_epi64(im, 32), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static void butterfly_q31_avx2(fft_fixed_cpx *a, fft_fixed_cpx *b, const fft_fixed_cpx *tw, int n) {
+    const __m256i round = _mm256_set1_epi64x(1LL << 30);
+    const __m256i one = _mm256_set1_epi32(1);
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256i re, im;
+        cmul4_q31_avx2(_mm256_loadu_si256((const __m256i *)(b + j)), _mm256_loadu_si256((const __m256i *)(tw + j)),
+                       &re, &im);
+        __m256i t = join4_q31_avx2(_mm256_srli_epi64(_mm256_add_epi64(re, round), 31),
+                                   _mm256_srli_epi64(_mm256_add_epi64(im, round), 31));
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + j)), one);
+        _mm256_storeu_si256((__m256i *)(a + j), _mm256_srai_epi32(_mm256_add_epi32(x, t), 1));
+        _mm256_storeu_si256((__m256i *)(b + j), _mm256_srai_epi32(_mm256_sub_epi32(x, t), 1));
+    }
+    butterfly_q31_scalar(a + j, b + j, tw + j, n - j);
+}
+
+// Clamping the rounded 64-bit sum to [-M * 2^s, (M + 1) * 2^s - 1] before
+// the shift gives the same result as clamping the shifted value to +-M
+__attribute__((target("avx2")))
+static __m256i clamp_shift_avx2(__m256i x, __m256i lo, __m256i hi, __m128i shift) {
+    x = _mm256_blendv_epi8(x, lo, _mm256_cmpgt_epi64(lo, x));
+    x = _mm256_blendv_epi8(x, hi, _mm256_cmpgt_epi64(x, hi));
+    return _mm256_srl_epi64(x, shift);
+}
+
+__attribute__((target("avx2")))
+static void cmul_q31_avx2(fft_fixed_cpx *x, const fft_fixed_cpx *g, int shift, int n) {
+    const __m256i round = _mm256_set1_epi64x(1LL << (shift - 1));
+    const __m256i lo = _mm256_set1_epi64x(-((int64_t)FFT_FIXED_MAX << shift));
+    const __m256i hi = _mm256_set1_epi64x((((int64_t)FFT_FIXED_MAX + 1) << shift) - 1);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256i re, im;
+        cmul4_q31_avx2(_mm256_loadu_si256((const __m256i *)(x + k)), _mm256_loadu_si256((const __m256i *)(g + k)),
+                       &re, &im);
+        re = clamp_shift_avx2(_mm256_add_epi64(re, round), lo, hi, count);
+        im = clamp_shift_avx2(_mm256_add_epi64(im, round), lo, hi, count);
+        _mm256_storeu_si256((__m256i *)(x + k), join4_q31_avx2(re, im));
+    }
+    cmul_q31_scalar(x + k, g + k, shift, n - k);
+}
+
+// Eight outputs per step: the real parts sit in the even lanes of two
+// complex vectors, so _mm256_mul_epi32 takes them directly. The sum
+// saturates where the two signs agree and the result's differs.
+__attribute__((target("avx2")))
+static void mul_add_q15_avx2(int32_t *acc, const fft_fixed_cpx *y, const int16_t *w, int n) {
+    const __m256i round = _mm256_set1_epi64x(1 << 14);
+    const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i max = _mm256_set1_epi32(INT32_MAX);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i wv = _mm_loadu_si128((const __m128i *)(w + i));
+        __m256i p0 = _mm256_mul_epi32(_mm256_loadu_si256((const __m256i *)(y + i)), _mm256_cvtepi16_epi64(wv));
+        __m256i p1 = _mm256_mul_epi32(_mm256_loadu_si256((const __m256i *)(y + i + 4)),
+                                      _mm256_cvtepi16_epi64(_mm_srli_si128(wv, 8)));
+        p0 = _mm256_srli_epi64(_mm256_add_epi64(p0, round), 15);
+        p1 = _mm256_srli_epi64(_mm256_add_epi64(p1, round), 15);
+        // Lanes hold samples 0 4 1 5 | 2 6 3 7
+        __m256i v = _mm256_permutevar8x32_epi32(_mm256_blend_epi32(p0, _mm256_slli_epi64(p1, 32), 0xAA), order);
+
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        __m256i sum = _mm256_add_epi32(a, v);
+        __m256i overflow = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(sum, a), _mm256_xor_si256(sum, v)), 31);
+        __m256i sat = _mm256_xor_si256(_mm256_srai_epi32(a, 31), max);
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_blendv_epi8(sum, sat, overflow));
+    }
+    mul_add_q15_scalar(acc + i, y + i, w + i, n - i);
+}
+
+// F16C ships with every AVX2 CPU; cpu_supports checks for it anyway
+__attribute__((target("avx2,f16c")))
+static void to_half_avx2(uint16_t *dst, const float *src, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128((__m128i *)(dst + i), h);
+    }
+    to_half_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2,f16c")))
+static void from_half_avx2(float *dst, const uint16_t *src, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+    }
+    from_half_scalar(dst + i, src + i, n - i);
+}
+
+// Split eight interleaved stereo frames held in a and b into left and right
+__attribute__((target("avx2")))
+static void split_stereo_avx2(__m256 a, __m256 b, __m256 *left, __m256 *right) {
+    // In-lane shuffles leave the frames in 0,1,4,5 | 2,3,6,7 order; fix it across lanes
+    __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    *left = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+    *right = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2")))
+static void deinterleave_avx2(const float *src, int channels, float *const *planes, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        memcpy(planes[0], src, sizeof(float) * frames);
+        return;
+    }
+    if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256 l, r;
+            split_stereo_avx2(_mm256_loadu_ps(src + 2 * i), _mm256_loadu_ps(src + 2 * i + 8), &l, &r);
+            _mm256_storeu_ps(planes[0] + i, l);
+            _mm256_storeu_ps(planes[1] + i, r);
+        }
+    }
+    deinterleave_from(src, channels, planes, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void interleave_avx2(const float *const *planes, int channels, float *dst, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        memcpy(dst, planes[0], sizeof(float) * frames);
+        return;
+    }
+    if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256 l = _mm256_loadu_ps(planes[0] + i);
+            __m256 r = _mm256_loadu_ps(planes[1] + i);
+            __m256 lo = _mm256_unpacklo_ps(l, r);  // frames 0,1 | 4,5
+            __m256 hi = _mm256_unpackhi_ps(l, r);  // frames 2,3 | 6,7
+            _mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    }
+    interleave_from(planes, channels, dst, i, frames);
+}
+
+__attribute__((target("avx2")))
+static __m256 s16_to_ps_avx2(__m128i v) {
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), _mm256_set1_ps(1.0f / 32768.0f));
+}
+
+__attribute__((target("avx2")))
+static void deinterleave_s16_avx2(const int16_t *src, int channels, float *const *planes, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            _mm256_storeu_ps(planes[0] + i, s16_to_ps_avx2(_mm_loadu_si128((const __m128i *)(src + i))));
+        }
+    } else if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256 a = s16_to_ps_avx2(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+            __m256 b = s16_to_ps_avx2(_mm_loadu_si128((const __m128i *)(src + 2 * i + 8)));
+            __m256 l, r;
+            split_stereo_avx2(a, b, &l, &r);
+            _mm256_storeu_ps(planes[0] + i, l);
+            _mm256_storeu_ps(planes[1] + i, r);
+        }
+    }
+    deinterleave_s16_from(src, channels, planes, i, frames);
+}
+
+// Eight floats to eight int16, through double exactly like float_to_s16
+__attribute__((target("avx2")))
+static __m128i to_s16_avx2(__m256 x) {
+    const __m256d scale = _mm256_set1_pd(32767.0);
+    const __m256d hi = _mm256_set1_pd(32767.0);
+    const __m256d lo = _mm256_set1_pd(-32768.0);
+    __m256d d0 = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(x)), scale);
+    __m256d d1 = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)), scale);
+    d0 = _mm256_max_pd(_mm256_min_pd(d0, hi), lo);
+    d1 = _mm256_max_pd(_mm256_min_pd(d1, hi), lo);
+    return _mm_packs_epi32(_mm256_cvtpd_epi32(d0), _mm256_cvtpd_epi32(d1));
+}
+
+__attribute__((target("avx2")))
+static void interleave_s16_avx2(const float *const *planes, int channels, int16_t *dst, int frames) {
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            _mm_storeu_si128((__m128i *)(dst + i), to_s16_avx2(_mm256_loadu_ps(planes[0] + i)));
+        }
+    } else if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256 l = _mm256_loadu_ps(planes[0] + i);
+            __m256 r = _mm256_loadu_ps(planes[1] + i);
+            __m256 lo = _mm256_unpacklo_ps(l, r);
+            __m256 hi = _mm256_unpackhi_ps(l, r);
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), to_s16_avx2(_mm256_permute2f128_ps(lo, hi, 0x20)));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i + 8), to_s16_avx2(_mm256_permute2f128_ps(lo, hi, 0x31)));
+        }
+    }
+    interleave_s16_from(planes, channels, dst, i, frames);
+}
+
+// Biquad wavefront: every section in one register, rotated up one lane
+__attribute__((target("avx2")))
+static void biquad_avx2(const float *coef, float *state, const float *in, float *out, int steps) {
+    const int L = BIQUAD_LANES;
+    const __m256i up = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+    __m256 b0 = _mm256_loadu_ps(coef), b1 = _mm256_loadu_ps(coef + L), b2 = _mm256_loadu_ps(coef + 2 * L);
+    __m256 a1 = _mm256_loadu_ps(coef + 3 * L), a2 = _mm256_loadu_ps(coef + 4 * L);
+    __m256 y = _mm256_loadu_ps(state), s1 = _mm256_loadu_ps(state + L), s2 = _mm256_loadu_ps(state + 2 * L);
+    for (int i = 0; i < steps; i++) {
+        __m256 x = _mm256_blend_ps(_mm256_permutevar8x32_ps(y, up), _mm256_set1_ps(in[i]), 1);
+        y = _mm256_add_ps(_mm256_mul_ps(b0, x), s1);
+        s1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, x), _mm256_mul_ps(a1, y)), s2);
+        s2 = _mm256_sub_ps(_mm256_mul_ps(b2, x), _mm256_mul_ps(a2, y));
+        __m128 hi = _mm256_extractf128_ps(y, 1);
+        out[i] = _mm_cvtss_f32(_mm_shuffle_ps(hi, hi, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    _mm256_storeu_ps(state, y);
+    _mm256_storeu_ps(state + L, s1);
+    _mm256_storeu_ps(state + 2 * L, s2);
+}
+
+__attribute__((target("avx2")))
+static void biquad_f64_avx2(const double *coef, double *state, const double *in, double *out, int steps) {
+    const int L = BIQUAD_LANES_F64;
+    __m256d b0 = _mm256_loadu_pd(coef), b1 = _mm256_loadu_pd(coef + L), b2 = _mm256_loadu_pd(coef + 2 * L);
+    __m256d a1 = _mm256_loadu_pd(coef + 3 * L), a2 = _mm256_loadu_pd(coef + 4 * L);
+    __m256d y = _mm256_loadu_pd(state), s1 = _mm256_loadu_pd(state + L), s2 = _mm256_loadu_pd(state + 2 * L);
+    for (int i = 0; i < steps; i++) {
+        __m256d x = _mm256_blend_pd(_mm256_permute4x64_pd(y, _MM_SHUFFLE(2, 1, 0, 3)), _mm256_set1_pd(in[i]), 1);
+        y = _mm256_add_pd(_mm256_mul_pd(b0, x), s1);
+        s1 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b1, x), _mm256_mul_pd(a1, y)), s2);
+        s2 = _mm256_sub_pd(_mm256_mul_pd(b2, x), _mm256_mul_pd(a2, y));
+        __m128d hi = _mm256_extractf128_pd(y, 1);
+        out[i] = _mm_cvtsd_f64(_mm_unpackhi_pd(hi, hi));
+    }
+    _mm256_storeu_pd(state, y);
+    _mm256_storeu_pd(state + L, s1);
+    _mm256_storeu_pd(state + 2 * L, s2);
+}
+
+__attribute__((target("avx2")))
+static void sd_bits_avx2(const uint32_t *sums, int count, int shift, uint64_t *words) {
+    __m128i sh = _mm_cvtsi32_si128(shift);
+    __m256i zero = _mm256_setzero_si256();
+    int k = 0;
+    for (; 64 * k + 64 <= count; k++) {
+        const uint32_t *s = sums + 64 * k;
+        uint64_t w = 0;
+        for (int i = 0; i < 64; i += 8) {
+            __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(s + i + 1)), _mm256_loadu_si256((const __m256i *)(s + i)));
+            int same = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_srl_epi32(d, sh), zero)));
+            w |= (uint64_t)(same ^ 0xff) << i;
+        }
+        words[k] = w;
+    }
+    sd_bits_scalar(sums + 64 * k, count - 64 * k, shift, words + k);
+}
+
+static const dsp_kernels kernels_avx2 = {
+    "avx2",
+    mul_avx2, mul_add_avx2, cmul_avx2, cmul_add_avx2, dot_avx2,
+    window_q15_avx2, butterfly_q31_avx2, cmul_q31_avx2, mul_add_q15_avx2,
+    to_half_avx2, from_half_avx2,
+    biquad_avx2, biquad_f64_avx2, sd_bits_avx2,
+    deinterleave_avx2, interleave_avx2, deinterleave_s16_avx2, interleave_s16_avx2,
+};
+
+// ---------------------------------------------------------------------------
+// AVX-512: 16 floats / 8 complex bins per step. The (de)interleave kernels
+// are bound by memory bandwidth, not shuffles, so they stay on AVX2; the dot
+// product does too, as 16 lanes would sum in a different order, and so do
+// the fixed-point kernels and the biquad wavefront, whose eight sections
+// already fill an AVX2 register.
+
+__attribute__((target("avx512f")))
+static void mul_avx512(float *dst, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    mul_avx2(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void mul_add_avx512(float *acc, const float *a, const float *b, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 p = _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        _mm512_storeu_ps(acc + i, _mm512_add_ps(_mm512_loadu_ps(acc + i), p));
+    }
+    mul_add_avx2(acc + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static __m512 cmul8_avx512(__m512 x, __m512 g) {
+    __m512 t1 = _mm512_mul_ps(x, _mm512_moveldup_ps(g));
+    __m512 t2 = _mm512_mul_ps(_mm512_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)), _mm512_movehdup_ps(g));
+    // Real lanes (even) subtract, imaginary lanes (odd) add
+    return _mm512_mask_sub_ps(_mm512_add_ps(t1, t2), 0x5555, t1, t2);
+}
+
+__attribute__((target("avx512f")))
+static void cmul_avx512(fft_cpx *x, const fft_cpx *g, int n) {
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        float *px = (float *)(x + k);
+        _mm512_storeu_ps(px, cmul8_avx512(_mm512_loadu_ps(px), _mm512_loadu_ps((const float *)(g + k))));
+    }
+    cmul_avx2(x + k, g + k, n - k);
+}
+
+__attribute__((target("avx512f")))
+static void cmul_add_avx512(fft_cpx *acc, const fft_cpx *x, const fft_cpx *h, int n) {
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        float *pa = (float *)(acc + k);
+        __m512 p = cmul8_avx512(_mm512_loadu_ps((const float *)(x + k)), _mm512_loadu_ps((const float *)(h + k)));
+        _mm512_storeu_ps(pa, _mm512_add_ps(_mm512_loadu_ps(pa), p));
+    }
+    cmul_add_avx2(acc + k, x + k, h + k, n - k);
+}
+
+__attribute__((target("avx512f")))
+static void sd_bits_avx512(const uint32_t *sums, int count, int shift, uint64_t *words) {
+    __m128i sh = _mm_cvtsi32_si128(shift);
+    int k = 0;
+    for (; 64 * k + 64 <= count; k++) {
+        const uint32_t *s = sums + 64 * k;
+        uint64_t w = 0;
+        for (int i = 0; i < 64; i += 16) {
+            __m512i d = _mm512_xor_si512(_mm512_loadu_si512(s + i + 1), _mm512_loadu_si512(s + i));
+            d = _mm512_srl_epi32(d, sh);
+            w |= (uint64_t)_mm512_test_epi32_mask(d, d) << i;
+        }
+        words[k] = w;
+    }
+    sd_bits_scalar(sums + 64 * k, count - 64 * k, shift, words + k);
+}
+
+static const dsp_kernels kernels_avx512 = {
+    "avx512",
+    mul_avx512, mul_add_avx512, cmul_avx512, cmul_add_avx512, dot_avx2,
+    window_q15_avx2, butterfly_q31_avx2, cmul_q31_avx2, mul_add_q15_avx2,
+    to_half_avx2, from_half_avx2,
+    biquad_avx2, biquad_f64_avx2, sd_bits_avx512,
+    deinterleave_avx2, interleave_avx2, deinterleave_s16_avx2, interleave_s16_avx2,
+};
+
+#endif  // DSP_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const dsp_kernels *selected;
+static pthread_once_t selectOnce = PTHREAD_ONCE_INIT;
+
+static int cpu_supports(const dsp_kernels *k) {
+#ifdef DSP_X86
+    __builtin_cpu_init();
+    if (k == &kernels_avx512) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    }
+    if (k == &kernels_avx2) {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    }
+    if (k == &kernels_sse2) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return k == &kernels_scalar;
+}
+
+// Fastest first
+static const dsp_kernels *const variants[] = {
+#ifdef DSP_X86
+    &kernels_avx512,
+    &kernels_avx2,
+    &kernels_sse2,
+#endif
+    &kernels_scalar,
+};
+
+static void select_best(void) {
+    if (selected != NULL) {
+        return;  // forced by dsp_kernels_select
+    }
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        if (cpu_supports(variants[v])) {
+            selected = variants[v];
+            return;
+        }
+    }
+}
+
+const dsp_kernels *dsp_kernels_get(void) {
+    pthread_once(&selectOnce, select_best);
+    return selected;
+}
+
+int dsp_kernels_select(const char *name) {
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        if (strcmp(name, variants[v]->name) == 0 && cpu_supports(variants[v])) {
+            selected = variants[v];
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,77 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <stdint.h>
+#include "fft.h"
+#include "fft_fixed.h"
+
+#define BIQUAD_LANES 8      // biquad sections per wavefront, float
+#define BIQUAD_LANES_F64 4  // the same in double precision
+
+// The per-sample and per-bin loops of the filters. Every instruction-set
+// variant produces bit-identical results to the scalar one: products and
+// sums are evaluated in the same order and never fused, so a file filtered
+// on an AVX-512 host matches the one filtered on an SSE2 host.
+typedef struct {
+    const char *name;
+
+    // dst[i] = a[i] * b[i]; dst may be a (window application, OLA normalization)
+    void (*mul)(float *dst, const float *a, const float *b, int n);
+    // acc[i] += a[i] * b[i] (windowed overlap-add)
+    void (*mul_add)(float *acc, const float *a, const float *b, int n);
+    // x[k] *= g[k], complex (spectral gain)
+    void (*cmul)(fft_cpx *x, const fft_cpx *g, int n);
+    // acc[k] += x[k] * h[k], complex (partitioned convolution)
+    void (*cmul_add)(fft_cpx *acc, const fft_cpx *x, const fft_cpx *h, int n);
+    // sum of a[i] * b[i] (FIR filters)
+    float (*dot)(const float *a, const float *b, int n);
+
+    // Fixed-point path (stft_fixed.h). Q15 samples and windows, Q31
+    // twiddles and gains; every shift rounds half up, (x + 2^(s-1)) >> s.
+    // dst[i] = round(x[i] * w[i] / 2): Q15 * Q15 -> Q29, inside +-FFT_FIXED_MAX
+    void (*window_q15)(int32_t *dst, const int16_t *x, const int16_t *w, int n);
+    // n radix-2 butterflies: t = round(b[j] * tw[j] / 2^31), then
+    // a[j] = round((a[j] + t) / 2) and b[j] = round((a[j] - t) / 2)
+    void (*butterfly_q31)(fft_fixed_cpx *a, fft_fixed_cpx *b, const fft_fixed_cpx *tw, int n);
+    // x[k] = round(x[k] * g[k] / 2^shift), complex, saturated to +-FFT_FIXED_MAX
+    void (*cmul_q31)(fft_fixed_cpx *x, const fft_fixed_cpx *g, int shift, int n);
+    // acc[i] = sat32(acc[i] + round(y[i].r * w[i] / 2^15)) (windowed overlap-add)
+    void (*mul_add_q15)(int32_t *acc, const fft_fixed_cpx *y, const int16_t *w, int n);
+
+    // IEEE half precision <-> float (spectrum cache), rounding to nearest even
+    void (*to_half)(uint16_t *dst, const float *src, int n);
+    void (*from_half)(float *dst, const uint16_t *src, int n);
+
+    // Biquad cascade (biquad.h) as a wavefront of L = BIQUAD_LANES sections
+    // in transposed direct form II: at each step section b filters what
+    // section b - 1 produced one step earlier, so all L run at once. coef is
+    // b0, b1, b2, a1, a2 and state y, s1, s2, L entries each. Step i feeds
+    // in[i] to section 0 and writes the last section's output to out[i]:
+    //   x = b ? y[b-1] : in[i];  y[b] = b0*x + s1;
+    //   s1 = b1*x - a1*y[b] + s2;  s2 = b2*x - a2*y[b]
+    // out may be in - (L - 1).
+    void (*biquad)(const float *coef, float *state, const float *in, float *out, int steps);
+    void (*biquad_f64)(const double *coef, double *state, const double *in, double *out, int steps);
+
+    // First-order sigma-delta bits (modulator.h) from count + 1 wrapping
+    // running sums: bit i is 1 where sums[i + 1] >> shift differs from
+    // sums[i] >> shift. Packed LSB first into (count + 63) / 64 words, the
+    // bits past count zero.
+    void (*sd_bits)(const uint32_t *sums, int count, int shift, uint64_t *words);
+
+    // Interleaved frames <-> one buffer per channel
+    void (*deinterleave)(const float *src, int channels, float *const *planes, int frames);
+    void (*interleave)(const float *const *planes, int channels, float *dst, int frames);
+    // The same with PCM16 conversion: x / 32768 in, clip(rint(x * 32767)) out
+    void (*deinterleave_s16)(const int16_t *src, int channels, float *const *planes, int frames);
+    void (*interleave_s16)(const float *const *planes, int channels, int16_t *dst, int frames);
+} dsp_kernels;
+
+// Best variant this CPU supports, chosen on first use
+const dsp_kernels *dsp_kernels_get(void);
+
+// Force a variant by name ("scalar", "sse2", "avx2", "avx512") before any
+// filter is created. Returns -1 if it is unknown or the CPU lacks it.
+int dsp_kernels_select(const char *name);
+
+#endif
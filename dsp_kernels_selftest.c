@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dsp_kernels.h"
+
+// Runs every entry of each kernel table this CPU supports on random inputs
+// and fails unless the output matches the scalar table byte for byte:
+//
+//   ./dsp_kernels_selftest
+//
+// Lengths cover zero, odd sizes, sizes under one vector and the tails past
+// every vector width; every buffer is also tried one element off its
+// alignment. Variants the CPU lacks are skipped.
+
+#define KERNEL_TEST_MAX 1100          // longest buffer, in elements
+#define KERNEL_TEST_CHANNELS 8        // most channels the interleave kernels see
+
+static const int lengths[] = {0, 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 129, 1000, 1031};
+static const int channelCounts[] = {1, 2, 3, 4, 5, 6, 8};
+static const int sdShifts[] = {8, 24, 31};
+static const int q31Shifts[] = {1, 17, 31};
+
+typedef struct {
+    const dsp_kernels *ref;   // scalar
+    const dsp_kernels *k;     // variant under test
+    int n;
+    int offset;               // elements past the aligned start of each buffer
+    int failures;
+} kernel_test;
+
+// Inputs, and the scalar and variant outputs; _r and _v pairs start equal
+static _Alignas(64) float fa[KERNEL_TEST_MAX], fb[KERNEL_TEST_MAX], fr[KERNEL_TEST_MAX], fv[KERNEL_TEST_MAX];
+static _Alignas(64) double da[KERNEL_TEST_MAX], dr[KERNEL_TEST_MAX], dv[KERNEL_TEST_MAX];
+static _Alignas(64) fft_cpx ca[KERNEL_TEST_MAX], cb[KERNEL_TEST_MAX], cr[KERNEL_TEST_MAX], cv[KERNEL_TEST_MAX];
+static _Alignas(64) fft_fixed_cpx qa[KERNEL_TEST_MAX], qb[KERNEL_TEST_MAX], qc[KERNEL_TEST_MAX];
+static _Alignas(64) fft_fixed_cpx qr[2][KERNEL_TEST_MAX], qv[2][KERNEL_TEST_MAX];
+static _Alignas(64) int16_t sa[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS], sb[KERNEL_TEST_MAX];
+static _Alignas(64) int16_t sr[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS], sv[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS];
+static _Alignas(64) int32_t ir[KERNEL_TEST_MAX], iv[KERNEL_TEST_MAX];
+static _Alignas(64) uint32_t ua[KERNEL_TEST_MAX];
+static _Alignas(64) uint16_t hr[KERNEL_TEST_MAX], hv[KERNEL_TEST_MAX];
+static _Alignas(64) uint64_t wr[KERNEL_TEST_MAX / 64 + 2], wv[KERNEL_TEST_MAX / 64 + 2];
+static _Alignas(64) float ia[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS];
+static _Alignas(64) float ilr[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS], ilv[KERNEL_TEST_MAX * KERNEL_TEST_CHANNELS];
+static _Alignas(64) float pa[KERNEL_TEST_CHANNELS][KERNEL_TEST_MAX];
+static _Alignas(64) float pr[KERNEL_TEST_CHANNELS][KERNEL_TEST_MAX], pv[KERNEL_TEST_CHANNELS][KERNEL_TEST_MAX];
+
+static uint32_t rand_u32(void) {
+    return (uint32_t)rand() << 16 ^ (uint32_t)rand();
+}
+
+// Uniform in [-scale, scale)
+static float rand_float(float scale) {
+    return ((float)(rand_u32() >> 8) * (1.0f / 8388608.0f) - 1.0f) * scale;
+}
+
+// Uniform in [-limit, limit]
+static int32_t rand_range(int32_t limit) {
+    return (int32_t)((int64_t)(rand_u32() % ((uint32_t)limit * 2 + 1)) - limit);
+}
+
+static void fill_float(float *p, int n, float scale) {
+    for (int i = 0; i < n; i++) {
+        p[i] = rand_float(scale);
+    }
+}
+
+static void fill_cpx(fft_cpx *p, int n) {
+    for (int i = 0; i < n; i++) {
+        p[i].r = rand_float(1.0f);
+        p[i].i = rand_float(1.0f);
+    }
+}
+
+static void fill_fixed(fft_fixed_cpx *p, int n, int32_t limit) {
+    for (int i = 0; i < n; i++) {
+        p[i].r = rand_range(limit);
+        p[i].i = rand_range(limit);
+    }
+}
+
+static void fill_s16(int16_t *p, int n) {
+    for (int i = 0; i < n; i++) {
+        p[i] = (int16_t)rand_u32();
+    }
+}
+
+static void check(kernel_test *t, const char *kernel, const void *ref, const void *out, size_t bytes) {
+    if (memcmp(ref, out, bytes) != 0) {
+        printf("FAIL %s %s, length %d, offset %d\n", t->k->name, kernel, t->n, t->offset);
+        t->failures++;
+    }
+}
+
+static void test_float(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    float *a = fa + o, *b = fb + o, *r = fr + o, *v = fv + o;
+    fill_float(a, n, 1.0f);
+    fill_float(b, n, 2.0f);
+
+    t->ref->mul(r, a, b, n);
+    t->k->mul(v, a, b, n);
+    check(t, "mul", r, v, sizeof(float) * n);
+
+    memcpy(r, a, sizeof(float) * n);  // in place, as the window stage runs it
+    memcpy(v, a, sizeof(float) * n);
+    t->ref->mul(r, r, b, n);
+    t->k->mul(v, v, b, n);
+    check(t, "mul in place", r, v, sizeof(float) * n);
+
+    fill_float(r, n, 4.0f);
+    memcpy(v, r, sizeof(float) * n);
+    t->ref->mul_add(r, a, b, n);
+    t->k->mul_add(v, a, b, n);
+    check(t, "mul_add", r, v, sizeof(float) * n);
+
+    float dotRef = t->ref->dot(a, b, n);
+    float dotOut = t->k->dot(a, b, n);
+    check(t, "dot", &dotRef, &dotOut, sizeof(float));
+
+    fft_cpx *x = ca + o, *g = cb + o, *cr1 = cr + o, *cv1 = cv + o;
+    fill_cpx(x, n);
+    fill_cpx(g, n);
+    memcpy(cr1, x, sizeof(fft_cpx) * n);
+    memcpy(cv1, x, sizeof(fft_cpx) * n);
+    t->ref->cmul(cr1, g, n);
+    t->k->cmul(cv1, g, n);
+    check(t, "cmul", cr1, cv1, sizeof(fft_cpx) * n);
+
+    t->ref->cmul_add(cr1, x, g, n);
+    t->k->cmul_add(cv1, x, g, n);
+    check(t, "cmul_add", cr1, cv1, sizeof(fft_cpx) * n);
+}
+
+static void test_fixed(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    int16_t *x = sa + o, *w = sb + o;
+    fill_s16(x, n);
+    fill_s16(w, n);
+    t->ref->window_q15(ir + o, x, w, n);
+    t->k->window_q15(iv + o, x, w, n);
+    check(t, "window_q15", ir + o, iv + o, sizeof(int32_t) * n);
+
+    // Butterfly inputs within the FFT's range, twiddles anywhere in Q31
+    fft_fixed_cpx *tw = qc + o;
+    fill_fixed(qa + o, n, FFT_FIXED_MAX);
+    fill_fixed(qb + o, n, FFT_FIXED_MAX);
+    fill_fixed(tw, n, INT32_MAX);
+    memcpy(qr[0] + o, qa + o, sizeof(fft_fixed_cpx) * n);
+    memcpy(qr[1] + o, qb + o, sizeof(fft_fixed_cpx) * n);
+    memcpy(qv[0] + o, qa + o, sizeof(fft_fixed_cpx) * n);
+    memcpy(qv[1] + o, qb + o, sizeof(fft_fixed_cpx) * n);
+    t->ref->butterfly_q31(qr[0] + o, qr[1] + o, tw, n);
+    t->k->butterfly_q31(qv[0] + o, qv[1] + o, tw, n);
+    check(t, "butterfly_q31 a", qr[0] + o, qv[0] + o, sizeof(fft_fixed_cpx) * n);
+    check(t, "butterfly_q31 b", qr[1] + o, qv[1] + o, sizeof(fft_fixed_cpx) * n);
+
+    // Small shifts with full-scale gains saturate, which has to match too
+    for (size_t s = 0; s < sizeof(q31Shifts) / sizeof(q31Shifts[0]); s++) {
+        memcpy(qr[0] + o, qa + o, sizeof(fft_fixed_cpx) * n);
+        memcpy(qv[0] + o, qa + o, sizeof(fft_fixed_cpx) * n);
+        t->ref->cmul_q31(qr[0] + o, tw, q31Shifts[s], n);
+        t->k->cmul_q31(qv[0] + o, tw, q31Shifts[s], n);
+        check(t, "cmul_q31", qr[0] + o, qv[0] + o, sizeof(fft_fixed_cpx) * n);
+    }
+
+    for (int i = 0; i < n; i++) {
+        ir[o + i] = (int32_t)rand_u32();  // near the ends sometimes, to saturate
+    }
+    memcpy(iv + o, ir + o, sizeof(int32_t) * n);
+    t->ref->mul_add_q15(ir + o, qa + o, w, n);
+    t->k->mul_add_q15(iv + o, qa + o, w, n);
+    check(t, "mul_add_q15", ir + o, iv + o, sizeof(int32_t) * n);
+}
+
+static void test_half(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    float *src = fa + o;
+    // Every other value an arbitrary bit pattern: NaNs, infinities,
+    // subnormals and overflows as well as ordinary samples
+    for (int i = 0; i < n; i++) {
+        uint32_t bits = rand_u32();
+        if (i % 2 == 0) {
+            memcpy(&src[i], &bits, sizeof(bits));
+        } else {
+            src[i] = rand_float(70000.0f);
+        }
+    }
+    t->ref->to_half(hr + o, src, n);
+    t->k->to_half(hv + o, src, n);
+    check(t, "to_half", hr + o, hv + o, sizeof(uint16_t) * n);
+
+    for (int i = 0; i < n; i++) {
+        hr[o + i] = (uint16_t)rand_u32();
+    }
+    t->ref->from_half(fr + o, hr + o, n);
+    t->k->from_half(fv + o, hr + o, n);
+    check(t, "from_half", fr + o, fv + o, sizeof(float) * n);
+}
+
+static void test_biquad(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    float coef[5 * BIQUAD_LANES], stateRef[3 * BIQUAD_LANES], stateOut[3 * BIQUAD_LANES];
+    fill_float(coef, 5 * BIQUAD_LANES, 0.5f);
+    fill_float(stateRef, 3 * BIQUAD_LANES, 1.0f);
+    memcpy(stateOut, stateRef, sizeof(stateRef));
+    fill_float(fa + o, n, 1.0f);
+    t->ref->biquad(coef, stateRef, fa + o, fr + o, n);
+    t->k->biquad(coef, stateOut, fa + o, fv + o, n);
+    check(t, "biquad", fr + o, fv + o, sizeof(float) * n);
+    check(t, "biquad state", stateRef, stateOut, sizeof(stateRef));
+
+    // In place, out = in - (L - 1), as biquad.c runs it
+    int span = n + BIQUAD_LANES - 1;
+    fill_float(fr + o, span, 1.0f);
+    memcpy(fv + o, fr + o, sizeof(float) * span);
+    t->ref->biquad(coef, stateRef, fr + o + BIQUAD_LANES - 1, fr + o, n);
+    t->k->biquad(coef, stateOut, fv + o + BIQUAD_LANES - 1, fv + o, n);
+    check(t, "biquad in place", fr + o, fv + o, sizeof(float) * span);
+    check(t, "biquad in place state", stateRef, stateOut, sizeof(stateRef));
+
+    double coef64[5 * BIQUAD_LANES_F64], state64Ref[3 * BIQUAD_LANES_F64], state64Out[3 * BIQUAD_LANES_F64];
+    for (int i = 0; i < 5 * BIQUAD_LANES_F64; i++) {
+        coef64[i] = rand_float(0.5f);
+    }
+    for (int i = 0; i < 3 * BIQUAD_LANES_F64; i++) {
+        state64Ref[i] = state64Out[i] = rand_float(1.0f);
+    }
+    for (int i = 0; i < n; i++) {
+        da[o + i] = rand_float(1.0f);
+    }
+    t->ref->biquad_f64(coef64, state64Ref, da + o, dr + o, n);
+    t->k->biquad_f64(coef64, state64Out, da + o, dv + o, n);
+    check(t, "biquad_f64", dr + o, dv + o, sizeof(double) * n);
+    check(t, "biquad_f64 state", state64Ref, state64Out, sizeof(state64Ref));
+
+    span = n + BIQUAD_LANES_F64 - 1;
+    for (int i = 0; i < span; i++) {
+        dr[o + i] = dv[o + i] = rand_float(1.0f);
+    }
+    t->ref->biquad_f64(coef64, state64Ref, dr + o + BIQUAD_LANES_F64 - 1, dr + o, n);
+    t->k->biquad_f64(coef64, state64Out, dv + o + BIQUAD_LANES_F64 - 1, dv + o, n);
+    check(t, "biquad_f64 in place", dr + o, dv + o, sizeof(double) * span);
+}
+
+static void test_sd_bits(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    size_t words = (size_t)(n + 63) / 64;
+    for (size_t s = 0; s < sizeof(sdShifts) / sizeof(sdShifts[0]); s++) {
+        // A wrapping walk with steps up to twice 2^shift, so some steps
+        // cross no boundary, some one and some two
+        uint32_t step = sdShifts[s] == 31 ? UINT32_MAX : (2u << sdShifts[s]) - 1;
+        ua[o] = rand_u32();
+        for (int i = 1; i <= n; i++) {
+            ua[o + i] = ua[o + i - 1] + rand_u32() % step;
+        }
+        memset(wr, 0xa5, sizeof(wr));  // bits past count must come out zero
+        memset(wv, 0xa5, sizeof(wv));
+        t->ref->sd_bits(ua + o, n, sdShifts[s], wr);
+        t->k->sd_bits(ua + o, n, sdShifts[s], wv);
+        check(t, "sd_bits", wr, wv, sizeof(uint64_t) * (words + 1));
+    }
+}
+
+static void test_interleave(kernel_test *t) {
+    int n = t->n, o = t->offset;
+    float *planesRef[KERNEL_TEST_CHANNELS], *planesOut[KERNEL_TEST_CHANNELS];
+    const float *planesIn[KERNEL_TEST_CHANNELS];
+    for (int c = 0; c < KERNEL_TEST_CHANNELS; c++) {
+        planesRef[c] = pr[c] + o;
+        planesOut[c] = pv[c] + o;
+        planesIn[c] = pa[c] + o;
+    }
+    for (size_t cc = 0; cc < sizeof(channelCounts) / sizeof(channelCounts[0]); cc++) {
+        int channels = channelCounts[cc];
+        size_t samples = (size_t)n * channels;
+
+        fill_float(ia + o, (int)samples, 1.0f);
+        t->ref->deinterleave(ia + o, channels, planesRef, n);
+        t->k->deinterleave(ia + o, channels, planesOut, n);
+        for (int c = 0; c < channels; c++) {
+            check(t, "deinterleave", planesRef[c], planesOut[c], sizeof(float) * n);
+        }
+
+        fill_s16(sa + o, (int)samples);
+        t->ref->deinterleave_s16(sa + o, channels, planesRef, n);
+        t->k->deinterleave_s16(sa + o, channels, planesOut, n);
+        for (int c = 0; c < channels; c++) {
+            check(t, "deinterleave_s16", planesRef[c], planesOut[c], sizeof(float) * n);
+        }
+
+        // Past full scale now and then, so the PCM16 conversion clips
+        for (int c = 0; c < channels; c++) {
+            fill_float(pa[c] + o, n, 1.25f);
+        }
+        t->ref->interleave(planesIn, channels, ilr + o, n);
+        t->k->interleave(planesIn, channels, ilv + o, n);
+        check(t, "interleave", ilr + o, ilv + o, sizeof(float) * samples);
+
+        t->ref->interleave_s16(planesIn, channels, sr + o, n);
+        t->k->interleave_s16(planesIn, channels, sv + o, n);
+        check(t, "interleave_s16", sr + o, sv + o, sizeof(int16_t) * samples);
+    }
+}
+
+int main(void) {
+    static const char *const names[] = {"sse2", "avx2", "avx512"};
+    if (dsp_kernels_select("scalar") != 0) {
+        fprintf(stderr, "Error: The scalar kernels are not available\n");
+        return 1;
+    }
+    const dsp_kernels *ref = dsp_kernels_get();
+
+    int failed = 0;
+    for (size_t v = 0; v < sizeof(names) / sizeof(names[0]); v++) {
+        if (dsp_kernels_select(names[v]) != 0) {
+            printf("skip %s: not supported here\n", names[v]);
+            continue;
+        }
+        kernel_test t = {ref, dsp_kernels_get(), 0, 0, 0};
+        srand(12345);
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            for (t.offset = 0; t.offset < 2; t.offset++) {
+                t.n = lengths[l];
+                test_float(&t);
+                test_fixed(&t);
+                test_half(&t);
+                test_biquad(&t);
+                test_sd_bits(&t);
+                test_interleave(&t);
+            }
+        }
+        if (t.failures == 0) {
+            printf("ok   %s: every kernel matches scalar over %zu lengths\n", names[v],
+                   sizeof(lengths) / sizeof(lengths[0]));
+        }
+        failed += t.failures > 0;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "Error: %d kernel variant(s) differ from the scalar kernels\n", failed);
+        return 1;
+    }
+    return 0;
+}
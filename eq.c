@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "eq.h"
+
+static const struct {
+    const char *name;
+    eq_band_type type;
+} band_names[] = {
+    {"peaking", EQ_PEAKING},
+    {"lowshelf", EQ_LOW_SHELF},
+    {"highshelf", EQ_HIGH_SHELF},
+    {"highpass", EQ_HIGHPASS},
+    {"lowpass", EQ_LOWPASS},
+};
+
+void eq_preset_default(eq_preset *eq) {
+    memset(eq, 0, sizeof(*eq));
+    eq->numBands = 1;
+    eq->bands[0].type = EQ_HIGHPASS;
+    eq->bands[0].freq = 500.0;
+    eq->bands[0].q = M_SQRT1_2;
+}
+
+const char *eq_band_type_name(eq_band_type type) {
+    for (size_t i = 0; i < sizeof(band_names) / sizeof(band_names[0]); i++) {
+        if (band_names[i].type == type) {
+            return band_names[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static int parse_band_type(const char *name, eq_band_type *type) {
+    for (size_t i = 0; i < sizeof(band_names) / sizeof(band_names[0]); i++) {
+        if (strcmp(name, band_names[i].name) == 0) {
+            *type = band_names[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int eq_parse_line(const char *line, eq_preset *eq, const char *where) {
+    char text[256];
+    snprintf(text, sizeof(text), "%s", line);
+    char *hash = strchr(text, '#');
+    if (hash != NULL) {
+        *hash = '\0';
+    }
+
+    char name[32];
+    double freq, gainDb, q;
+    int fields = sscanf(text, "%31s %lf %lf %lf", name, &freq, &gainDb, &q);
+    if (fields <= 0) {
+        return 0;  // blank or comment-only line
+    }
+
+    if (strcmp(name, "preamp") == 0) {
+        if (fields != 2) {
+            fprintf(stderr, "Error: %s: expected 'preamp <gain_db>'\n", where);
+            return -1;
+        }
+        eq->preampDb = freq;
+        return 0;
+    }
+
+    eq_band band;
+    if (parse_band_type(name, &band.type) != 0) {
+        fprintf(stderr, "Error: %s: unknown band type '%s'\n", where, name);
+        return -1;
+    }
+    if (fields != 4) {
+        fprintf(stderr, "Error: %s: expected '%s <freq_hz> <gain_db> <q>'\n", where, name);
+        return -1;
+    }
+    if (!(freq > 0.0) || !(q > 0.0)) {
+        fprintf(stderr, "Error: %s: frequency and Q must be positive\n", where);
+        return -1;
+    }
+    if (eq->numBands == EQ_MAX_BANDS) {
+        fprintf(stderr, "Error: %s: more than %d bands\n", where, EQ_MAX_BANDS);
+        return -1;
+    }
+    band.freq = freq;
+    band.gainDb = gainDb;
+    band.q = q;
+    eq->bands[eq->numBands++] = band;
+    return 0;
+}
+
+int eq_load_preset(const char *path, eq_preset *eq) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Could not open EQ preset '%s'\n", path);
+        return -1;
+    }
+
+    memset(eq, 0, sizeof(*eq));
+    char line[256];
+    int lineNo = 0;
+    int status = 0;
+    while (status == 0 && fgets(line, sizeof(line), f) != NULL) {
+        char where[300];
+        snprintf(where, sizeof(where), "%s:%d", path, ++lineNo);
+        status = eq_parse_line(line, eq, where);
+    }
+
+    fclose(f);
+    return status;
+}
+
+void eq_band_design(const eq_band *band, double sampleRate, eq_biquad *bq) {
+    // Keep the corner strictly below Nyquist so the design stays stable
+    double freq = band->freq < 0.499 * sampleRate ? band->freq : 0.499 * sampleRate;
+    double w0 = 2.0 * M_PI * freq / sampleRate;
+    double cw = cos(w0);
+    double alpha = sin(w0) / (2.0 * band->q);
+    double A = pow(10.0, band->gainDb / 40.0);
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (band->type) {
+    case EQ_PEAKING:
+        b0 = 1.0 + alpha * A;
+        b1 = -2.0 * cw;
+        b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A;
+        a1 = -2.0 * cw;
+        a2 = 1.0 - alpha / A;
+        break;
+    case EQ_LOW_SHELF: {
+        double sa = 2.0 * sqrt(A) * alpha;
+        b0 = A * ((A + 1.0) - (A - 1.0) * cw + sa);
+        b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cw);
+        b2 = A * ((A + 1.0) - (A - 1.0) * cw - sa);
+        a0 = (A + 1.0) + (A - 1.0) * cw + sa;
+        a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cw);
+        a2 = (A + 1.0) + (A - 1.0) * cw - sa;
+        break;
+    }
+    case EQ_HIGH_SHELF: {
+        double sa = 2.0 * sqrt(A) * alpha;
+        b0 = A * ((A + 1.0) + (A - 1.0) * cw + sa);
+        b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cw);
+        b2 = A * ((A + 1.0) + (A - 1.0) * cw - sa);
+        a0 = (A + 1.0) - (A - 1.0) * cw + sa;
+        a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cw);
+        a2 = (A + 1.0) - (A - 1.0) * cw - sa;
+        break;
+    }
+    case EQ_HIGHPASS:
+        b0 = (1.0 + cw) / 2.0;
+        b1 = -(1.0 + cw);
+        b2 = (1.0 + cw) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cw;
+        a2 = 1.0 - alpha;
+        break;
+    case EQ_LOWPASS:
+    default:
+        b0 = (1.0 - cw) / 2.0;
+        b1 = 1.0 - cw;
+        b2 = (1.0 - cw) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cw;
+        a2 = 1.0 - alpha;
+        break;
+    }
+
+    bq->b0 = b0 / a0;
+    bq->b1 = b1 / a0;
+    bq->b2 = b2 / a0;
+    bq->a1 = a1 / a0;
+    bq->a2 = a2 / a0;
+}
+
+void eq_build_gain_table(const eq_preset *eq, double sampleRate, int frameSize, fft_cpx *gains) {
+    int numBins = frameSize / 2 + 1;
+    eq_biquad bq[EQ_MAX_BANDS];
+    for (int b = 0; b < eq->numBands; b++) {
+        eq_band_design(&eq->bands[b], sampleRate, &bq[b]);
+    }
+    double preamp = pow(10.0, eq->preampDb / 20.0);
+
+    for (int k = 0; k < numBins; k++) {
+        // Evaluate every biquad on the unit circle at the bin centre
+        double w = 2.0 * M_PI * k / frameSize;
+        double c1 = cos(w), s1 = -sin(w);            // z^-1
+        double c2 = cos(2.0 * w), s2 = -sin(2.0 * w);  // z^-2
+        double hr = preamp, hi = 0.0;
+
+        for (int b = 0; b < eq->numBands; b++) {
+            double nr = bq[b].b0 + bq[b].b1 * c1 + bq[b].b2 * c2;
+            double ni = bq[b].b1 * s1 + bq[b].b2 * s2;
+            double dr = 1.0 + bq[b].a1 * c1 + bq[b].a2 * c2;
+            double di = bq[b].a1 * s1 + bq[b].a2 * s2;
+            double den = dr * dr + di * di;
+            double gr = (nr * dr + ni * di) / den;
+            double gi = (ni * dr - nr * di) / den;
+
+            double tr = hr * gr - hi * gi;
+            hi = hr * gi + hi * gr;
+            hr = tr;
+        }
+
+        gains[k].r = (float)hr;
+        gains[k].i = (float)hi;
+    }
+}
+
+void eq_impulse_response(const eq_preset *eq, double sampleRate, float *ir, int taps) {
+    eq_biquad bq[EQ_MAX_BANDS];
+    double s1[EQ_MAX_BANDS] = {0};
+    double s2[EQ_MAX_BANDS] = {0};
+    for (int b = 0; b < eq->numBands; b++) {
+        eq_band_design(&eq->bands[b], sampleRate, &bq[b]);
+    }
+    double preamp = pow(10.0, eq->preampDb / 20.0);
+
+    // Run a unit impulse through the cascade (transposed direct form II)
+    for (int i = 0; i < taps; i++) {
+        double x = i == 0 ? preamp : 0.0;
+        for (int b = 0; b < eq->numBands; b++) {
+            double y = bq[b].b0 * x + s1[b];
+            s1[b] = bq[b].b1 * x - bq[b].a1 * y + s2[b];
+            s2[b] = bq[b].b2 * x - bq[b].a2 * y;
+            x = y;
+        }
+        ir[i] = (float)x;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef EQ_H
+#define EQ_H
+
+#include "fft.h"
+
+#define EQ_MAX_BANDS 64
+
+typedef enum {
+    EQ_PEAKING,
+    EQ_LOW_SHELF,
+    EQ_HIGH_SHELF,
+    EQ_HIGHPASS,
+    EQ_LOWPASS
+} eq_band_type;
+
+typedef struct {
+    eq_band_type type;
+    double freq;    // centre/corner frequency in Hz
+    double gainDb;  // peaking and shelf gain; ignored by highpass/lowpass
+    double q;
+} eq_band;
+
+typedef struct {
+    double preampDb;  // broadband gain applied on top of the bands
+    int numBands;
+    eq_band bands[EQ_MAX_BANDS];
+} eq_preset;
+
+// Normalized biquad: H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+typedef struct {
+    double b0, b1, b2;
+    double a1, a2;
+} eq_biquad;
+
+// The filter the tool applies when no preset is given: 2nd-order highpass at 500 Hz
+void eq_preset_default(eq_preset *eq);
+
+// Load a preset file. One band per line, "#" starts a comment:
+//   <peaking|lowshelf|highshelf|highpass|lowpass> <freq_hz> <gain_db> <q>
+//   preamp <gain_db>
+// Returns 0 on success, -1 with a message on stderr otherwise.
+int eq_load_preset(const char *path, eq_preset *eq);
+
+// Apply one line of the preset format to eq (a band is appended). Returns
+// 0, or -1 with a message prefixed by where ("file:line") on stderr.
+int eq_parse_line(const char *line, eq_preset *eq, const char *where);
+
+const char *eq_band_type_name(eq_band_type type);
+
+// RBJ audio-EQ-cookbook coefficients for one band at the given sample rate
+void eq_band_design(const eq_band *band, double sampleRate, eq_biquad *bq);
+
+// Compile the whole preset into one complex gain per FFT bin (the product of
+// every band's frequency response), so applying any number of bands costs a
+// single multiply pass per block. gains must hold frameSize/2 + 1 entries.
+void eq_build_gain_table(const eq_preset *eq, double sampleRate, int frameSize, fft_cpx *gains);
+
+// Causal impulse response of the band cascade, truncated to taps samples,
+// for FIR engines such as the partitioned convolver
+void eq_impulse_response(const eq_preset *eq, double sampleRate, float *ir, int taps);
+
+#endif
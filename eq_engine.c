@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "eq_engine.h"
+#include "arena.h"
+#include "dsp_kernels.h"
+
+struct eq_engine {
+    arena mem;             // holds this struct and everything below
+    int sampleRate;
+    int channels;
+    int built;             // jobs initialized so far
+    thread_pool *pool;
+    channel_job *jobs;
+    float **inPlanes;      // jobs[c].in
+    const float **outPlanes;  // jobs[c].out
+};
+
+static void teardown(eq_engine *e) {
+    for (int c = 0; c < e->built; c++) {
+        channel_job_free(&e->jobs[c]);
+    }
+    arena_free(e->jobs);
+    arena_free(e->inPlanes);
+    arena_free(e->outPlanes);
+    arena_free(e);
+}
+
+// Everything the engine owns, allocated from the thread's active arena
+static eq_engine *build(int sampleRate, int channels, const filter_options *opts, thread_pool *pool) {
+    eq_engine *e = (eq_engine *)arena_calloc(1, sizeof(eq_engine));
+    if (e == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return NULL;
+    }
+    e->sampleRate = sampleRate;
+    e->channels = channels;
+    e->pool = pool;
+    e->jobs = (channel_job *)arena_calloc(channels, sizeof(channel_job));
+    e->inPlanes = (float **)arena_calloc(channels, sizeof(float *));
+    e->outPlanes = (const float **)arena_calloc(channels, sizeof(float *));
+    if (e->jobs == NULL || e->inPlanes == NULL || e->outPlanes == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        teardown(e);
+        return NULL;
+    }
+    for (; e->built < channels; e->built++) {
+        if (channel_job_init(&e->jobs[e->built], opts, sampleRate) != 0) {
+            teardown(e);
+            return NULL;
+        }
+        e->inPlanes[e->built] = e->jobs[e->built].in;
+        e->outPlanes[e->built] = e->jobs[e->built].out;
+    }
+    return e;
+}
+
+// The engine is built twice: once in a measuring arena, to learn its size,
+// and once for real in an arena of exactly that size
+eq_engine *eq_engine_create(int sampleRate, int channels, const filter_options *opts, thread_pool *pool) {
+    if (channels < 1) {
+        fprintf(stderr, "Error: An engine needs at least one channel\n");
+        return NULL;
+    }
+
+    arena probe;
+    arena_init_measure(&probe);
+    arena *previous = arena_enter(&probe);
+    eq_engine *e = build(sampleRate, channels, opts, pool);
+    if (e != NULL) {
+        teardown(e);
+    }
+    arena_enter(previous);
+    if (e == NULL) {
+        return NULL;
+    }
+
+    arena mem;
+    if (arena_init(&mem, probe.used) != 0) {
+        return NULL;
+    }
+    previous = arena_enter(&mem);
+    e = build(sampleRate, channels, opts, pool);
+    arena_enter(previous);
+    if (e == NULL) {
+        arena_release(&mem);
+        return NULL;
+    }
+    e->mem = mem;
+    return e;
+}
+
+void eq_engine_destroy(eq_engine *e) {
+    if (e == NULL) {
+        return;
+    }
+    arena mem = e->mem;  // e itself is in the arena
+    arena *previous = arena_enter(&mem);
+    teardown(e);
+    arena_enter(previous);
+    arena_release(&mem);
+}
+
+int eq_engine_channels(const eq_engine *e) {
+    return e->channels;
+}
+
+int eq_engine_sample_rate(const eq_engine *e) {
+    return e->sampleRate;
+}
+
+size_t eq_engine_arena_bytes(const eq_engine *e) {
+    return e->mem.size;
+}
+
+float *const *eq_engine_input(eq_engine *e) {
+    return e->inPlanes;
+}
+
+channel_job *eq_engine_channel(eq_engine *e, int channel) {
+    return &e->jobs[channel];
+}
+
+// One step of every channel, and its output to the sink
+static int step(eq_engine *e, eq_engine_sink sink, void *ctx) {
+    int frames = channel_jobs_run(e->jobs, e->channels, e->pool);
+    if (frames <= 0) {
+        return frames;
+    }
+    return sink(ctx, e->outPlanes, frames);
+}
+
+int eq_engine_run(eq_engine *e, int frames, eq_engine_sink sink, void *ctx) {
+    for (int c = 0; c < e->channels; c++) {
+        e->jobs[c].inCount = frames;
+    }
+    return step(e, sink, ctx);
+}
+
+int eq_engine_process(eq_engine *e, const float *const *planes, long long frames, eq_engine_sink sink, void *ctx) {
+    int status = 0;
+    for (long long pos = 0; status == 0 && pos < frames; pos += STREAM_CHUNK_FRAMES) {
+        int count = frames - pos < STREAM_CHUNK_FRAMES ? (int)(frames - pos) : STREAM_CHUNK_FRAMES;
+        for (int c = 0; c < e->channels; c++) {
+            memcpy(e->inPlanes[c], planes[c] + pos, sizeof(float) * count);
+        }
+        status = eq_engine_run(e, count, sink, ctx);
+    }
+    return status;
+}
+
+int eq_engine_process_interleaved(eq_engine *e, const float *samples, long long frames, eq_engine_sink sink, void *ctx) {
+    const dsp_kernels *kern = dsp_kernels_get();
+    int status = 0;
+    for (long long pos = 0; status == 0 && pos < frames; pos += STREAM_CHUNK_FRAMES) {
+        int count = frames - pos < STREAM_CHUNK_FRAMES ? (int)(frames - pos) : STREAM_CHUNK_FRAMES;
+        kern->deinterleave(samples + pos * e->channels, e->channels, e->inPlanes, count);
+        status = eq_engine_run(e, count, sink, ctx);
+    }
+    return status;
+}
+
+int eq_engine_flush(eq_engine *e, eq_engine_sink sink, void *ctx) {
+    for (int c = 0; c < e->channels; c++) {
+        e->jobs[c].flush = 1;
+    }
+    int status = step(e, sink, ctx);
+    for (int c = 0; c < e->channels; c++) {
+        e->jobs[c].flush = 0;
+    }
+    return status;
+}
+
+void eq_engine_reset(eq_engine *e) {
+    for (int c = 0; c < e->channels; c++) {
+        channel_job_reset(&e->jobs[c]);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef EQ_ENGINE_H
+#define EQ_ENGINE_H
+
+#include <stddef.h>
+#include "channel_job.h"
+#include "thread_pool.h"
+
+// The equalizer as a library: one engine filters one multichannel stream.
+// It is built once for a sample rate, a channel count and a filter_options,
+// then takes input in spans of any length and hands every finished block of
+// output to a sink. Its filters, FFT plans and buffers all live in a single
+// aligned arena (arena.h) sized when the engine is created, so processing
+// never allocates. This is what the command line's file and batch modes run
+// on; it has no file I/O of its own.
+typedef struct eq_engine eq_engine;
+
+// Receives planar output: planes[c] holds frames samples of channel c, valid
+// until the sink returns. Anything but 0 stops processing and is returned.
+typedef int (*eq_engine_sink)(void *ctx, const float *const *planes, int frames);
+
+// Channels are filtered on pool when it is non-NULL, otherwise on the
+// calling thread. NULL (with a message) if the options do not make a filter.
+eq_engine *eq_engine_create(int sampleRate, int channels, const filter_options *opts, thread_pool *pool);
+void eq_engine_destroy(eq_engine *e);
+
+int eq_engine_channels(const eq_engine *e);
+int eq_engine_sample_rate(const eq_engine *e);
+
+// Size of the engine's arena, its whole memory apart from pocketfft's plans
+size_t eq_engine_arena_bytes(const eq_engine *e);
+
+// Feed frames samples per channel, in planes (planes[c] for channel c) or
+// interleaved. Any length is accepted; the span is cut into steps of
+// STREAM_CHUNK_FRAMES. Returns 0, or -1 / the sink's status on failure.
+int eq_engine_process(eq_engine *e, const float *const *planes, long long frames, eq_engine_sink sink, void *ctx);
+int eq_engine_process_interleaved(eq_engine *e, const float *samples, long long frames, eq_engine_sink sink, void *ctx);
+
+// Zero-copy input: fill up to STREAM_CHUNK_FRAMES samples of each plane the
+// engine owns, then run one step over the first frames of them
+float *const *eq_engine_input(eq_engine *e);
+int eq_engine_run(eq_engine *e, int frames, eq_engine_sink sink, void *ctx);
+
+// End of the stream: run the filters' tails into sink
+int eq_engine_flush(eq_engine *e, eq_engine_sink sink, void *ctx);
+
+// Forget the stream so the next one starts fresh; keeps everything built
+void eq_engine_reset(eq_engine *e);
+
+// A channel's filter, to set STFT hooks (stft.h) before the stream starts
+channel_job *eq_engine_channel(eq_engine *e, int channel);
+
+#endif
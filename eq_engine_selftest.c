@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "eq_engine.h"
+
+// Checks the promise of eq_engine.h that processing never allocates: every
+// filter the engine can build, with and without a thread pool, streams
+// random input through eq_engine_process, the interleaved entry point and
+// the flush while malloc and friends are counted, and any call fails it:
+//
+//   ./eq_engine_selftest
+//
+// The counting hooks replace glibc's allocator entry points and forward to
+// its internal ones, so they see the pool's worker threads as well.
+
+#define ENGINE_TEST_CHANNELS 3
+#define ENGINE_TEST_FRAMES 30011   // several steps and a partial one
+#define ENGINE_TEST_RATE 48000
+#define ENGINE_TEST_THREADS 2
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static atomic_int counting;
+static atomic_long allocations;
+
+static void count_allocation(void) {
+    if (atomic_load(&counting)) {
+        atomic_fetch_add(&allocations, 1);
+    }
+}
+
+void *malloc(size_t size) {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+    count_allocation();
+    return __libc_realloc(p, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+    count_allocation();
+    *p = __libc_memalign(alignment, size);
+    return *p != NULL ? 0 : 12;  // ENOMEM
+}
+
+static int count_sink(void *ctx, const float *const *planes, int frames) {
+    (void)planes;
+    *(long long *)ctx += frames;
+    return 0;
+}
+
+// Build an engine for opts and stream the input through it three ways with
+// the allocator watched; returns the allocations seen, or -1
+static long run_engine(const filter_options *opts, thread_pool *pool, const float *const *planes,
+                       const float *interleaved) {
+    eq_engine *e = eq_engine_create(ENGINE_TEST_RATE, ENGINE_TEST_CHANNELS, opts, pool);
+    if (e == NULL) {
+        return -1;
+    }
+    long long produced = 0;
+    atomic_store(&allocations, 0);
+    atomic_store(&counting, 1);
+    int status = eq_engine_process(e, planes, ENGINE_TEST_FRAMES, count_sink, &produced);
+    if (status == 0) {
+        status = eq_engine_flush(e, count_sink, &produced);
+    }
+    eq_engine_reset(e);
+    if (status == 0) {
+        status = eq_engine_process_interleaved(e, interleaved, ENGINE_TEST_FRAMES, count_sink, &produced);
+    }
+    if (status == 0) {
+        status = eq_engine_flush(e, count_sink, &produced);
+    }
+    atomic_store(&counting, 0);
+    eq_engine_destroy(e);
+    if (status != 0 || produced != 2LL * ENGINE_TEST_FRAMES) {
+        fprintf(stderr, "Error: The engine produced %lld of %d frames\n", produced, 2 * ENGINE_TEST_FRAMES);
+        return -1;
+    }
+    return atomic_load(&allocations);
+}
+
+int main(void) {
+    static const char *const names[] = {"stft", "stft complex", "fixed point", "low latency", "iir f32", "iir f64"};
+    filter_options configs[6];
+    for (int i = 0; i < 6; i++) {
+        filter_options_default(&configs[i]);
+    }
+    configs[1].useComplexFft = 1;
+    configs[2].fixedPoint = 1;
+    configs[3].lowLatency = 1;
+    configs[4].iir = 32;
+    configs[5].iir = 64;
+
+    float *in = (float *)malloc(sizeof(float) * ENGINE_TEST_FRAMES * ENGINE_TEST_CHANNELS);
+    float *interleaved = (float *)malloc(sizeof(float) * ENGINE_TEST_FRAMES * ENGINE_TEST_CHANNELS);
+    thread_pool *pool = thread_pool_create(ENGINE_TEST_THREADS);
+    if (in == NULL || interleaved == NULL || pool == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(in);
+        free(interleaved);
+        thread_pool_destroy(pool);
+        return 1;
+    }
+    srand(12345);
+    const float *planes[ENGINE_TEST_CHANNELS];
+    for (int c = 0; c < ENGINE_TEST_CHANNELS; c++) {
+        planes[c] = in + (size_t)c * ENGINE_TEST_FRAMES;
+    }
+    for (int i = 0; i < ENGINE_TEST_FRAMES * ENGINE_TEST_CHANNELS; i++) {
+        in[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        interleaved[i] = in[(size_t)(i % ENGINE_TEST_CHANNELS) * ENGINE_TEST_FRAMES + i / ENGINE_TEST_CHANNELS];
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        for (int usePool = 0; usePool < 2; usePool++) {
+            long seen = run_engine(&configs[i], usePool ? pool : NULL, planes, interleaved);
+            int ok = seen == 0;
+            failed += !ok;
+            if (seen < 0) {
+                printf("FAIL %s%s: the engine failed\n", names[i], usePool ? ", pool" : "");
+            } else {
+                printf("%s %s%s: %ld allocation(s) while processing\n", ok ? "ok  " : "FAIL", names[i],
+                       usePool ? ", pool" : "", seen);
+            }
+        }
+    }
+    thread_pool_destroy(pool);
+    free(in);
+    free(interleaved);
+    if (failed > 0) {
+        fprintf(stderr, "Error: %d configuration(s) allocated while processing\n", failed);
+        return 1;
+    }
+    return 0;
+}
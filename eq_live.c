@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "eq_live.h"
+#include "spsc_ring.h"
+
+#define EQ_LIVE_RETIRED (2 * EQ_LIVE_QUEUE)  // room for every table that can retire between reclaims
+#define EQ_CONTROL_POLL_MS 50                // control thread wakeups, to reclaim and to notice a stop
+#define EQ_CONTROL_LINE 1024
+
+// Single-producer/single-consumer ring of table pointers, like spsc_ring
+typedef struct {
+    fft_cpx *slot[EQ_LIVE_RETIRED];
+    size_t capacity;
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;
+} table_queue;
+
+struct eq_live {
+    stft_config cfg;
+    int sampleRate;
+    int numBins;
+    int fadeBlocks;
+
+    stft_state **channels;
+    fft_cpx **fades;        // each channel's blend buffer
+    int numChannels;
+    int maxChannels;
+
+    // DSP thread only
+    fft_cpx *current;       // table the channels hold or fade to; NULL while on their own binGain
+    fft_cpx *previous;      // table they fade from, retired when the fade ends
+    int fading;
+    long applied;
+
+    table_queue pending;    // control -> DSP
+    table_queue retired;    // DSP -> control
+    atomic_int closing;
+    atomic_long published;
+};
+
+static void queue_init(table_queue *q, size_t capacity) {
+    q->capacity = capacity;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+static int queue_push(table_queue *q, fft_cpx *table) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail == q->capacity) {
+        return 0;
+    }
+    q->slot[head % q->capacity] = table;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);  // publishes the table's contents
+    return 1;
+}
+
+static fft_cpx *queue_pop(table_queue *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    fft_cpx *table = q->slot[tail % q->capacity];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return table;
+}
+
+eq_live *eq_live_create(const stft_config *cfg, int sampleRate, int maxChannels) {
+    eq_live *live = (eq_live *)calloc(1, sizeof(eq_live));
+    if (live == NULL) {
+        return NULL;
+    }
+    live->cfg = *cfg;
+    live->sampleRate = sampleRate;
+    live->numBins = cfg->frameSize / 2 + 1;
+    live->fadeBlocks = (int)ceil(EQ_LIVE_FADE_MS * 1e-3 * sampleRate / cfg->hopSize);
+    if (live->fadeBlocks < 2) {
+        live->fadeBlocks = 2;
+    }
+    live->maxChannels = maxChannels;
+    live->channels = (stft_state **)calloc(maxChannels, sizeof(stft_state *));
+    live->fades = (fft_cpx **)calloc(maxChannels, sizeof(fft_cpx *));
+    if (live->channels == NULL || live->fades == NULL) {
+        eq_live_destroy(live);
+        return NULL;
+    }
+    queue_init(&live->pending, EQ_LIVE_QUEUE);
+    queue_init(&live->retired, EQ_LIVE_RETIRED);
+    atomic_init(&live->closing, 0);
+    atomic_init(&live->published, 0);
+    return live;
+}
+
+int eq_live_attach(eq_live *live, stft_state *st) {
+    if (live->numChannels == live->maxChannels || st->useComplexFft || st->numBins != live->numBins) {
+        return -1;
+    }
+    fft_cpx *fade = (fft_cpx *)malloc(sizeof(fft_cpx) * live->numBins);
+    if (fade == NULL) {
+        return -1;
+    }
+    live->fades[live->numChannels] = fade;
+    live->channels[live->numChannels++] = st;
+    st->fadeGain = fade;
+    st->fadeBlocks = live->fadeBlocks;
+    st->fadeLeft = 0;
+    return 0;
+}
+
+void eq_live_destroy(eq_live *live) {
+    if (live == NULL) {
+        return;
+    }
+    fft_cpx *table;
+    while ((table = queue_pop(&live->pending)) != NULL) {
+        free(table);
+    }
+    while ((table = queue_pop(&live->retired)) != NULL) {
+        free(table);
+    }
+    for (int c = 0; c < live->numChannels; c++) {
+        // Back to the channel's own gains, which outlive the live tables
+        live->channels[c]->gain = live->channels[c]->binGain;
+        live->channels[c]->fadeGain = NULL;
+        live->channels[c]->fadeLeft = 0;
+        free(live->fades[c]);
+    }
+    free(live->current);
+    free(live->previous);
+    free(live->channels);
+    free(live->fades);
+    free(live);
+}
+
+void eq_live_update(eq_live *live) {
+    if (live->fading) {
+        for (int c = 0; c < live->numChannels; c++) {
+            if (live->channels[c]->fadeLeft > 0) {
+                return;  // one change at a time
+            }
+        }
+        // Nothing reads the old table any more; a full retire queue only
+        // means the control side is behind, so try again next step
+        if (live->previous != NULL && !queue_push(&live->retired, live->previous)) {
+            return;
+        }
+        live->previous = NULL;
+        live->fading = 0;
+    }
+
+    fft_cpx *next = queue_pop(&live->pending);
+    if (next == NULL) {
+        return;
+    }
+    for (int c = 0; c < live->numChannels; c++) {
+        stft_state *st = live->channels[c];
+        st->gainFrom = st->gain;
+        st->gain = next;
+        st->fadeLeft = st->fadeBlocks;
+    }
+    live->previous = live->current;
+    live->current = next;
+    live->fading = 1;
+    live->applied++;
+}
+
+long eq_live_applied(const eq_live *live) {
+    return live->applied;
+}
+
+long eq_live_published(eq_live *live) {
+    return atomic_load(&live->published);
+}
+
+// Free the tables the DSP thread is done with; control side only
+static void reclaim(eq_live *live) {
+    fft_cpx *table;
+    while ((table = queue_pop(&live->retired)) != NULL) {
+        free(table);
+    }
+}
+
+int eq_live_publish(eq_live *live, const eq_preset *eq) {
+    reclaim(live);
+    fft_cpx *gains = (fft_cpx *)malloc(sizeof(fft_cpx) * live->numBins);
+    if (gains == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    eq_build_gain_table(eq, live->sampleRate, live->cfg.frameSize, gains);
+
+    while (!queue_push(&live->pending, gains)) {
+        if (atomic_load(&live->closing)) {
+            free(gains);
+            return -1;
+        }
+        reclaim(live);
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+    atomic_fetch_add(&live->published, 1);
+    return 0;
+}
+
+void eq_live_close(eq_live *live) {
+    atomic_store(&live->closing, 1);
+}
+
+// 1-based band number of a command; n == numBands + 1 only where allowed
+static int band_number(const char *text, const eq_preset *eq, int allowAppend, const char *where) {
+    char *end;
+    long n = strtol(text, &end, 10);
+    long last = eq->numBands + (allowAppend && eq->numBands < EQ_MAX_BANDS ? 1 : 0);
+    if (end == text || n < 1 || n > last) {
+        fprintf(stderr, "Error: %s: no band '%s' (the preset has %d)\n", where, text, eq->numBands);
+        return -1;
+    }
+    return (int)n - 1;
+}
+
+static int apply_command(eq_preset *eq, char *cmd, const char *where) {
+    char name[32], arg[EQ_CONTROL_LINE];
+    int rest = 0;  // offset of what follows the first argument
+    int fields = sscanf(cmd, "%31s %1023s%n", name, arg, &rest);
+    if (fields <= 0) {
+        return 0;
+    }
+
+    if (strcmp(name, "clear") == 0) {
+        memset(eq, 0, sizeof(*eq));
+        return 1;
+    }
+    if (strcmp(name, "load") == 0) {
+        eq_preset loaded;
+        if (fields != 2 || eq_load_preset(arg, &loaded) != 0) {
+            fprintf(stderr, "Error: %s: could not load '%s'\n", where, fields == 2 ? arg : "");
+            return -1;
+        }
+        *eq = loaded;
+        return 1;
+    }
+    if (strcmp(name, "remove") == 0) {
+        int b = fields == 2 ? band_number(arg, eq, 0, where) : -1;
+        if (b < 0) {
+            return -1;
+        }
+        memmove(&eq->bands[b], &eq->bands[b + 1], sizeof(eq_band) * (eq->numBands - b - 1));
+        eq->numBands--;
+        return 1;
+    }
+    if (strcmp(name, "band") == 0) {
+        int b = fields == 2 ? band_number(arg, eq, 1, where) : -1;
+        if (b < 0) {
+            return -1;
+        }
+        // The rest of the command is a band in the preset format
+        eq_preset one;
+        memset(&one, 0, sizeof(one));
+        if (eq_parse_line(cmd + rest, &one, where) != 0 || one.numBands != 1) {
+            if (one.numBands != 1) {
+                fprintf(stderr, "Error: %s: expected 'band <n> <type> <freq_hz> <gain_db> <q>'\n", where);
+            }
+            return -1;
+        }
+        eq->bands[b] = one.bands[0];
+        if (b == eq->numBands) {
+            eq->numBands++;
+        }
+        return 1;
+    }
+    if (strcmp(name, "gain") == 0 || strcmp(name, "freq") == 0 || strcmp(name, "q") == 0) {
+        double value;
+        if (sscanf(cmd, "%*s %*s %lf", &value) != 1) {
+            fprintf(stderr, "Error: %s: expected '%s <n> <value>'\n", where, name);
+            return -1;
+        }
+        int b = band_number(arg, eq, 0, where);
+        if (b < 0) {
+            return -1;
+        }
+        if (name[0] != 'g' && !(value > 0.0)) {
+            fprintf(stderr, "Error: %s: frequency and Q must be positive\n", where);
+            return -1;
+        }
+        *(name[0] == 'g' ? &eq->bands[b].gainDb : name[0] == 'f' ? &eq->bands[b].freq : &eq->bands[b].q) = value;
+        return 1;
+    }
+    return eq_parse_line(cmd, eq, where) == 0 ? 1 : -1;
+}
+
+int eq_live_apply(eq_preset *eq, const char *line, const char *where) {
+    char text[EQ_CONTROL_LINE];
+    snprintf(text, sizeof(text), "%s", line);
+    char *hash = strchr(text, '#');
+    if (hash != NULL) {
+        *hash = '\0';
+    }
+
+    eq_preset next = *eq;
+    int commands = 0;
+    char *save = NULL;
+    for (char *cmd = strtok_r(text, ";", &save); cmd != NULL; cmd = strtok_r(NULL, ";", &save)) {
+        int applied = apply_command(&next, cmd, where);
+        if (applied < 0) {
+            return -1;
+        }
+        commands += applied;
+    }
+    *eq = next;
+    return commands;
+}
+
+struct eq_control {
+    eq_live *live;
+    eq_preset eq;       // the preset as changed so far
+    char *path;
+    int created;        // the FIFO is ours to remove
+    int fd;
+    int keepOpen;       // our own writer end, so the FIFO never reports EOF
+    pthread_t thread;
+    atomic_int stop;
+};
+
+static void *control_thread(void *arg) {
+    eq_control *ctl = (eq_control *)arg;
+    char buf[EQ_CONTROL_LINE];
+    size_t fill = 0;
+    int lineNo = 0;
+
+    while (!atomic_load(&ctl->stop)) {
+        struct pollfd pfd = {ctl->fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, EQ_CONTROL_POLL_MS);
+        reclaim(ctl->live);
+        if (ready <= 0) {
+            continue;
+        }
+        ssize_t got = read(ctl->fd, buf + fill, sizeof(buf) - 1 - fill);
+        if (got <= 0) {
+            continue;  // EAGAIN or EINTR
+        }
+        fill += (size_t)got;
+        buf[fill] = '\0';
+
+        char *line = buf;
+        char *newline;
+        while ((newline = strchr(line, '\n')) != NULL) {
+            *newline = '\0';
+            char where[64];
+            snprintf(where, sizeof(where), "control:%d", ++lineNo);
+            if (eq_live_apply(&ctl->eq, line, where) > 0 && eq_live_publish(ctl->live, &ctl->eq) != 0) {
+                return NULL;  // closing
+            }
+            line = newline + 1;
+        }
+        fill -= (size_t)(line - buf);
+        memmove(buf, line, fill);
+        if (fill == sizeof(buf) - 1) {
+            fprintf(stderr, "Error: control:%d: line longer than %d bytes; dropped\n", lineNo + 1, EQ_CONTROL_LINE - 1);
+            fill = 0;
+        }
+    }
+    return NULL;
+}
+
+eq_control *eq_control_start(const char *path, eq_live *live, const eq_preset *initial) {
+    eq_control *ctl = (eq_control *)calloc(1, sizeof(eq_control));
+    if (ctl == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return NULL;
+    }
+    ctl->live = live;
+    ctl->eq = *initial;
+    ctl->fd = -1;
+    ctl->keepOpen = -1;
+    atomic_init(&ctl->stop, 0);
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        ctl->created = mkfifo(path, 0600) == 0;
+    } else if (!S_ISFIFO(st.st_mode)) {
+        fprintf(stderr, "Error: Control path '%s' exists and is not a FIFO\n", path);
+        free(ctl);
+        return NULL;
+    }
+    ctl->path = strdup(path);
+    // Reading end first: a non-blocking writer open needs a reader
+    ctl->fd = open(path, O_RDONLY | O_NONBLOCK);
+    ctl->keepOpen = ctl->fd >= 0 ? open(path, O_WRONLY | O_NONBLOCK) : -1;
+    if (ctl->path == NULL || ctl->fd < 0 || ctl->keepOpen < 0 || pthread_create(&ctl->thread, NULL, control_thread, ctl) != 0) {
+        fprintf(stderr, "Error: Could not open control FIFO '%s': %s\n", path, strerror(errno));
+        if (ctl->fd >= 0) {
+            close(ctl->fd);
+        }
+        if (ctl->keepOpen >= 0) {
+            close(ctl->keepOpen);
+        }
+        if (ctl->created) {
+            unlink(path);
+        }
+        free(ctl->path);
+        free(ctl);
+        return NULL;
+    }
+    return ctl;
+}
+
+void eq_control_stop(eq_control *ctl) {
+    if (ctl == NULL) {
+        return;
+    }
+    eq_live_close(ctl->live);
+    atomic_store(&ctl->stop, 1);
+    pthread_join(ctl->thread, NULL);
+    close(ctl->fd);
+    close(ctl->keepOpen);
+    if (ctl->created) {
+        unlink(ctl->path);
+    }
+    free(ctl->path);
+    free(ctl);
+}
@@ -0,0 +1,65 @@
+#ifndef EQ_LIVE_H
+#define EQ_LIVE_H
+
+#include "stft.h"
+#include "eq.h"
+
+#define EQ_LIVE_QUEUE 16       // compiled tables waiting for the DSP thread
+#define EQ_LIVE_FADE_MS 20.0   // crossfade length, rounded up to whole blocks
+
+// EQ changes while audio flows through the STFT filter (real-input path).
+// The control side compiles every new preset into a per-bin gain table off
+// the audio thread and queues its pointer. Between steps the DSP thread
+// takes the next table and points every attached channel at it; each
+// channel crossfades from the old gains over the next few blocks. Once the
+// fade is over no channel reads the old table, so it goes back to the
+// control side on a second queue and is freed there. The DSP side never
+// locks, allocates or frees, and pays one extra pass over the bins per block
+// only while a fade runs. No change is skipped: tables are taken one at a
+// time in order, and the control side waits while the queue is full.
+typedef struct eq_live eq_live;
+
+eq_live *eq_live_create(const stft_config *cfg, int sampleRate, int maxChannels);
+
+// Let a channel follow the live tables; before the DSP thread starts
+int eq_live_attach(eq_live *live, stft_state *st);
+
+// After the DSP and control threads have stopped
+void eq_live_destroy(eq_live *live);
+
+// DSP thread, between steps of the attached channels
+void eq_live_update(eq_live *live);
+
+// Tables the DSP thread has switched to so far, and tables queued for it;
+// the difference is what was still waiting when the stream ended
+long eq_live_applied(const eq_live *live);
+long eq_live_published(eq_live *live);
+
+// Control side: queue the gains of eq, waiting while the queue is full.
+// Returns -1 if the table could not be allocated or the stream is closing.
+int eq_live_publish(eq_live *live, const eq_preset *eq);
+
+// Make publishers stop waiting; the stream is ending
+void eq_live_close(eq_live *live);
+
+// Apply one control line to eq. Commands are separated by ";" and applied
+// together, as one change:
+//   <type> <freq_hz> <gain_db> <q>       append a band (preset format)
+//   preamp <gain_db>
+//   band <n> <type> <freq_hz> <gain_db> <q>   replace band n (1-based)
+//   gain <n> <gain_db>    freq <n> <freq_hz>    q <n> <q>
+//   remove <n>    clear    load <preset_file>
+// Returns the number of commands, or -1 (eq untouched) with a message
+// prefixed by where.
+int eq_live_apply(eq_preset *eq, const char *line, const char *where);
+
+// Read control lines from the FIFO at path (created if missing) on a thread
+// of its own, starting from the preset initial, and publish every change
+typedef struct eq_control eq_control;
+
+eq_control *eq_control_start(const char *path, eq_live *live, const eq_preset *initial);
+
+// Close the live EQ, stop the thread and remove a FIFO it created
+void eq_control_stop(eq_control *ctl);
+
+#endif
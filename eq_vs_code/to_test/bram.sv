@@ -41,7 +41,7 @@ module bram_wrapper #(
 
   logic bram_clk_prev;  // Previous state of the BRAM clock
   //rising edge detection of the clock for output valid 
-  always @(posedge bram_clk or posedge reset) begin
+  always @(posedge bram_clk or posedge rst) begin
     if (rst) begin
       bram_clk_prev <= 1'b0;  // Reset the previous state
       output_valid  <= 1'b0;  // Reset the output
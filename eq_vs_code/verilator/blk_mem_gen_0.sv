@@ -0,0 +1,46 @@
+`timescale 1ns / 1ps
+
+// Behavioral stand-in for the Block Memory Generator instance bram.sv uses:
+// true dual port, 32-bit words, 2048 deep (11-bit addresses), no output
+// register, so each port's dout shows the addressed word one clock edge
+// after the address; port A reads first when it writes. Port B only reads:
+// bram.sv leaves web and dinb unconnected, and ignoring them keeps the
+// memory single-driven. Memory starts zeroed.
+
+module blk_mem_gen_0 (
+    input  logic        clka,
+    input  logic        ena,
+    input  logic [0:0]  wea,
+    input  logic [10:0] addra,
+    input  logic [31:0] dina,
+    output logic [31:0] douta,
+    input  logic        clkb,
+    input  logic        enb,
+    // verilator lint_off UNUSEDSIGNAL
+    input  logic [0:0]  web,
+    input  logic [10:0] addrb,
+    input  logic [31:0] dinb,
+    // verilator lint_on UNUSEDSIGNAL
+    output logic [31:0] doutb
+);
+
+  logic [31:0] mem[2048];
+
+  initial begin
+    for (int i = 0; i < 2048; i++) mem[i] = '0;
+    douta = '0;
+    doutb = '0;
+  end
+
+  always_ff @(posedge clka) begin
+    if (ena) begin
+      douta <= mem[addra];
+      if (wea[0]) mem[addra] <= dina;
+    end
+  end
+
+  always_ff @(posedge clkb) begin
+    if (enb) doutb <= mem[addrb];
+  end
+
+endmodule
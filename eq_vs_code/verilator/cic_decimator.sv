@@ -0,0 +1,75 @@
+`timescale 1ns / 1ps
+
+// Behavioral stand-in for the Xilinx CIC Compiler decimator (cic_compiler_0)
+// so pdm_mic.sv simulates outside Vivado. Same ports as the IP; same
+// arithmetic as cic.c's register-level model:
+//
+//   N integrators at the input rate, N combs at the output rate, every
+//   register OUTPUT_WIDTH bits wide and wrapping on overflow, all zero at
+//   start. Output m is computed once input R*m + R-1 has been taken and
+//   appears with m_axis_data_tvalid on the next aclk edge.
+//
+// tdata is the result sign-extended to the IP's byte-padded width.
+
+module cic_decimator #(
+    parameter int STAGES       = 5,
+    parameter int RATE         = 4,
+    parameter int DIFF_DELAY   = 1,
+    parameter int INPUT_WIDTH  = 8,
+    parameter int OUTPUT_WIDTH = 18   // full precision: INPUT_WIDTH + STAGES * clog2(RATE * DIFF_DELAY)
+) (
+    input  logic aclk,
+    input  logic [((INPUT_WIDTH + 7) / 8) * 8 - 1:0] s_axis_data_tdata,
+    input  logic s_axis_data_tvalid,
+    output logic s_axis_data_tready,
+    output logic [((OUTPUT_WIDTH + 7) / 8) * 8 - 1:0] m_axis_data_tdata,
+    output logic m_axis_data_tvalid
+);
+
+  localparam int TDATA_WIDTH = ((OUTPUT_WIDTH + 7) / 8) * 8;
+
+  logic [OUTPUT_WIDTH-1:0] integ[STAGES];
+  logic [OUTPUT_WIDTH-1:0] delay[STAGES][DIFF_DELAY];
+  logic [$clog2(RATE)-1:0] phase;
+
+  logic [OUTPUT_WIDTH-1:0] integ_next[STAGES];
+  logic [OUTPUT_WIDTH-1:0] comb[STAGES+1];  // comb[s] feeds comb stage s
+
+  initial begin
+    for (int s = 0; s < STAGES; s++) begin
+      integ[s] = '0;
+      for (int d = 0; d < DIFF_DELAY; d++) delay[s][d] = '0;
+    end
+    phase = '0;
+    m_axis_data_tdata = '0;
+    m_axis_data_tvalid = 1'b0;
+  end
+
+  assign s_axis_data_tready = 1'b1;
+
+  always_comb begin
+    integ_next[0] = integ[0] + OUTPUT_WIDTH'($signed(s_axis_data_tdata[INPUT_WIDTH-1:0]));
+    for (int s = 1; s < STAGES; s++) integ_next[s] = integ[s] + integ_next[s-1];
+    comb[0] = integ_next[STAGES-1];
+    for (int s = 0; s < STAGES; s++) comb[s+1] = comb[s] - delay[s][DIFF_DELAY-1];
+  end
+
+  always_ff @(posedge aclk) begin
+    m_axis_data_tvalid <= 1'b0;
+    if (s_axis_data_tvalid) begin
+      for (int s = 0; s < STAGES; s++) integ[s] <= integ_next[s];
+      if (phase == $clog2(RATE)'(RATE - 1)) begin
+        phase <= '0;
+        for (int s = 0; s < STAGES; s++) begin
+          delay[s][0] <= comb[s];
+          for (int d = 1; d < DIFF_DELAY; d++) delay[s][d] <= delay[s][d-1];
+        end
+        m_axis_data_tdata  <= TDATA_WIDTH'($signed(comb[STAGES]));
+        m_axis_data_tvalid <= 1'b1;
+      end else begin
+        phase <= phase + 1'b1;
+      end
+    end
+  end
+
+endmodule
@@ -0,0 +1,190 @@
+// Verilator driver for the microphone path (mic_harness.sv): plays a PDM bit
+// stream into pdm_mic, collects every pcm_data_valid sample and compares it
+// with cic.c's model of cic_compiler_0, then checks that bram_wrapper hands
+// each sample back 16 writes later. Runs headless; exits 1 on any mismatch.
+//
+// Build from the repository root (see compilation_command.txt), then:
+//
+//   obj_mic_harness/Vmic_harness pdm_positive_full_scale.txt
+//   obj_mic_harness/Vmic_harness --out pcm.txt capture.pdm
+//   obj_mic_harness/Vmic_harness --reader pdm_bits.txt
+//
+// The input is $readmemb text or a packed .pdm capture. By default the driver
+// puts each bit on MIC_DATA itself, so any file works without a rebuild.
+// --reader plays it through read_pdm_from_file.sv instead, which loads the
+// file named by the FILENAME parameter (default pdm_bits.txt, in the
+// working directory): pass the same file so the reference matches.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <verilated.h>
+#include "Vmic_harness.h"
+#include "cic.h"
+#include "pdm_file.h"
+
+#define BRAM_DELAY 16              // bram.sv's BRAM_WRITE_HEADSTART
+#define STALL_CYCLES 1000000       // clock cycles without a sample before giving up
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// All bits of a text or packed input
+static long load_bits(const char *path, uint64_t **words) {
+    if (!pdm_file_probe(path)) {
+        return pdm_read_readmemb(path, words);
+    }
+    pdm_reader r;
+    if (pdm_reader_open(&r, path) != 0) {
+        return -1;
+    }
+    size_t maxBits = (size_t)(r.info.numBits / 64 + 1) * 64;
+    *words = (uint64_t *)malloc(maxBits / 8);
+    long bits = -1;
+    if (*words == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    } else if (r.info.channels != 1) {
+        fprintf(stderr, "Error: '%s' holds %d channels; pdm_mic takes one\n", path, r.info.channels);
+    } else {
+        bits = (long)pdm_reader_read(&r, *words, maxBits);
+    }
+    pdm_reader_close(&r);
+    return bits;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--reader] [--out pcm.txt] <pdm_bits.txt|.pdm>\n", prog);
+}
+
+int main(int argc, char **argv) {
+    int useReader = 0;
+    const char *outPath = NULL;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--reader") == 0) {
+            useReader = 1;
+        } else if (strcmp(argv[argi], "--out") == 0 && argi + 1 < argc) {
+            outPath = argv[++argi];
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[argi]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - argi != 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint64_t *words = NULL;
+    long bits = load_bits(argv[argi], &words);
+    if (bits < 0) {
+        free(words);
+        return 1;
+    }
+
+    // Software reference: the packed model of cic_compiler_0
+    cic_config cfg;
+    cic_config_default(&cfg);
+    cic_pdm cic;
+    if (cic_pdm_init(&cic, &cfg) != 0) {
+        free(words);
+        return 1;
+    }
+    std::vector<int32_t> expected((size_t)bits / cfg.rate + 1);
+    expected.resize(cic_pdm_process(&cic, words, (size_t)bits, expected.data()));
+
+    VerilatedContext ctx;
+    ctx.commandArgs(argc, argv);
+    Vmic_harness top(&ctx);
+    top.use_reader = useReader;
+    top.mic_data = 0;
+
+    std::vector<uint16_t> pcm;
+    std::vector<uint16_t> bramOut;
+    pcm.reserve(expected.size());
+    bramOut.reserve(expected.size());
+    long fed = 0;
+    uint64_t cycles = 0;
+    uint64_t lastSample = 0;
+    double start = now_seconds();
+
+    // A few cycles of reset, then run until every expected sample is out
+    for (top.rst = 1; pcm.size() < expected.size() && cycles - lastSample < STALL_CYCLES; cycles++) {
+        if (cycles == 4) {
+            top.rst = 0;
+        }
+        top.clk = 0;
+        top.eval();
+        // pdm_mic takes MIC_DATA on the edge that ends an m_clk_rising cycle
+        if (!useReader && !top.rst && top.m_clk_rising) {
+            top.mic_data = fed < bits ? (words[fed / 64] >> (fed % 64)) & 1 : 0;
+            fed++;
+        }
+        top.clk = 1;
+        top.eval();
+        if (top.pcm_data_valid) {
+            pcm.push_back(top.pcm_data);
+            bramOut.push_back(top.bram_word);
+            lastSample = cycles;
+        }
+    }
+    top.final();
+    double elapsed = now_seconds() - start;
+
+    // pcm_data is the low 16 bits of the IP's 18-bit result
+    size_t mismatches = 0;
+    for (size_t i = 0; i < pcm.size(); i++) {
+        if (pcm[i] != (uint16_t)expected[i]) {
+            if (mismatches < 10) {
+                fprintf(stderr, "Error: Sample %zu: pcm_data %d, reference %d\n", i, (int16_t)pcm[i],
+                        (int16_t)(uint16_t)expected[i]);
+            }
+            mismatches++;
+        }
+    }
+    if (pcm.size() < expected.size()) {
+        fprintf(stderr, "Error: Only %zu of %zu samples came out (stalled after %llu cycles)\n", pcm.size(),
+                expected.size(), (unsigned long long)cycles);
+        mismatches++;
+    }
+
+    // The BRAM is a delay line: each valid shows the sample written 16 before
+    size_t bramErrors = 0;
+    for (size_t i = 0; i < bramOut.size(); i++) {
+        uint16_t want = i >= BRAM_DELAY ? pcm[i - BRAM_DELAY] : 0;
+        if (bramOut[i] != want) {
+            if (bramErrors < 10) {
+                fprintf(stderr, "Error: BRAM output %zu: %d, expected %d\n", i, (int16_t)bramOut[i], (int16_t)want);
+            }
+            bramErrors++;
+        }
+    }
+
+    fprintf(stderr, "mic_harness: %ld bits -> %zu samples in %llu cycles; %.2f s, %.1f Mcycles/s\n", bits,
+            pcm.size(), (unsigned long long)cycles, elapsed, elapsed > 0.0 ? cycles / elapsed / 1e6 : 0.0);
+    fprintf(stderr, "mic_harness: pdm_mic %s the CIC reference (%zu mismatches); BRAM %s (%zu errors)\n",
+            mismatches == 0 ? "matches" : "DIFFERS FROM", mismatches, bramErrors == 0 ? "ok" : "FAILED",
+            bramErrors);
+
+    int status = mismatches == 0 && bramErrors == 0 ? 0 : 1;
+    if (outPath != NULL) {
+        FILE *out = fopen(outPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Error: Could not open output file '%s'\n", outPath);
+            status = 1;
+        } else {
+            for (size_t i = 0; i < pcm.size(); i++) {
+                fprintf(out, "%d\n", (int16_t)pcm[i]);
+            }
+            fclose(out);
+        }
+    }
+    free(words);
+    return status;
+}
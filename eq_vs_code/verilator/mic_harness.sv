@@ -0,0 +1,74 @@
+`timescale 1ns / 1ps
+
+// Verilator top for the microphone path: the same wiring as
+// testbench_pdm_mic (pdm_clk_gen -> pdm_mic, with read_file as the PDM
+// source), plus bram_wrapper buffering the PCM samples. The C++ driver owns
+// the clock and reset and either feeds MIC_DATA itself (use_reader = 0) or
+// lets read_file play FILENAME (use_reader = 1).
+
+module mic_harness #(
+    parameter IN_FREQ = 100_000_000,  // 100 MHz system clock
+    parameter OUT_FREQ = 3_072_000,   // PDM clock
+    parameter FILENAME = "pdm_bits.txt",
+    parameter FILE_LENGTH = 16384
+) (
+    input  logic        clk,
+    input  logic        rst,
+    input  logic        use_reader,
+    input  logic        mic_data,        // PDM bit taken at the next m_clk_rising
+    output logic        mic_clk,
+    output logic        m_clk_rising,
+    output logic        reader_valid,
+    output logic [15:0] pcm_data,
+    output logic        pcm_data_valid,
+    output logic [15:0] bram_word,       // PCM sample 16 writes back, on each pcm_data_valid
+    output logic        bram_valid
+);
+
+  logic reader_bit;
+  logic MIC_DATA;
+
+  pdm_clk_gen #(
+      .INPUT_FREQ (IN_FREQ),
+      .OUTPUT_FREQ(OUT_FREQ)
+  ) pdm_clk_gen_inst (
+      .clk(clk),
+      .rst(rst),
+      .M_CLK(mic_clk),
+      .m_clk_rising(m_clk_rising)
+  );
+
+  read_file #(
+      .FILENAME(FILENAME),
+      .FILE_LENGTH(FILE_LENGTH)
+  ) reader (
+      .clk(mic_clk),
+      .rst(rst),
+      .data_bit(reader_bit),
+      .data_bit_valid(reader_valid)
+  );
+
+  assign MIC_DATA = use_reader ? reader_bit : mic_data;
+
+  pdm_mic pdm_mic_inst (
+      .clk(clk),
+      .rst(rst),
+      .pcm_data(pcm_data),
+      .pcm_data_valid(pcm_data_valid),
+      .m_clk_rising(m_clk_rising),
+      .MIC_CLK(mic_clk),
+      .MIC_DATA(MIC_DATA)
+  );
+
+  bram_wrapper #(
+      .BIT_DEPTH(16)
+  ) bram (
+      .clk(clk),
+      .rst(rst),
+      .audio_clk(pcm_data_valid),
+      .input_word(pcm_data),
+      .output_word(bram_word),
+      .output_valid(bram_valid)
+  );
+
+endmodule
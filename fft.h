@@ -0,0 +1,64 @@
+#ifndef FFT_H
+#define FFT_H
+
+// FFT interface used by the filters. Every backend implements the same set
+// of functions under its own prefix, and the build picks one with
+// -DFFT_BACKEND=kiss|builtin|pocketfft (default kiss). The generic fft_*
+// names below are macros for that backend's functions, so the block loops
+// make direct calls with no function-pointer indirection.
+//
+//   kiss       kissfft (kiss_fftr / kiss_fft), any even size
+//   builtin    split-radix in fft_builtin.c, power-of-two sizes
+//   pocketfft  pocketfft's C version; build with -DFFT_HAVE_POCKETFFT and
+//              pocketfft/pocketfft.c
+//
+// Transforms are unnormalized in both directions: inverse(forward(x)) = n * x.
+
+// Interleaved complex value, layout-compatible with kiss_fft_cpx
+typedef struct {
+    float r;
+    float i;
+} fft_cpx;
+
+// Real transforms: n real samples <-> n/2 + 1 bins.
+// Complex transforms: n bins -> n bins, direction fixed when allocated.
+// Allocation returns NULL (with a message on stderr) for unsupported sizes.
+#define FFT_DECLARE_BACKEND(b)                                                        \
+    typedef struct fft_##b##_real fft_##b##_real;                                     \
+    fft_##b##_real *fft_##b##_real_alloc(int n);                                      \
+    void fft_##b##_real_forward(fft_##b##_real *plan, const float *in, fft_cpx *out); \
+    void fft_##b##_real_inverse(fft_##b##_real *plan, const fft_cpx *in, float *out); \
+    void fft_##b##_real_free(fft_##b##_real *plan);                                   \
+    typedef struct fft_##b##_complex fft_##b##_complex;                               \
+    fft_##b##_complex *fft_##b##_complex_alloc(int n, int inverse);                   \
+    void fft_##b##_complex_run(fft_##b##_complex *plan, const fft_cpx *in, fft_cpx *out); \
+    void fft_##b##_complex_free(fft_##b##_complex *plan);
+
+FFT_DECLARE_BACKEND(kiss)
+FFT_DECLARE_BACKEND(builtin)
+#ifdef FFT_HAVE_POCKETFFT
+FFT_DECLARE_BACKEND(pocketfft)
+#endif
+
+#ifndef FFT_BACKEND
+#define FFT_BACKEND kiss
+#endif
+
+#define FFT_BIND_(b, name) fft_##b##_##name
+#define FFT_BIND(b, name) FFT_BIND_(b, name)
+#define FFT_STRING_(b) #b
+#define FFT_STRING(b) FFT_STRING_(b)
+
+#define FFT_BACKEND_NAME FFT_STRING(FFT_BACKEND)
+
+#define fft_real FFT_BIND(FFT_BACKEND, real)
+#define fft_real_alloc FFT_BIND(FFT_BACKEND, real_alloc)
+#define fft_real_forward FFT_BIND(FFT_BACKEND, real_forward)
+#define fft_real_inverse FFT_BIND(FFT_BACKEND, real_inverse)
+#define fft_real_free FFT_BIND(FFT_BACKEND, real_free)
+#define fft_complex FFT_BIND(FFT_BACKEND, complex)
+#define fft_complex_alloc FFT_BIND(FFT_BACKEND, complex_alloc)
+#define fft_complex_run FFT_BIND(FFT_BACKEND, complex_run)
+#define fft_complex_free FFT_BIND(FFT_BACKEND, complex_free)
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft.h"
+#include "arena.h"
+
+// Self-contained split-radix FFT for power-of-two sizes. The complex
+// transform recurses as one half-length transform of the even samples plus
+// two quarter-length ones of the odd samples, which needs fewer
+// multiplications than radix-2. Twiddles come from one table per plan. A real
+// transform of size n runs as a complex one of size n/2 over the sample
+// pairs, followed by the usual split of the even/odd spectra.
+
+struct fft_builtin_complex {
+    int n;
+    int inverse;
+    fft_cpx *twiddle;  // exp(-2*pi*i*k/n), k < n
+    fft_cpx *scratch;  // copy of the input for in-place calls
+};
+
+struct fft_builtin_real {
+    int n;
+    fft_builtin_complex *fwd;  // size n/2
+    fft_builtin_complex *inv;
+    fft_cpx *twiddle;          // exp(-2*pi*i*k/n), k <= n/2
+    fft_cpx *pairs;            // n/2 packed sample pairs
+    fft_cpx *half;             // n/2 bins of the packed transform
+};
+
+static int is_power_of_two(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+static fft_cpx *twiddle_table(int count, int n) {
+    fft_cpx *tw = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * (count > 0 ? count : 1));
+    if (tw == NULL) {
+        return NULL;
+    }
+    for (int k = 0; k < count; k++) {
+        double phase = -2.0 * M_PI * k / n;
+        tw[k].r = (float)cos(phase);
+        tw[k].i = (float)sin(phase);
+    }
+    return tw;
+}
+
+// out[0..n) = DFT of in[0], in[stride], ...; W_n^k is tw[k * twStride]
+static void split_radix(fft_cpx *out, const fft_cpx *in, int n, int stride,
+                        const fft_cpx *tw, int twStride, int inverse) {
+    if (n == 1) {
+        out[0] = in[0];
+        return;
+    }
+    if (n == 2) {
+        fft_cpx a = in[0], b = in[stride];
+        out[0].r = a.r + b.r;
+        out[0].i = a.i + b.i;
+        out[1].r = a.r - b.r;
+        out[1].i = a.i - b.i;
+        return;
+    }
+
+    int q = n / 4;
+    split_radix(out, in, n / 2, 2 * stride, tw, 2 * twStride, inverse);
+    split_radix(out + 2 * q, in + stride, q, 4 * stride, tw, 4 * twStride, inverse);
+    split_radix(out + 3 * q, in + 3 * stride, q, 4 * stride, tw, 4 * twStride, inverse);
+
+    // The inverse uses conjugate twiddles, which also flips the sign of i
+    float sign = inverse ? -1.0f : 1.0f;
+    for (int k = 0; k < q; k++) {
+        fft_cpx w1 = tw[k * twStride];
+        fft_cpx w3 = tw[3 * k * twStride];
+        w1.i *= sign;
+        w3.i *= sign;
+
+        fft_cpx o1 = out[2 * q + k];
+        fft_cpx o3 = out[3 * q + k];
+        float ar = o1.r * w1.r - o1.i * w1.i;
+        float ai = o1.r * w1.i + o1.i * w1.r;
+        float br = o3.r * w3.r - o3.i * w3.i;
+        float bi = o3.r * w3.i + o3.i * w3.r;
+        float sr = ar + br, si = ai + bi;
+        float dr = ar - br, di = ai - bi;
+
+        fft_cpx u0 = out[k];
+        fft_cpx u1 = out[q + k];
+        out[k].r = u0.r + sr;
+        out[k].i = u0.i + si;
+        out[2 * q + k].r = u0.r - sr;
+        out[2 * q + k].i = u0.i - si;
+        // Forward: X[k + n/4] = u1 - i*d, X[k + 3n/4] = u1 + i*d
+        out[q + k].r = u1.r + sign * di;
+        out[q + k].i = u1.i - sign * dr;
+        out[3 * q + k].r = u1.r - sign * di;
+        out[3 * q + k].i = u1.i + sign * dr;
+    }
+}
+
+fft_builtin_complex *fft_builtin_complex_alloc(int n, int inverse) {
+    if (!is_power_of_two(n)) {
+        fprintf(stderr, "Error: The builtin FFT needs a power-of-two size (got %d)\n", n);
+        return NULL;
+    }
+    fft_builtin_complex *plan = (fft_builtin_complex *)arena_calloc(1, sizeof(fft_builtin_complex));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->n = n;
+    plan->inverse = inverse;
+    plan->twiddle = twiddle_table(n, n);
+    plan->scratch = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * n);
+    if (plan->twiddle == NULL || plan->scratch == NULL) {
+        fft_builtin_complex_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_builtin_complex_run(fft_builtin_complex *plan, const fft_cpx *in, fft_cpx *out) {
+    if (in == out) {
+        memcpy(plan->scratch, in, sizeof(fft_cpx) * plan->n);
+        in = plan->scratch;
+    }
+    split_radix(out, in, plan->n, 1, plan->twiddle, 1, plan->inverse);
+}
+
+void fft_builtin_complex_free(fft_builtin_complex *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    arena_free(plan->twiddle);
+    arena_free(plan->scratch);
+    arena_free(plan);
+}
+
+fft_builtin_real *fft_builtin_real_alloc(int n) {
+    if (n < 2 || !is_power_of_two(n)) {
+        fprintf(stderr, "Error: The builtin FFT needs a power-of-two size (got %d)\n", n);
+        return NULL;
+    }
+    fft_builtin_real *plan = (fft_builtin_real *)arena_calloc(1, sizeof(fft_builtin_real));
+    if (plan == NULL) {
+        return NULL;
+    }
+    int m = n / 2;
+    plan->n = n;
+    plan->fwd = fft_builtin_complex_alloc(m, 0);
+    plan->inv = fft_builtin_complex_alloc(m, 1);
+    plan->twiddle = twiddle_table(m + 1, n);
+    plan->pairs = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * m);
+    plan->half = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * m);
+    if (plan->fwd == NULL || plan->inv == NULL || plan->twiddle == NULL || plan->pairs == NULL || plan->half == NULL) {
+        fft_builtin_real_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_builtin_real_forward(fft_builtin_real *plan, const float *in, fft_cpx *out) {
+    int m = plan->n / 2;
+    // z[j] = x[2j] + i x[2j+1]; Z = E + i O where E, O are the spectra of the even and odd samples
+    memcpy(plan->pairs, in, sizeof(float) * plan->n);
+    split_radix(plan->half, plan->pairs, m, 1, plan->fwd->twiddle, 1, 0);
+
+    for (int k = 0; k <= m; k++) {
+        fft_cpx z = plan->half[k < m ? k : 0];
+        fft_cpx zc = plan->half[k > 0 ? m - k : 0];
+        zc.i = -zc.i;
+        // E = (Z[k] + conj Z[m-k]) / 2, O = (Z[k] - conj Z[m-k]) / 2i
+        float er = 0.5f * (z.r + zc.r), ei = 0.5f * (z.i + zc.i);
+        float or_ = 0.5f * (z.i - zc.i), oi = -0.5f * (z.r - zc.r);
+        fft_cpx w = plan->twiddle[k];
+        out[k].r = er + (or_ * w.r - oi * w.i);
+        out[k].i = ei + (or_ * w.i + oi * w.r);
+    }
+}
+
+void fft_builtin_real_inverse(fft_builtin_real *plan, const fft_cpx *in, float *out) {
+    int m = plan->n / 2;
+    for (int k = 0; k < m; k++) {
+        fft_cpx x = in[k];
+        fft_cpx xc = in[m - k];
+        xc.i = -xc.i;
+        // 2E = X[k] + conj X[m-k], 2O = (X[k] - conj X[m-k]) * conj W^k, Z = 2E + i 2O
+        float er = x.r + xc.r, ei = x.i + xc.i;
+        float dr = x.r - xc.r, di = x.i - xc.i;
+        fft_cpx w = plan->twiddle[k];
+        float or_ = dr * w.r + di * w.i;
+        float oi = di * w.r - dr * w.i;
+        plan->pairs[k].r = er - oi;
+        plan->pairs[k].i = ei + or_;
+    }
+    split_radix((fft_cpx *)(void *)out, plan->pairs, m, 1, plan->inv->twiddle, 1, 1);
+}
+
+void fft_builtin_real_free(fft_builtin_real *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    fft_builtin_complex_free(plan->fwd);
+    fft_builtin_complex_free(plan->inv);
+    arena_free(plan->twiddle);
+    arena_free(plan->pairs);
+    arena_free(plan->half);
+    arena_free(plan);
+}
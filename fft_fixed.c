@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "fft_fixed.h"
+#include "dsp_kernels.h"
+#include "arena.h"
+
+// Iterative decimation in time: the input is copied in bit-reversed order,
+// then log2(n) passes of butterflies run in place. Pass p combines blocks of
+// half = 2^p points and uses W^(j * n / (2 * half)), j < half, which are
+// stored back to back so each pass reads its twiddles contiguously. The
+// butterflies themselves are a DSP kernel, so they run on integer SIMD.
+
+struct fft_fixed {
+    int n;
+    int *bitrev;             // bitrev[k]: output slot of input k
+    fft_fixed_cpx *twiddle;  // n - 1 entries; pass with half h starts at h - 1
+    const dsp_kernels *kern;
+};
+
+static int is_power_of_two(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Round x * 2^31 to Q31, saturating +1.0 to the largest value
+static int32_t to_q31(double x) {
+    double v = floor(x * 2147483648.0 + 0.5);
+    return (int32_t)(v > 2147483647.0 ? 2147483647.0 : v < -2147483647.0 ? -2147483647.0 : v);
+}
+
+fft_fixed *fft_fixed_alloc(int n, int inverse) {
+    if (!is_power_of_two(n) || n < 2) {
+        fprintf(stderr, "Error: The fixed-point FFT needs a power-of-two size of at least 2, got %d\n", n);
+        return NULL;
+    }
+    fft_fixed *plan = (fft_fixed *)arena_calloc(1, sizeof(fft_fixed));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->n = n;
+    plan->bitrev = (int *)arena_alloc(sizeof(int) * n);
+    plan->twiddle = (fft_fixed_cpx *)arena_alloc(sizeof(fft_fixed_cpx) * (n - 1));
+    if (plan->bitrev == NULL || plan->twiddle == NULL) {
+        fft_fixed_free(plan);
+        return NULL;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < n) {
+        bits++;
+    }
+    for (int k = 0; k < n; k++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        }
+        plan->bitrev[k] = r;
+    }
+
+    double sign = inverse ? 1.0 : -1.0;
+    for (int half = 1; half < n; half *= 2) {
+        fft_fixed_cpx *tw = plan->twiddle + half - 1;
+        for (int j = 0; j < half; j++) {
+            double phase = sign * M_PI * j / half;
+            tw[j].r = to_q31(cos(phase));
+            tw[j].i = to_q31(sin(phase));
+        }
+    }
+    plan->kern = dsp_kernels_get();
+    return plan;
+}
+
+void fft_fixed_free(fft_fixed *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    arena_free(plan->bitrev);
+    arena_free(plan->twiddle);
+    arena_free(plan);
+}
+
+static void run_passes(const fft_fixed *plan, fft_fixed_cpx *out) {
+    int n = plan->n;
+    for (int half = 1; half < n; half *= 2) {
+        const fft_fixed_cpx *tw = plan->twiddle + half - 1;
+        for (int g = 0; g < n; g += 2 * half) {
+            plan->kern->butterfly_q31(out + g, out + g + half, tw, half);
+        }
+    }
+}
+
+void fft_fixed_run(const fft_fixed *plan, const fft_fixed_cpx *in, fft_fixed_cpx *out) {
+    for (int k = 0; k < plan->n; k++) {
+        out[plan->bitrev[k]] = in[k];
+    }
+    run_passes(plan, out);
+}
+
+void fft_fixed_run_real(const fft_fixed *plan, const int32_t *in, fft_fixed_cpx *out) {
+    for (int k = 0; k < plan->n; k++) {
+        out[plan->bitrev[k]].r = in[k];
+        out[plan->bitrev[k]].i = 0;
+    }
+    run_passes(plan, out);
+}
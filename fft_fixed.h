@@ -0,0 +1,36 @@
+#ifndef FFT_FIXED_H
+#define FFT_FIXED_H
+
+#include <stdint.h>
+
+// Fixed-point complex FFT for the integer filter path (stft_fixed.h), in the
+// style of kissfft's FIXED_POINT build and the scaled mode of FPGA FFT
+// cores: radix-2, Q31 twiddles, and every pass halves its outputs with
+// rounding, so both directions are scaled by 1/n and can never overflow.
+// Power-of-two sizes only.
+//
+// Components must stay within +-FFT_FIXED_MAX: the window stage produces
+// values in that range and the spectral gain clamps to it, which leaves the
+// butterfly sums a bit of headroom in 32 bits.
+
+#define FFT_FIXED_MAX ((1 << 29) - 1)
+
+// Interleaved complex value with 32-bit integer parts
+typedef struct {
+    int32_t r;
+    int32_t i;
+} fft_fixed_cpx;
+
+typedef struct fft_fixed fft_fixed;
+
+// Returns NULL (with a message on stderr) for unsupported sizes
+fft_fixed *fft_fixed_alloc(int n, int inverse);
+void fft_fixed_free(fft_fixed *plan);
+
+// out = DFT(in) / n (conjugate twiddles for an inverse plan); out must not alias in
+void fft_fixed_run(const fft_fixed *plan, const fft_fixed_cpx *in, fft_fixed_cpx *out);
+
+// The same for a real input: in[k] becomes the real part, the imaginary parts are zero
+void fft_fixed_run_real(const fft_fixed *plan, const int32_t *in, fft_fixed_cpx *out);
+
+#endif
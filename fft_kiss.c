@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include "fft.h"
+#include "arena.h"
+#include "kissfft/kiss_fft.h"
+#include "kissfft/kiss_fftr.h"
+
+// fft_cpx is passed to kissfft as kiss_fft_cpx
+typedef char fft_cpx_matches_kiss[sizeof(fft_cpx) == sizeof(kiss_fft_cpx) ? 1 : -1];
+
+struct fft_kiss_real {
+    kiss_fftr_cfg fwd;
+    kiss_fftr_cfg inv;
+};
+
+struct fft_kiss_complex {
+    kiss_fft_cfg cfg;
+};
+
+// kissfft takes caller memory through its mem/lenmem arguments: ask for the
+// size, then hand it a block from arena_alloc
+static kiss_fftr_cfg real_cfg(int n, int inverse) {
+    size_t len = 0;
+    kiss_fftr_alloc(n, inverse, NULL, &len);
+    void *mem = len > 0 ? arena_alloc(len) : NULL;
+    kiss_fftr_cfg cfg = mem != NULL ? kiss_fftr_alloc(n, inverse, mem, &len) : NULL;
+    if (cfg == NULL) {
+        arena_free(mem);
+    }
+    return cfg;
+}
+
+static kiss_fft_cfg complex_cfg(int n, int inverse) {
+    size_t len = 0;
+    kiss_fft_alloc(n, inverse, NULL, &len);
+    void *mem = len > 0 ? arena_alloc(len) : NULL;
+    kiss_fft_cfg cfg = mem != NULL ? kiss_fft_alloc(n, inverse, mem, &len) : NULL;
+    if (cfg == NULL) {
+        arena_free(mem);
+    }
+    return cfg;
+}
+
+fft_kiss_real *fft_kiss_real_alloc(int n) {
+    fft_kiss_real *plan = (fft_kiss_real *)arena_calloc(1, sizeof(fft_kiss_real));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->fwd = real_cfg(n, 0);
+    plan->inv = real_cfg(n, 1);
+    if (plan->fwd == NULL || plan->inv == NULL) {
+        fft_kiss_real_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_kiss_real_forward(fft_kiss_real *plan, const float *in, fft_cpx *out) {
+    kiss_fftr(plan->fwd, in, (kiss_fft_cpx *)out);
+}
+
+void fft_kiss_real_inverse(fft_kiss_real *plan, const fft_cpx *in, float *out) {
+    kiss_fftri(plan->inv, (const kiss_fft_cpx *)in, out);
+}
+
+void fft_kiss_real_free(fft_kiss_real *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    arena_free(plan->fwd);
+    arena_free(plan->inv);
+    arena_free(plan);
+}
+
+fft_kiss_complex *fft_kiss_complex_alloc(int n, int inverse) {
+    fft_kiss_complex *plan = (fft_kiss_complex *)arena_calloc(1, sizeof(fft_kiss_complex));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->cfg = complex_cfg(n, inverse);
+    if (plan->cfg == NULL) {
+        arena_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_kiss_complex_run(fft_kiss_complex *plan, const fft_cpx *in, fft_cpx *out) {
+    kiss_fft(plan->cfg, (const kiss_fft_cpx *)in, (kiss_fft_cpx *)out);
+}
+
+void fft_kiss_complex_free(fft_kiss_complex *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    arena_free(plan->cfg);
+    arena_free(plan);
+}
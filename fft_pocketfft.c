@@ -0,0 +1,134 @@
+#include "fft.h"
+
+#ifdef FFT_HAVE_POCKETFFT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pocketfft/pocketfft.h"
+#include "arena.h"
+
+// pocketfft works in double precision and keeps real spectra in its
+// halfcomplex order (r0, r1, i1, ..., r[n/2]), so each call converts through
+// a per-plan double buffer. pocketfft allocates its plans itself, so they
+// come from the heap even when the rest of a filter is built in an arena.
+
+struct fft_pocketfft_real {
+    int n;
+    rfft_plan plan;
+    double *buf;
+};
+
+struct fft_pocketfft_complex {
+    int n;
+    int inverse;
+    cfft_plan plan;
+    double *buf;  // n interleaved re/im pairs
+};
+
+fft_pocketfft_real *fft_pocketfft_real_alloc(int n) {
+    fft_pocketfft_real *plan = (fft_pocketfft_real *)arena_calloc(1, sizeof(fft_pocketfft_real));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->n = n;
+    plan->plan = make_rfft_plan((size_t)n);
+    plan->buf = (double *)arena_alloc(sizeof(double) * n);
+    if (plan->plan == NULL || plan->buf == NULL) {
+        fft_pocketfft_real_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_pocketfft_real_forward(fft_pocketfft_real *plan, const float *in, fft_cpx *out) {
+    int n = plan->n;
+    for (int i = 0; i < n; i++) {
+        plan->buf[i] = in[i];
+    }
+    rfft_forward(plan->plan, plan->buf, 1.0);
+
+    out[0].r = (float)plan->buf[0];
+    out[0].i = 0.0f;
+    for (int k = 1; 2 * k < n; k++) {
+        out[k].r = (float)plan->buf[2 * k - 1];
+        out[k].i = (float)plan->buf[2 * k];
+    }
+    if (n % 2 == 0) {
+        out[n / 2].r = (float)plan->buf[n - 1];
+        out[n / 2].i = 0.0f;
+    }
+}
+
+void fft_pocketfft_real_inverse(fft_pocketfft_real *plan, const fft_cpx *in, float *out) {
+    int n = plan->n;
+    plan->buf[0] = in[0].r;
+    for (int k = 1; 2 * k < n; k++) {
+        plan->buf[2 * k - 1] = in[k].r;
+        plan->buf[2 * k] = in[k].i;
+    }
+    if (n % 2 == 0) {
+        plan->buf[n - 1] = in[n / 2].r;
+    }
+    rfft_backward(plan->plan, plan->buf, 1.0);
+
+    for (int i = 0; i < n; i++) {
+        out[i] = (float)plan->buf[i];
+    }
+}
+
+void fft_pocketfft_real_free(fft_pocketfft_real *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    if (plan->plan != NULL) {
+        destroy_rfft_plan(plan->plan);
+    }
+    arena_free(plan->buf);
+    arena_free(plan);
+}
+
+fft_pocketfft_complex *fft_pocketfft_complex_alloc(int n, int inverse) {
+    fft_pocketfft_complex *plan = (fft_pocketfft_complex *)arena_calloc(1, sizeof(fft_pocketfft_complex));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->n = n;
+    plan->inverse = inverse;
+    plan->plan = make_cfft_plan((size_t)n);
+    plan->buf = (double *)arena_alloc(sizeof(double) * 2 * n);
+    if (plan->plan == NULL || plan->buf == NULL) {
+        fft_pocketfft_complex_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void fft_pocketfft_complex_run(fft_pocketfft_complex *plan, const fft_cpx *in, fft_cpx *out) {
+    int n = plan->n;
+    for (int k = 0; k < n; k++) {
+        plan->buf[2 * k] = in[k].r;
+        plan->buf[2 * k + 1] = in[k].i;
+    }
+    if (plan->inverse) {
+        cfft_backward(plan->plan, plan->buf, 1.0);
+    } else {
+        cfft_forward(plan->plan, plan->buf, 1.0);
+    }
+    for (int k = 0; k < n; k++) {
+        out[k].r = (float)plan->buf[2 * k];
+        out[k].i = (float)plan->buf[2 * k + 1];
+    }
+}
+
+void fft_pocketfft_complex_free(fft_pocketfft_complex *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    if (plan->plan != NULL) {
+        destroy_cfft_plan(plan->plan);
+    }
+    arena_free(plan->buf);
+    arena_free(plan);
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "fft.h"
+
+// Times every compiled-in FFT backend on real forward+inverse transforms of
+// the frame sizes the filters will use and records the fastest one, e.g.
+//
+//   ./fft_tune --frame 1024 --frame 4096 -o fft_backend.conf
+//
+// The output holds a FFT_BACKEND=<name> line to pass on as -DFFT_BACKEND.
+// A backend that cannot do a size, or whose result differs from kissfft by
+// more than float rounding, is left out for the whole run.
+
+#define TUNE_MAX_FRAMES 16
+#define TUNE_MIN_SECONDS 0.2
+#define TUNE_TOLERANCE 1e-4
+
+typedef void *(*tune_alloc_fn)(int n);
+typedef void (*tune_forward_fn)(void *plan, const float *in, fft_cpx *out);
+typedef void (*tune_inverse_fn)(void *plan, const fft_cpx *in, float *out);
+typedef void (*tune_free_fn)(void *plan);
+
+typedef struct {
+    const char *name;
+    tune_alloc_fn alloc;
+    tune_forward_fn forward;
+    tune_inverse_fn inverse;
+    tune_free_fn release;
+    int usable;
+    double totalSeconds;   // summed per-transform time over all sizes
+} tune_backend;
+
+#define TUNE_BACKEND(b)                                     \
+    {#b, (tune_alloc_fn)fft_##b##_real_alloc,               \
+     (tune_forward_fn)fft_##b##_real_forward,               \
+     (tune_inverse_fn)fft_##b##_real_inverse,               \
+     (tune_free_fn)fft_##b##_real_free, 1, 0.0}
+
+static tune_backend backends[] = {
+    TUNE_BACKEND(kiss),
+    TUNE_BACKEND(builtin),
+#ifdef FFT_HAVE_POCKETFFT
+    TUNE_BACKEND(pocketfft),
+#endif
+};
+
+#define NUM_BACKENDS ((int)(sizeof(backends) / sizeof(backends[0])))
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Largest bin difference from the reference spectrum, relative to its peak
+static double spectrum_error(const fft_cpx *a, const fft_cpx *ref, int bins) {
+    double peak = 0.0, err = 0.0;
+    for (int k = 0; k < bins; k++) {
+        peak = fmax(peak, hypot(ref[k].r, ref[k].i));
+        err = fmax(err, hypot(a[k].r - ref[k].r, a[k].i - ref[k].i));
+    }
+    return peak > 0.0 ? err / peak : err;
+}
+
+// Seconds per forward+inverse pair, or a negative value if the backend fails
+static double time_backend(tune_backend *b, int n, const float *signal, const fft_cpx *reference) {
+    int bins = n / 2 + 1;
+    void *plan = b->alloc(n);
+    if (plan == NULL) {
+        return -1.0;
+    }
+    float *time = (float *)malloc(sizeof(float) * n);
+    fft_cpx *spectrum = (fft_cpx *)malloc(sizeof(fft_cpx) * bins);
+    if (time == NULL || spectrum == NULL) {
+        free(time);
+        free(spectrum);
+        b->release(plan);
+        return -1.0;
+    }
+
+    double result = -1.0;
+    b->forward(plan, signal, spectrum);
+    double err = spectrum_error(spectrum, reference, bins);
+    if (err > TUNE_TOLERANCE) {
+        fprintf(stderr, "Warning: %s differs from kiss by %.3g at frame %d\n", b->name, err, n);
+    } else {
+        // Double the repetitions until one run takes long enough to time
+        long reps = 1;
+        double elapsed = 0.0;
+        for (;;) {
+            double start = now_seconds();
+            for (long r = 0; r < reps; r++) {
+                b->forward(plan, signal, spectrum);
+                b->inverse(plan, spectrum, time);
+            }
+            elapsed = now_seconds() - start;
+            if (elapsed >= TUNE_MIN_SECONDS) {
+                break;
+            }
+            reps *= 2;
+        }
+        result = elapsed / reps;
+    }
+
+    free(time);
+    free(spectrum);
+    b->release(plan);
+    return result;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --frame N [--frame N ...] [-o output.conf]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int frames[TUNE_MAX_FRAMES];
+    int numFrames = 0;
+    const char *outputFile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            if (n < 2 || n % 2 != 0 || numFrames == TUNE_MAX_FRAMES) {
+                fprintf(stderr, "Error: Frame sizes must be even and at most %d may be given\n", TUNE_MAX_FRAMES);
+                return 1;
+            }
+            frames[numFrames++] = n;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (numFrames == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("%-10s", "frame");
+    for (int b = 0; b < NUM_BACKENDS; b++) {
+        printf(" %12s", backends[b].name);
+    }
+    printf("\n");
+
+    for (int f = 0; f < numFrames; f++) {
+        int n = frames[f];
+        float *signal = (float *)malloc(sizeof(float) * n);
+        fft_cpx *reference = (fft_cpx *)malloc(sizeof(fft_cpx) * (n / 2 + 1));
+        fft_kiss_real *kiss = fft_kiss_real_alloc(n);
+        if (signal == NULL || reference == NULL || kiss == NULL) {
+            fprintf(stderr, "Error: Failed to allocate buffers for frame %d\n", n);
+            return 1;
+        }
+        srand(1);
+        for (int i = 0; i < n; i++) {
+            signal[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        }
+        fft_kiss_real_forward(kiss, signal, reference);
+        fft_kiss_real_free(kiss);
+
+        printf("%-10d", n);
+        for (int b = 0; b < NUM_BACKENDS; b++) {
+            double seconds = backends[b].usable ? time_backend(&backends[b], n, signal, reference) : -1.0;
+            if (seconds < 0.0) {
+                backends[b].usable = 0;
+                printf(" %12s", "-");
+            } else {
+                backends[b].totalSeconds += seconds;
+                printf(" %10.2fus", seconds * 1e6);
+            }
+        }
+        printf("\n");
+        free(signal);
+        free(reference);
+    }
+
+    const tune_backend *best = NULL;
+    for (int b = 0; b < NUM_BACKENDS; b++) {
+        if (backends[b].usable && (best == NULL || backends[b].totalSeconds < best->totalSeconds)) {
+            best = &backends[b];
+        }
+    }
+    if (best == NULL) {
+        fprintf(stderr, "Error: No backend handles every requested frame size\n");
+        return 1;
+    }
+    printf("Fastest: %s\n", best->name);
+
+    if (outputFile != NULL) {
+        FILE *out = fopen(outputFile, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Error: Could not open %s for writing\n", outputFile);
+            return 1;
+        }
+        fprintf(out, "# Written by fft_tune for frame size(s)");
+        for (int f = 0; f < numFrames; f++) {
+            fprintf(out, " %d", frames[f]);
+        }
+        fprintf(out, "; build with -DFFT_BACKEND=<value>\n");
+        fprintf(out, "FFT_BACKEND=%s\n", best->name);
+        if (fclose(out) != 0) {
+            fprintf(stderr, "Error: Could not write %s\n", outputFile);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "modulator.h"
+
+void pdm_mod_config_default(pdm_mod_config *cfg) {
+    cfg->order = 1;
+    cfg->width = 24;
+    cfg->oversample = 64;
+}
+
+const char *pdm_mod_config_check(const pdm_mod_config *cfg) {
+    if (cfg->order != 1 && cfg->order != 2) {
+        return "the order must be 1 or 2";
+    }
+    // Order 1 keeps its running sums in 32 bits, wrapping (see process_first)
+    if (cfg->width < 2 || cfg->width > 24) {
+        return "the input width must be 2..24 bits";
+    }
+    if (cfg->oversample < 1 || cfg->oversample > 65536) {
+        return "the oversampling ratio must be 1..65536";
+    }
+    return NULL;
+}
+
+int pdm_mod_init(pdm_mod *st, const pdm_mod_config *cfg) {
+    memset(st, 0, sizeof(*st));
+    const char *problem = pdm_mod_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid PDM modulator configuration: %s\n", problem);
+        return -1;
+    }
+    st->cfg = *cfg;
+    st->kernels = dsp_kernels_get();
+    if (cfg->order == 1) {
+        st->sums = (uint32_t *)malloc(sizeof(uint32_t) * (PDM_MOD_BLOCK + 1));
+        if (st->sums == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void pdm_mod_free(pdm_mod *st) {
+    free(st->sums);
+    memset(st, 0, sizeof(*st));
+}
+
+void pdm_mod_reset(pdm_mod *st) {
+    st->integ[0] = 0;
+    st->integ[1] = 0;
+}
+
+// Order 1 without the feedback. In ds_gen.py's loop the running sum r stays
+// in (-H/2, H/2], so after n steps the ones taken off number
+// ceil((R_n - H/2) / H) for the plain sum R_n = r_0 + u_1 + ... + u_n, and
+// step n outputs 1 exactly where (R_n + 3H/2 - 1) >> width steps up. That
+// holds for the sum modulo 2^32 too, as one step adds less than H: the
+// kernel finds every step up in a block from the sums alone, many at once.
+// The held input makes each sample's sums an arithmetic sequence.
+static void process_first(pdm_mod *st, const int32_t *in, size_t count, uint64_t *words) {
+    const int width = st->cfg.width;
+    const int osr = st->cfg.oversample;
+    const uint32_t H = 1u << width, half = H / 2, bias = H + half - 1;
+    uint32_t sum = (uint32_t)st->integ[0] + bias;
+    size_t total = count * (size_t)osr;
+    size_t i = 0;
+    int taken = 0;  // steps of sample i so far
+    for (size_t done = 0; done < total; done += PDM_MOD_BLOCK) {
+        int block = total - done < PDM_MOD_BLOCK ? (int)(total - done) : PDM_MOD_BLOCK;
+        uint32_t *s = st->sums;
+        s[0] = sum;
+        for (int k = 0; k < block;) {
+            uint32_t u = (uint32_t)(in[i] + (int32_t)half);
+            int run = osr - taken < block - k ? osr - taken : block - k;
+            for (int j = 1; j <= run; j++) {
+                s[k + j] = sum + (uint32_t)j * u;
+            }
+            sum += (uint32_t)run * u;
+            k += run;
+            taken += run;
+            if (taken == osr) {
+                i++;
+                taken = 0;
+            }
+        }
+        st->kernels->sd_bits(s, block, width, words + done / 64);
+    }
+    uint32_t r = (sum - bias) & (H - 1);
+    st->integ[0] = r > half ? (int64_t)r - H : (int64_t)r;
+}
+
+static int64_t saturate(int64_t x, int64_t limit) {
+    return x > limit ? limit : x < -limit ? -limit : x;
+}
+
+// Order 2 feeds every bit back into the next step, so it runs one clock at
+// a time; branch-free, with the bits gathered a word at a time
+static void process_second(pdm_mod *st, const int32_t *in, size_t count, uint64_t *words) {
+    const int64_t fs = (int64_t)1 << (st->cfg.width - 1);
+    const int64_t lim1 = PDM_MOD2_LIMIT1 * fs, lim2 = PDM_MOD2_LIMIT2 * fs;
+    const int osr = st->cfg.oversample;
+    int64_t x1 = st->integ[0], x2 = st->integ[1];
+    uint64_t w = 0;
+    int pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t x = in[i];
+        for (int n = 0; n < osr; n++) {
+            uint64_t bit = x2 >= 0;
+            int64_t y = ((int64_t)bit * 2 - 1) * fs;
+            x1 = saturate(x1 + x - y, lim1);
+            x2 = saturate(x2 + x1 - y, lim2);
+            w |= bit << pos;
+            if (++pos == 64) {
+                *words++ = w;
+                w = 0;
+                pos = 0;
+            }
+        }
+    }
+    if (pos > 0) {
+        *words = w;
+    }
+    st->integ[0] = x1;
+    st->integ[1] = x2;
+}
+
+size_t pdm_mod_process(pdm_mod *st, const int32_t *in, size_t count, uint64_t *words) {
+    if (st->cfg.order == 1) {
+        process_first(st, in, count, words);
+    } else {
+        process_second(st, in, count, words);
+    }
+    return count * (size_t)st->cfg.oversample;
+}
+
+size_t pdm_mod_ref_process(pdm_mod *st, const int32_t *in, size_t count, unsigned char *bits) {
+    const int64_t fs = (int64_t)1 << (st->cfg.width - 1);
+    size_t k = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (int n = 0; n < st->cfg.oversample; n++) {
+            if (st->cfg.order == 1) {
+                // running_sum += sample; if running_sum > THRESHOLD: ...
+                st->integ[0] += in[i] + fs;
+                bits[k] = 0;
+                if (st->integ[0] > fs) {
+                    st->integ[0] -= 2 * fs;
+                    bits[k] = 1;
+                }
+            } else {
+                bits[k] = st->integ[1] >= 0;
+                int64_t y = bits[k] ? fs : -fs;
+                st->integ[0] = saturate(st->integ[0] + in[i] - y, PDM_MOD2_LIMIT1 * fs);
+                st->integ[1] = saturate(st->integ[1] + st->integ[0] - y, PDM_MOD2_LIMIT2 * fs);
+            }
+            k++;
+        }
+    }
+    return k;
+}
+
+void pwm_mod_config_default(pwm_mod_config *cfg) {
+    cfg->bitDepth = 8;
+    cfg->width = 24;
+    cfg->order = 0;
+}
+
+const char *pwm_mod_config_check(const pwm_mod_config *cfg) {
+    if (cfg->bitDepth < 1 || cfg->bitDepth > 16) {
+        return "the bit depth must be 1..16";
+    }
+    if (cfg->width < cfg->bitDepth || cfg->width > 24) {
+        return "the input width must be from the bit depth up to 24 bits";
+    }
+    if (cfg->order < 0 || cfg->order > 2) {
+        return "the noise-shaping order must be 0..2";
+    }
+    return NULL;
+}
+
+int pwm_mod_init(pwm_mod *st, const pwm_mod_config *cfg) {
+    memset(st, 0, sizeof(*st));
+    const char *problem = pwm_mod_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid PWM modulator configuration: %s\n", problem);
+        return -1;
+    }
+    st->cfg = *cfg;
+    return 0;
+}
+
+void pwm_mod_reset(pwm_mod *st) {
+    st->err[0] = 0;
+    st->err[1] = 0;
+}
+
+// pcm_data for one sample: the unsigned input u = x + 2^(width-1) cut to
+// bitDepth bits. With noise shaping the previous errors are added first and
+// the cut rounds; the new error is kept within one step so that clipping at
+// either end cannot wind the loop up.
+static int64_t pwm_level(pwm_mod *st, int32_t x) {
+    const int shift = st->cfg.width - st->cfg.bitDepth;
+    const int64_t step = (int64_t)1 << shift, top = ((int64_t)1 << st->cfg.bitDepth) - 1;
+    int64_t u = (int64_t)x + ((int64_t)1 << (st->cfg.width - 1));
+    if (st->cfg.order == 0) {
+        return u >> shift;
+    }
+    int64_t v = u + (st->cfg.order == 1 ? st->err[0] : 2 * st->err[0] - st->err[1]);
+    int64_t t = v + step / 2;
+    int64_t level = t < 0 ? 0 : t >> shift;
+    level = level > top ? top : level;
+    st->err[1] = st->err[0];
+    st->err[0] = saturate(v - level * step, step);
+    return level;
+}
+
+// Set bits [pos, pos + len) of zeroed words
+static void set_ones(uint64_t *words, size_t pos, size_t len) {
+    while (len > 0) {
+        int off = (int)(pos % 64);
+        size_t n = 64 - (size_t)off < len ? 64 - (size_t)off : len;
+        words[pos / 64] |= (n == 64 ? ~0ULL : (1ULL << n) - 1) << off;
+        pos += n;
+        len -= n;
+    }
+}
+
+// A period is level ones and then zeros, so it is written a run at a time:
+// whole words for the usual depths of 6 bits and more
+size_t pwm_mod_process(pwm_mod *st, const int32_t *in, size_t count, uint64_t *words) {
+    const size_t period = (size_t)1 << st->cfg.bitDepth;
+    memset(words, 0, sizeof(uint64_t) * ((count * period + 63) / 64));
+    for (size_t i = 0; i < count; i++) {
+        set_ones(words, i * period, (size_t)pwm_level(st, in[i]));
+    }
+    return count * period;
+}
+
+// The register transfer of pcm_to_pwm for one period per sample: pwm_out
+// after each count. The count == 2**BIT_DEPTH branch never fires, as the
+// BIT_DEPTH-bit counter wraps first, so a period is 2^BIT_DEPTH clocks.
+size_t pwm_mod_ref_process(pwm_mod *st, const int32_t *in, size_t count, unsigned char *bits) {
+    const uint32_t period = 1u << st->cfg.bitDepth;
+    size_t k = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t pcmData = (uint32_t)pwm_level(st, in[i]);
+        for (uint32_t c = 0; c < period; c++) {
+            bits[k++] = c < pcmData ? 1 : 0;
+        }
+    }
+    return k;
+}
+
+void mod_from_float(const float *in, int width, int32_t *out, size_t count) {
+    const float scale = (float)(1L << (width - 1));
+    const float lo = -scale, hi = scale - 1.0f;
+    for (size_t i = 0; i < count; i++) {
+        float v = in[i] * scale;
+        v = v < lo ? lo : v > hi ? hi : v;
+        out[i] = (int32_t)lrintf(v);
+    }
+}
+
+// Bits 0..31 of x to the even bits of the result
+static uint64_t spread_bits(uint64_t x) {
+    x &= 0xffffffffULL;
+    x = (x | x << 16) & 0x0000ffff0000ffffULL;
+    x = (x | x << 8) & 0x00ff00ff00ff00ffULL;
+    x = (x | x << 4) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | x << 2) & 0x3333333333333333ULL;
+    return (x | x << 1) & 0x5555555555555555ULL;
+}
+
+void mod_interleave(const uint64_t *const *planes, int channels, size_t bitsPerChannel, uint64_t *out) {
+    size_t outWords = (channels * bitsPerChannel + 63) / 64;
+    if (channels == 1) {
+        memcpy(out, planes[0], sizeof(uint64_t) * outWords);
+        return;
+    }
+    if (channels == 2) {
+        for (size_t k = 0; k < outWords; k++) {
+            int half = 32 * (int)(k % 2);
+            out[k] = spread_bits(planes[0][k / 2] >> half) | spread_bits(planes[1][k / 2] >> half) << 1;
+        }
+        return;
+    }
+    memset(out, 0, sizeof(uint64_t) * outWords);
+    for (size_t i = 0; i < bitsPerChannel; i++) {
+        for (int c = 0; c < channels; c++) {
+            size_t b = i * channels + c;
+            out[b / 64] |= ((planes[c][i / 64] >> (i % 64)) & 1) << (b % 64);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef MODULATOR_H
+#define MODULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dsp_kernels.h"
+
+// Software models of the speaker-side modulators, PCM in, 1-bit stream out:
+//
+//   pdm_mod   pcm_to_pdm.sv: PCM scaled to `width` bits and held for
+//             `oversample` PDM clocks, each clock one sigma-delta step.
+//             Order 1 is the loop of tbs/ds_gen.py on integers: a running
+//             sum of the unipolar input u = x + 2^(width-1) in [0, H),
+//             H = 2^width; a step whose sum exceeds H/2 outputs 1 and takes
+//             H off. Order 2 is the classic double-integrator loop with
+//             noise transfer (1 - z^-1)^2, x1 += x - y, x2 += x1 - y with
+//             y = +-2^(width-1) by the sign of x2, both integrators
+//             saturating at PDM_MOD2_LIMIT1 / PDM_MOD2_LIMIT2 full scales.
+//   pwm_mod   pcm_to_pwm.sv: every sample requantized to bitDepth bits,
+//             unsigned, and played as one counter period of 2^bitDepth
+//             clocks, high while count < pcm_data
+//
+// Inputs are two's complement values of cfg.width bits; outputs are packed
+// LSB first, bit i of a call in bit i % 64 of word i / 64 (the pdm_file.h
+// layout). Calls may be chained as long as every call but the last produces
+// a multiple of 64 bits. Each model also has a reference that takes one
+// clock per step, transcribing the loop as written, for --check.
+
+#define PDM_MOD_BLOCK 4096      // order-1 bits per kernel call
+#define PDM_MOD2_LIMIT1 2       // x1 saturation, full scales
+#define PDM_MOD2_LIMIT2 8       // x2 saturation, full scales
+
+typedef struct {
+    int order;        // 1 or 2
+    int width;        // input bits, 2..24 (pcm_to_pdm scales to 24)
+    int oversample;   // PDM clocks per PCM sample
+} pdm_mod_config;
+
+// First order, 24-bit input, 64 clocks per sample (3.072 MHz from 48 kHz)
+void pdm_mod_config_default(pdm_mod_config *cfg);
+
+// Returns NULL if the configuration can be modelled, otherwise why not
+const char *pdm_mod_config_check(const pdm_mod_config *cfg);
+
+typedef struct {
+    pdm_mod_config cfg;
+    const dsp_kernels *kernels;
+    int64_t integ[2];   // order 1: running sum in (-H/2, H/2]; order 2: x1, x2
+    uint32_t *sums;     // order 1: PDM_MOD_BLOCK + 1 running sums
+} pdm_mod;
+
+// Returns 0, or -1 with a message
+int pdm_mod_init(pdm_mod *st, const pdm_mod_config *cfg);
+void pdm_mod_free(pdm_mod *st);
+void pdm_mod_reset(pdm_mod *st);
+
+// Modulate count samples into count * oversample bits; returns the bits
+size_t pdm_mod_process(pdm_mod *st, const int32_t *in, size_t count, uint64_t *words);
+
+// The same one clock at a time, one bit (0 or 1) per byte
+size_t pdm_mod_ref_process(pdm_mod *st, const int32_t *in, size_t count, unsigned char *bits);
+
+typedef struct {
+    int bitDepth;     // BIT_DEPTH of pcm_to_pwm, 1..16
+    int width;        // input bits, bitDepth..24
+    int order;        // noise shaping of the requantization: 0 keeps the
+                      // top bitDepth bits, as wiring them up does; 1 or 2
+                      // feeds the error back with (1 - z^-1)^order
+} pwm_mod_config;
+
+// BIT_DEPTH 8 from 24-bit input, truncated
+void pwm_mod_config_default(pwm_mod_config *cfg);
+
+const char *pwm_mod_config_check(const pwm_mod_config *cfg);
+
+typedef struct {
+    pwm_mod_config cfg;
+    int64_t err[2];     // last requantization errors
+} pwm_mod;
+
+int pwm_mod_init(pwm_mod *st, const pwm_mod_config *cfg);
+void pwm_mod_reset(pwm_mod *st);
+
+// count samples into count << bitDepth bits; returns the bits
+size_t pwm_mod_process(pwm_mod *st, const int32_t *in, size_t count, uint64_t *words);
+
+// The counter of pcm_to_pwm one clock at a time, one bit per byte
+size_t pwm_mod_ref_process(pwm_mod *st, const int32_t *in, size_t count, unsigned char *bits);
+
+// -1..1 floats -> width-bit two's complement, rounded and saturated; exact
+// for PCM16 input at any width >= 16, as pcm_to_pdm's left shift is
+void mod_from_float(const float *in, int width, int32_t *out, size_t count);
+
+// Interleave channels per clock, channel c on bits c, c + channels, ...
+// (the pdm_file.h layout): bitsPerChannel bits of each plane in,
+// channels * bitsPerChannel bits out
+void mod_interleave(const uint64_t *const *planes, int channels, size_t bitsPerChannel, uint64_t *out);
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "pdm_decim.h"
+#include "pdm_file.h"
+#include "wav_io.h"
+
+// Converts a raw PDM capture to a PCM16 WAV that wav_processor takes as is:
+//
+//   ./pdm2wav capture.pdm capture.wav
+//   ./pdm2wav --rate 2304000 --decimation 48 --channels 2 stereo.pdm out.wav
+//
+// The input is a packed .pdm capture, whose header gives the rate, bit order
+// and channels, or the bare bit stream: 8 bits per byte in clock order, LSB
+// first unless --msb-first; "-" reads stdin. With --channels 2 two
+// microphones share the clock and data line, left on the even bits. The
+// file is streamed, so captures of any length convert in constant memory.
+
+#define CHUNK_WORDS 8192            // 64 KiB of PDM per read
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input.pdm|raw_bits|-> <output.wav>\n", prog);
+    fprintf(stderr, "  (--rate, --channels and --msb-first describe raw input; a .pdm header overrides them)\n");
+    fprintf(stderr, "  --rate HZ             PDM clock rate (default 3072000)\n");
+    fprintf(stderr, "  --decimation N        PDM rate / PCM rate (default 64)\n");
+    fprintf(stderr, "  --halfbands N         decimate-by-2 halfband stages after the compensation\n");
+    fprintf(stderr, "                        FIR; the CIC takes the rest (default 2)\n");
+    fprintf(stderr, "  --cic-stages N        CIC order (default 5)\n");
+    fprintf(stderr, "  --passband F          flat band edge as a fraction of the output Nyquist\n");
+    fprintf(stderr, "                        (default 0.9)\n");
+    fprintf(stderr, "  --stopband DB         alias rejection of the FIR stages (default 100)\n");
+    fprintf(stderr, "  --channels 1|2        microphones on the data line (default 1)\n");
+    fprintf(stderr, "  --msb-first           first bit of each byte in its top bit\n");
+    fprintf(stderr, "  --gain DB             gain before the PCM16 conversion (default 0)\n");
+    fprintf(stderr, "  --kernels NAME        force the DSP kernel set: scalar, sse2, avx2, avx512\n");
+}
+
+// Value of an option that takes an argument; NULL (with a message) if missing
+static const char *option_value(int argc, char *argv[], int *argi) {
+    if (*argi + 1 >= argc) {
+        fprintf(stderr, "Error: Option '%s' needs a value\n", argv[*argi]);
+        return NULL;
+    }
+    return argv[++*argi];
+}
+
+static unsigned char reverse_bits(unsigned char b) {
+    b = (unsigned char)((b & 0xf0) >> 4 | (b & 0x0f) << 4);
+    b = (unsigned char)((b & 0xcc) >> 2 | (b & 0x33) << 2);
+    return (unsigned char)((b & 0xaa) >> 1 | (b & 0x55) << 1);
+}
+
+// Bytes in stream order -> words with stream bit i at bit i % 64
+static void pack_words(const unsigned char *bytes, size_t count, int msbFirst, uint64_t *words) {
+    memset(words, 0, sizeof(uint64_t) * ((count + 7) / 8));
+    for (size_t i = 0; i < count; i++) {
+        unsigned char b = msbFirst ? reverse_bits(bytes[i]) : bytes[i];
+        words[i / 8] |= (uint64_t)b << (8 * (i % 8));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    pdm_decim_config cfg;
+    pdm_decim_config_default(&cfg);
+    int channels = 1;
+    int msbFirst = 0;
+    double gainDb = 0.0;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        const char *opt = argv[argi];
+        const char *value = NULL;
+        if (strcmp(opt, "--msb-first") == 0) {
+            msbFirst = 1;
+            continue;
+        }
+        if ((value = option_value(argc, argv, &argi)) == NULL) {
+            return 1;
+        }
+        if (strcmp(opt, "--rate") == 0) {
+            cfg.pdmRate = atoi(value);
+        } else if (strcmp(opt, "--decimation") == 0) {
+            cfg.decimation = atoi(value);
+        } else if (strcmp(opt, "--halfbands") == 0) {
+            cfg.halfbands = atoi(value);
+        } else if (strcmp(opt, "--cic-stages") == 0) {
+            cfg.cicStages = atoi(value);
+        } else if (strcmp(opt, "--passband") == 0) {
+            cfg.passband = atof(value);
+        } else if (strcmp(opt, "--stopband") == 0) {
+            cfg.stopbandDb = atof(value);
+        } else if (strcmp(opt, "--channels") == 0) {
+            channels = atoi(value);
+            if (channels != 1 && channels != 2) {
+                fprintf(stderr, "Error: --channels must be 1 or 2\n");
+                return 1;
+            }
+        } else if (strcmp(opt, "--gain") == 0) {
+            gainDb = atof(value);
+        } else if (strcmp(opt, "--kernels") == 0) {
+            if (dsp_kernels_select(value) != 0) {
+                fprintf(stderr, "Error: Kernel set '%s' is unknown or not supported by this CPU\n", value);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - argi != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *inPath = argv[argi];
+    const char *outPath = argv[argi + 1];
+
+    pdm_reader packed;
+    int isPacked = strcmp(inPath, "-") != 0 && pdm_file_probe(inPath);
+    if (isPacked) {
+        if (pdm_reader_open(&packed, inPath) != 0) {
+            return 1;
+        }
+        cfg.pdmRate = packed.info.bitRate;
+        channels = packed.info.channels;
+        if (channels != 1 && channels != 2) {
+            fprintf(stderr, "Error: '%s' holds %d channels; 1 or 2 are supported\n", inPath, channels);
+            pdm_reader_close(&packed);
+            return 1;
+        }
+    }
+
+    // Each microphone sees every channels-th clock edge
+    pdm_decim_config chanCfg = cfg;
+    chanCfg.pdmRate = cfg.pdmRate / channels;
+    if (cfg.pdmRate % channels != 0 || chanCfg.pdmRate % cfg.decimation != 0) {
+        fprintf(stderr, "Error: The PDM rate per channel (%d Hz) is not a multiple of the decimation %d\n",
+                chanCfg.pdmRate, cfg.decimation);
+        if (isPacked) {
+            pdm_reader_close(&packed);
+        }
+        return 1;
+    }
+    int pcmRate = chanCfg.pdmRate / cfg.decimation;
+
+    FILE *in = NULL;
+    sf_count_t expected = 0;
+    if (isPacked) {
+        expected = (sf_count_t)(packed.info.numBits / channels / cfg.decimation);
+    } else {
+        in = strcmp(inPath, "-") == 0 ? stdin : fopen(inPath, "rb");
+        if (in == NULL) {
+            fprintf(stderr, "Error: Could not open input file '%s'\n", inPath);
+            return 1;
+        }
+        struct stat info;
+        if (in != stdin && stat(inPath, &info) == 0) {
+            expected = (sf_count_t)info.st_size * 8 / channels / cfg.decimation;
+        }
+    }
+
+    pdm_decim decim[2];
+    int ready = 0;
+    while (ready < channels && pdm_decim_init(&decim[ready], &chanCfg) == 0) {
+        ready++;
+    }
+    unsigned char *bytes = (unsigned char *)malloc(CHUNK_WORDS * 8);
+    uint64_t *words = (uint64_t *)malloc(sizeof(uint64_t) * CHUNK_WORDS);
+    uint64_t *split[2] = {words, NULL};
+    float *pcm[2] = {NULL, NULL};
+    int status = ready == channels && bytes != NULL && words != NULL ? 0 : -1;
+    if (status == 0 && channels == 2) {
+        split[0] = (uint64_t *)malloc(sizeof(uint64_t) * CHUNK_WORDS / 2);
+        split[1] = (uint64_t *)malloc(sizeof(uint64_t) * CHUNK_WORDS / 2);
+        status = split[0] != NULL && split[1] != NULL ? 0 : -1;
+    }
+    size_t maxOut = (size_t)CHUNK_WORDS * 64 / cfg.decimation + 1;
+    for (int c = 0; status == 0 && c < channels; c++) {
+        pcm[c] = (float *)malloc(sizeof(float) * maxOut);
+        status = pcm[c] != NULL ? 0 : -1;
+    }
+    if (status != 0 && ready == channels) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    }
+
+    wav_writer w;
+    int writerOpen = 0;
+    if (status == 0) {
+        status = wav_writer_open(&w, outPath, pcmRate, channels, expected, NULL);
+        writerOpen = status == 0;
+    }
+
+    float gain = (float)pow(10.0, gainDb / 20.0);
+    double start = now_seconds();
+    unsigned long long totalBits = 0;
+    sf_count_t totalFrames = 0;
+    while (status == 0) {
+        size_t bits;
+        if (isPacked) {
+            bits = pdm_reader_read(&packed, words, CHUNK_WORDS * 64);
+        } else {
+            size_t got = fread(bytes, 1, CHUNK_WORDS * 8, in);
+            pack_words(bytes, got, msbFirst, words);
+            bits = got * 8;
+        }
+        if (bits == 0) {
+            break;
+        }
+        totalBits += bits;
+
+        // A short read is the end of the stream, so only the last chunk can
+        // end mid-word
+        size_t frames = 0;
+        if (channels == 1) {
+            frames = pdm_decim_process(&decim[0], words, bits, pcm[0]);
+        } else {
+            pdm_unzip2(words, (bits + 63) / 64, split[0], split[1]);
+            size_t left = pdm_decim_process(&decim[0], split[0], (bits + 1) / 2, pcm[0]);
+            size_t right = pdm_decim_process(&decim[1], split[1], bits / 2, pcm[1]);
+            frames = left < right ? left : right;
+        }
+        if (gain != 1.0f) {
+            for (int c = 0; c < channels; c++) {
+                for (size_t i = 0; i < frames; i++) {
+                    pcm[c][i] *= gain;
+                }
+            }
+        }
+        status = wav_writer_write(&w, (const float *const *)pcm, (sf_count_t)frames);
+        totalFrames += (sf_count_t)frames;
+    }
+    if (status == 0 && in != NULL && ferror(in)) {
+        fprintf(stderr, "Error: Could not read '%s'\n", inPath);
+        status = -1;
+    }
+    if (writerOpen && wav_writer_close(&w) != 0) {
+        status = -1;
+    }
+    double elapsed = now_seconds() - start;
+    if (status == 0) {
+        double seconds = (double)totalFrames / pcmRate;
+        fprintf(stderr, "PDM: %llu bits -> %lld frames at %d Hz (%.1f s); %.1fx realtime\n",
+                totalBits, (long long)totalFrames, pcmRate, seconds, elapsed > 0.0 ? seconds / elapsed : 0.0);
+    }
+
+    if (isPacked) {
+        pdm_reader_close(&packed);
+    } else if (in != stdin) {
+        fclose(in);
+    }
+    for (int c = 0; c < ready; c++) {
+        pdm_decim_free(&decim[c]);
+    }
+    if (channels == 2) {
+        free(split[0]);
+        free(split[1]);
+    }
+    free(pcm[0]);
+    free(pcm[1]);
+    free(words);
+    free(bytes);
+    return status == 0 ? 0 : 1;
+}
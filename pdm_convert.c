@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "pdm_file.h"
+
+// Converts PDM bit streams between the text the testbenches load and packed
+// .pdm captures, losslessly:
+//
+//   ./pdm_convert pdm_cosine.txt pdm_cosine.pdm          $readmemb -> packed
+//   ./pdm_convert pdm_cosine.pdm pdm_cosine.txt          packed -> $readmemb
+//   ./pdm_convert --raw --rate 2304000 --channels 2 capture.bin capture.pdm
+//
+// The direction follows the input: a .pdm file becomes text, anything else
+// is parsed as $readmemb (or, with --raw, taken as bare bytes of bits, LSB
+// first) and packed. Text written back has one bit per line, as the stimulus
+// files do, so text -> .pdm -> text reproduces them byte for byte.
+
+#define CHUNK_WORDS 8192
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input> <output>\n", prog);
+    fprintf(stderr, "  --rate HZ             PDM clock rate to record (default 3072000)\n");
+    fprintf(stderr, "  --channels N          microphones interleaved on the data line (default 1)\n");
+    fprintf(stderr, "  --msb-first           store the first bit of each byte in its top bit\n");
+    fprintf(stderr, "  --raw                 the input is bare bytes of bits, LSB first, not text\n");
+}
+
+// Value of an option that takes an argument; NULL (with a message) if missing
+static const char *option_value(int argc, char *argv[], int *argi) {
+    if (*argi + 1 >= argc) {
+        fprintf(stderr, "Error: Option '%s' needs a value\n", argv[*argi]);
+        return NULL;
+    }
+    return argv[++*argi];
+}
+
+static int packed_to_text(const char *inPath, const char *outPath) {
+    pdm_reader r;
+    if (pdm_reader_open(&r, inPath) != 0) {
+        return -1;
+    }
+    size_t maxBits = (size_t)(r.info.numBits / 64 + 1) * 64;
+    uint64_t *words = (uint64_t *)malloc(maxBits / 8);
+    int status = -1;
+    if (words == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    } else {
+        size_t bits = pdm_reader_read(&r, words, maxBits);
+        status = pdm_write_readmemb(outPath, words, bits);
+    }
+    fprintf(stderr, "PDM: %llu bits, %d Hz, %d channel(s) -> %s\n",
+            (unsigned long long)r.info.numBits, r.info.bitRate, r.info.channels, outPath);
+    free(words);
+    pdm_reader_close(&r);
+    return status;
+}
+
+static int text_to_packed(const char *inPath, const char *outPath, int rate, int order, int channels) {
+    uint64_t *words = NULL;
+    long bits = pdm_read_readmemb(inPath, &words);
+    if (bits < 0) {
+        return -1;
+    }
+    pdm_writer w;
+    int status = pdm_writer_open(&w, outPath, rate, order, channels, (uint64_t)bits);
+    if (status == 0) {
+        status = pdm_writer_write(&w, words, (size_t)bits);
+        if (pdm_writer_close(&w) != 0) {
+            status = -1;
+        }
+    }
+    if (status == 0) {
+        fprintf(stderr, "PDM: %ld bits -> %s\n", bits, outPath);
+    }
+    free(words);
+    return status;
+}
+
+// Streamed, so captures of any length pack in constant memory
+static int raw_to_packed(const char *inPath, const char *outPath, int rate, int order, int channels) {
+    FILE *in = strcmp(inPath, "-") == 0 ? stdin : fopen(inPath, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Error: Could not open input file '%s'\n", inPath);
+        return -1;
+    }
+    uint64_t expected = 0;
+    struct stat st;
+    if (in != stdin && stat(inPath, &st) == 0) {
+        expected = (uint64_t)st.st_size * 8;
+    }
+    unsigned char *bytes = (unsigned char *)malloc(CHUNK_WORDS * 8);
+    uint64_t *words = (uint64_t *)malloc(sizeof(uint64_t) * CHUNK_WORDS);
+    pdm_writer w;
+    int status = bytes != NULL && words != NULL ? 0 : -1;
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    } else {
+        status = pdm_writer_open(&w, outPath, rate, order, channels, expected);
+    }
+    int writerOpen = status == 0;
+    uint64_t total = 0;
+    while (status == 0) {
+        size_t got = fread(bytes, 1, CHUNK_WORDS * 8, in);
+        if (got == 0) {
+            break;
+        }
+        memset(words, 0, sizeof(uint64_t) * ((got + 7) / 8));
+        for (size_t i = 0; i < got; i++) {
+            words[i / 8] |= (uint64_t)bytes[i] << (8 * (i % 8));
+        }
+        status = pdm_writer_write(&w, words, got * 8);
+        total += got * 8;
+    }
+    if (status == 0 && ferror(in)) {
+        fprintf(stderr, "Error: Could not read '%s'\n", inPath);
+        status = -1;
+    }
+    if (writerOpen && pdm_writer_close(&w) != 0) {
+        status = -1;
+    }
+    if (status == 0) {
+        fprintf(stderr, "PDM: %llu bits -> %s\n", (unsigned long long)total, outPath);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    free(bytes);
+    free(words);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    int rate = 3072000;
+    int channels = 1;
+    int order = PDM_LSB_FIRST;
+    int raw = 0;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        const char *opt = argv[argi];
+        const char *value = NULL;
+        if (strcmp(opt, "--msb-first") == 0) {
+            order = PDM_MSB_FIRST;
+        } else if (strcmp(opt, "--raw") == 0) {
+            raw = 1;
+        } else if (strcmp(opt, "--rate") == 0 || strcmp(opt, "--channels") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            *(strcmp(opt, "--rate") == 0 ? &rate : &channels) = atoi(value);
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - argi != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status;
+    if (raw) {
+        status = raw_to_packed(argv[argi], argv[argi + 1], rate, order, channels);
+    } else if (pdm_file_probe(argv[argi])) {
+        status = packed_to_text(argv[argi], argv[argi + 1]);
+    } else {
+        status = text_to_packed(argv[argi], argv[argi + 1], rate, order, channels);
+    }
+    return status == 0 ? 0 : 1;
+}
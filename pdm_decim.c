@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pdm_decim.h"
+
+#define PDM_BLOCK_WORDS 64          // packed words pushed through the chain at a time
+#define PDM_DESIGN_GRID 4096        // frequency points of the compensation FIR design
+
+void pdm_decim_config_default(pdm_decim_config *cfg) {
+    cfg->pdmRate = 3072000;
+    cfg->decimation = 64;
+    cfg->halfbands = 2;
+    cfg->cicStages = 5;
+    cfg->passband = 0.9;
+    cfg->stopbandDb = 100.0;
+}
+
+const char *pdm_decim_config_check(const pdm_decim_config *cfg) {
+    if (cfg->pdmRate < 1) {
+        return "the PDM rate must be positive";
+    }
+    if (cfg->halfbands < 0 || cfg->halfbands > PDM_MAX_HALFBANDS) {
+        return "the number of halfband stages must be 0..6";
+    }
+    int fixed = 2 << cfg->halfbands;
+    if (cfg->decimation < 2 * fixed || cfg->decimation % fixed != 0) {
+        return "the decimation must be a CIC rate of at least 2 times 2^(halfbands + 1)";
+    }
+    if (cfg->cicStages < 1 || cfg->cicStages > CIC_MAX_STAGES) {
+        return "the number of CIC stages must be 1..8";
+    }
+    if (!(cfg->passband > 0.0 && cfg->passband < 1.0)) {
+        return "the passband must be between 0 and 1 of the output Nyquist";
+    }
+    if (!(cfg->stopbandDb >= 20.0 && cfg->stopbandDb <= 150.0)) {
+        return "the stopband attenuation must be 20..150 dB";
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Filter design: Kaiser-windowed, sized by Kaiser's length estimate
+
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > 1e-12 * sum; k++) {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static double kaiser_beta(double att) {
+    if (att > 50.0) {
+        return 0.1102 * (att - 8.7);
+    }
+    if (att >= 21.0) {
+        return 0.5842 * pow(att - 21.0, 0.4) + 0.07886 * (att - 21.0);
+    }
+    return 0.0;
+}
+
+// Taps needed for att dB over a transition of width cycles per sample
+static int kaiser_length(double att, double width) {
+    return (int)ceil((att - 7.95) / (2.285 * 2.0 * M_PI * width)) + 1;
+}
+
+static double kaiser_window(int j, int numTaps, double beta) {
+    double r = 2.0 * j / (numTaps - 1) - 1.0;
+    return bessel_i0(beta * sqrt(1.0 - r * r)) / bessel_i0(beta);
+}
+
+// CIC magnitude at f (Hz), normalized to 1 at DC
+static double cic_response(const pdm_decim *st, double f) {
+    double x = M_PI * f / st->cfg.pdmRate;
+    if (x == 0.0) {
+        return 1.0;
+    }
+    return pow(fabs(sin(st->cicRate * x) / (st->cicRate * sin(x))), st->cfg.cicStages);
+}
+
+static int alloc_floats(float **p, size_t n) {
+    *p = (float *)calloc(n, sizeof(float));
+    if (*p == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Compensation FIR at rate Hz: 1 / CIC response up to the middle of its
+// transition band, zero above; its stopband starts where its own
+// decimation would alias into the passband
+static int design_comp(pdm_decim *st, pdm_fir *f, double rate, double passEdge, int maxIn) {
+    double stopEdge = rate / 2.0 - passEdge;
+    int n = kaiser_length(st->cfg.stopbandDb, (stopEdge - passEdge) / rate);
+    n |= 1;
+    f->numTaps = n < 9 ? 9 : n;
+    if (alloc_floats(&f->taps, f->numTaps) != 0 || alloc_floats(&f->hist, f->numTaps - 1 + maxIn) != 0) {
+        return -1;
+    }
+
+    double beta = kaiser_beta(st->cfg.stopbandDb);
+    double *h = (double *)malloc(sizeof(double) * f->numTaps);
+    if (h == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    int centre = f->numTaps / 2;
+    double sum = 0.0;
+    for (int j = 0; j < f->numTaps; j++) {
+        // Inverse transform of the zero-phase target, sampled on a dense grid
+        int t = j - centre;
+        double acc = 0.0;
+        for (int k = 0; k < PDM_DESIGN_GRID; k++) {
+            double freq = rate / 2.0 * k / PDM_DESIGN_GRID;
+            double target = freq < rate / 4.0 ? 1.0 / cic_response(st, freq) : 0.0;
+            acc += (k == 0 ? 1.0 : 2.0) * target * cos(M_PI * k * t / PDM_DESIGN_GRID);
+        }
+        h[j] = acc / (2.0 * PDM_DESIGN_GRID) * kaiser_window(j, f->numTaps, beta);
+        sum += h[j];
+    }
+    // Unity gain at DC; the taps are symmetric, so reversed is the same order
+    for (int j = 0; j < f->numTaps; j++) {
+        f->taps[j] = (float)(h[j] / sum);
+    }
+    free(h);
+    return 0;
+}
+
+// Halfband at rate Hz, flat to passEdge and down from rate/2 - passEdge
+static int design_halfband(pdm_decim *st, pdm_halfband *hb, double rate, double passEdge, int maxIn) {
+    int n = kaiser_length(st->cfg.stopbandDb, (rate / 2.0 - 2.0 * passEdge) / rate) + 4;
+    int k = n / 4;  // 4k + 3 >= n
+    hb->numTaps = 4 * k + 3;
+    hb->branchTaps = 2 * k + 2;
+    int branchCapacity = (hb->numTaps + maxIn) / 2 + 1;
+    if (alloc_floats(&hb->taps, hb->branchTaps) != 0 || alloc_floats(&hb->even, branchCapacity) != 0 ||
+        alloc_floats(&hb->odd, branchCapacity) != 0) {
+        return -1;
+    }
+
+    // Ideal lowpass at rate/4: sin(pi t / 2) / (pi t), zero for even t != 0
+    double beta = kaiser_beta(st->cfg.stopbandDb);
+    int centre = hb->numTaps / 2;
+    double sum = 0.0;
+    for (int i = 0; i < hb->branchTaps; i++) {
+        int t = 2 * i - centre;
+        double h = sin(M_PI * t / 2.0) / (M_PI * t) * kaiser_window(2 * i, hb->numTaps, beta);
+        hb->taps[i] = (float)h;
+        sum += h;
+    }
+    // The outer taps carry half the DC gain, the centre the other half
+    for (int i = 0; i < hb->branchTaps; i++) {
+        hb->taps[i] = (float)(hb->taps[i] * 0.5 / sum);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Stages
+
+static void fir_reset(pdm_fir *f) {
+    memset(f->hist, 0, sizeof(float) * (f->numTaps - 1));
+    f->len = f->numTaps - 1;
+}
+
+// Outputs at every second input, each over the numTaps inputs ending there
+static int fir_process(pdm_fir *f, const dsp_kernels *kernels, const float *in, int n, float *out) {
+    memcpy(f->hist + f->len, in, sizeof(float) * n);
+    f->len += n;
+    int produced = 0;
+    int pos = 0;
+    for (; pos + f->numTaps <= f->len; pos += 2) {
+        out[produced++] = kernels->dot(f->taps, f->hist + pos, f->numTaps);
+    }
+    f->len -= pos;
+    memmove(f->hist, f->hist + pos, sizeof(float) * f->len);
+    return produced;
+}
+
+static void halfband_reset(pdm_halfband *hb) {
+    hb->len = hb->numTaps - 1;
+    memset(hb->even, 0, sizeof(float) * ((hb->len + 1) / 2));
+    memset(hb->odd, 0, sizeof(float) * (hb->len / 2));
+}
+
+// The same output phase as fir_process. With the window starting at an even
+// input, its even positions are the even branch and the centre is odd.
+static int halfband_process(pdm_halfband *hb, const dsp_kernels *kernels, const float *in, int n, float *out) {
+    for (int i = 0; i < n; i++, hb->len++) {
+        if (hb->len % 2 == 0) {
+            hb->even[hb->len / 2] = in[i];
+        } else {
+            hb->odd[hb->len / 2] = in[i];
+        }
+    }
+    int centre = hb->numTaps / 4;  // tap 2K+1 of the window, odd input K
+    int produced = 0;
+    for (; 2 * produced + hb->numTaps <= hb->len; produced++) {
+        out[produced] = kernels->dot(hb->taps, hb->even + produced, hb->branchTaps) + 0.5f * hb->odd[produced + centre];
+    }
+    hb->len -= 2 * produced;
+    memmove(hb->even, hb->even + produced, sizeof(float) * ((hb->len + 1) / 2));
+    memmove(hb->odd, hb->odd + produced, sizeof(float) * (hb->len / 2));
+    return produced;
+}
+
+// ---------------------------------------------------------------------------
+// Chain
+
+int pdm_decim_init(pdm_decim *st, const pdm_decim_config *cfg) {
+    memset(st, 0, sizeof(*st));
+    const char *problem = pdm_decim_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid PDM decimation: %s\n", problem);
+        return -1;
+    }
+    st->cfg = *cfg;
+    st->kernels = dsp_kernels_get();
+    st->cicRate = cfg->decimation / (2 << cfg->halfbands);
+
+    // A PDM bit enters the CIC as 0 or +1; two bits of input keep +1 positive
+    cic_config cic;
+    cic.stages = cfg->cicStages;
+    cic.rate = st->cicRate;
+    cic.diffDelay = 1;
+    cic.inputWidth = 2;
+    cic.outputWidth = cic_full_width(&cic);
+    if (cic_pdm_init(&st->cic, &cic) != 0) {
+        return -1;
+    }
+    st->cicScale = (float)(2.0 / pow(st->cicRate, cfg->cicStages));
+
+    int maxIn = PDM_BLOCK_WORDS * 64 / st->cicRate + 1;
+    st->cicOut = (int32_t *)malloc(sizeof(int32_t) * maxIn);
+    if (st->cicOut == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        pdm_decim_free(st);
+        return -1;
+    }
+    double rate = (double)cfg->pdmRate / st->cicRate;
+    double passEdge = cfg->passband * cfg->pdmRate / cfg->decimation / 2.0;
+    int status = alloc_floats(&st->work[0], maxIn);
+    if (status == 0) {
+        status = alloc_floats(&st->work[1], maxIn);
+    }
+    if (status == 0) {
+        status = design_comp(st, &st->comp, rate, passEdge, maxIn);
+    }
+    for (int s = 0; status == 0 && s < cfg->halfbands; s++) {
+        rate /= 2.0;
+        status = design_halfband(st, &st->hb[s], rate, passEdge, maxIn);
+    }
+    if (status != 0) {
+        pdm_decim_free(st);
+        return -1;
+    }
+    pdm_decim_reset(st);
+    return 0;
+}
+
+void pdm_decim_free(pdm_decim *st) {
+    free(st->comp.taps);
+    free(st->comp.hist);
+    for (int s = 0; s < PDM_MAX_HALFBANDS; s++) {
+        free(st->hb[s].taps);
+        free(st->hb[s].even);
+        free(st->hb[s].odd);
+    }
+    free(st->cicOut);
+    free(st->work[0]);
+    free(st->work[1]);
+    memset(st, 0, sizeof(*st));
+}
+
+void pdm_decim_reset(pdm_decim *st) {
+    cic_pdm_reset(&st->cic);
+    fir_reset(&st->comp);
+    for (int s = 0; s < st->cfg.halfbands; s++) {
+        halfband_reset(&st->hb[s]);
+    }
+}
+
+size_t pdm_decim_process(pdm_decim *st, const uint64_t *words, size_t numBits, float *out) {
+    size_t numWords = (numBits + 63) / 64;
+    size_t produced = 0;
+    for (size_t w = 0; w < numWords; w += PDM_BLOCK_WORDS) {
+        size_t count = numWords - w < PDM_BLOCK_WORDS ? numWords - w : PDM_BLOCK_WORDS;
+        size_t bits = w + count == numWords ? numBits - w * 64 : count * 64;
+        int n = (int)cic_pdm_process(&st->cic, words + w, bits, st->cicOut);
+
+        float *x = st->work[0];
+        for (int i = 0; i < n; i++) {
+            x[i] = (float)st->cicOut[i] * st->cicScale - 1.0f;
+        }
+        // Each stage reads one work buffer and writes the other; the last
+        // writes straight to out
+        int last = st->cfg.halfbands;
+        float *y = last == 0 ? out + produced : st->work[1];
+        n = fir_process(&st->comp, st->kernels, x, n, y);
+        for (int s = 0; s < last; s++) {
+            x = y;
+            y = s + 1 == last ? out + produced : st->work[s % 2];
+            n = halfband_process(&st->hb[s], st->kernels, x, n, y);
+        }
+        produced += n;
+    }
+    return produced;
+}
+
+// The even bits of x, packed into the low half
+static uint64_t even_bits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+    x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+    return x;
+}
+
+void pdm_unzip2(const uint64_t *in, size_t count, uint64_t *left, uint64_t *right) {
+    for (size_t i = 0; 2 * i < count; i++) {
+        uint64_t lo = in[2 * i];
+        uint64_t hi = 2 * i + 1 < count ? in[2 * i + 1] : 0;
+        left[i] = even_bits(lo) | even_bits(hi) << 32;
+        right[i] = even_bits(lo >> 1) | even_bits(hi >> 1) << 32;
+    }
+}
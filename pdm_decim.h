@@ -0,0 +1,90 @@
+#ifndef PDM_DECIM_H
+#define PDM_DECIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cic.h"
+#include "dsp_kernels.h"
+
+// PDM to PCM decimation in three kinds of stage:
+//
+//   CIC        1-bit input decimated by R on the packed bit stream (cic_pdm)
+//   FIR        droop compensation: flattens the CIC's sinc^N passband and
+//              decimates by 2
+//   halfband   H decimate-by-2 stages, the last one setting the output
+//              band edge
+//
+// so the total decimation is R * 2^(H+1); 64 from 3.072 MHz to 48 kHz is
+// R = 8 with two halfbands, 48 is R = 6. The FIR stages only compute the
+// outputs they keep, and each halfband runs as two polyphase branches so the
+// zero taps are never multiplied. Filters are designed at init from the
+// rates: flat to passband * the output Nyquist, at least stopbandDb down
+// wherever the next decimation would alias into that band.
+
+#define PDM_MAX_HALFBANDS 6
+
+typedef struct {
+    int pdmRate;        // Hz
+    int decimation;     // pdmRate / output rate
+    int halfbands;      // H
+    int cicStages;      // N
+    double passband;    // flat band edge over the output Nyquist, 0..1
+    double stopbandDb;  // alias rejection of the FIR stages
+} pdm_decim_config;
+
+// 3.072 MHz / 64 = 48 kHz, 5-stage CIC, two halfbands, flat to 0.9 x Nyquist,
+// 100 dB alias rejection
+void pdm_decim_config_default(pdm_decim_config *cfg);
+
+// Decimate-by-2 FIR over a sliding window of its input
+typedef struct {
+    int numTaps;
+    float *taps;        // time-reversed, so an output is one dot product
+    float *hist;        // numTaps - 1 past inputs, then the current block
+    int len;
+} pdm_fir;
+
+// Halfband of 4K+3 taps: the centre tap is 1/2, the other odd-offset taps
+// are zero. Inputs are split by parity: the even branch holds the 2K+2
+// nonzero outer taps, the odd branch only the centre.
+typedef struct {
+    int numTaps;
+    int branchTaps;     // 2K + 2
+    float *taps;        // the even branch, time-reversed
+    float *even;        // past and current inputs of each branch
+    float *odd;
+    int len;            // inputs held across both branches
+} pdm_halfband;
+
+typedef struct {
+    pdm_decim_config cfg;
+    const dsp_kernels *kernels;
+    int cicRate;
+    float cicScale;     // CIC output (unipolar) -> +-1 bipolar
+    cic_pdm cic;
+    pdm_fir comp;
+    pdm_halfband hb[PDM_MAX_HALFBANDS];
+    int32_t *cicOut;    // one block of CIC output
+    float *work[2];     // ping-pong stage buffers
+} pdm_decim;
+
+// Returns NULL if the configuration is usable, otherwise why not
+const char *pdm_decim_config_check(const pdm_decim_config *cfg);
+
+// Returns 0, or -1 with a message
+int pdm_decim_init(pdm_decim *st, const pdm_decim_config *cfg);
+void pdm_decim_free(pdm_decim *st);
+void pdm_decim_reset(pdm_decim *st);
+
+// Decimate numBits PDM bits, packed LSB first as cic_pdm takes them, into
+// PCM samples in -1..1. Calls may be chained as long as every call but the
+// last passes a multiple of 64 bits. Returns the samples written, at most
+// numBits / decimation + 1.
+size_t pdm_decim_process(pdm_decim *st, const uint64_t *words, size_t numBits, float *out);
+
+// Split the bits of a two-channel stream, interleaved per clock edge (left
+// on even bits), into one packed stream per channel. count words in; each
+// output gets (count + 1) / 2 words, a missing last input word read as zero.
+void pdm_unzip2(const uint64_t *in, size_t count, uint64_t *left, uint64_t *right);
+
+#endif
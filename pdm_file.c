@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pdm_file.h"
+
+#define PDM_FILE_VERSION 1
+#define PDM_MIN_WRITE_BITS (1u << 23)   // preallocation when the length is unknown: 1 MiB
+
+static uint16_t get_le16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_le64(const unsigned char *p) {
+    return (uint64_t)get_le32(p) | (uint64_t)get_le32(p + 4) << 32;
+}
+
+static void put_le16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void put_le64(unsigned char *p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+// LSB-first data on a little-endian host is already in word layout
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const unsigned char *)&probe == 1;
+}
+
+static unsigned char reverse_bits(unsigned char b) {
+    b = (unsigned char)((b & 0xf0) >> 4 | (b & 0x0f) << 4);
+    b = (unsigned char)((b & 0xcc) >> 2 | (b & 0x33) << 2);
+    return (unsigned char)((b & 0xaa) >> 1 | (b & 0x55) << 1);
+}
+
+int pdm_file_probe(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    unsigned char magic[4];
+    int found = fread(magic, 1, 4, f) == 4 && memcmp(magic, "PDM1", 4) == 0;
+    fclose(f);
+    return found;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+static const char *check_header(const pdm_reader *r) {
+    const unsigned char *p = r->map;
+    if (r->mapSize < PDM_FILE_HEADER_BYTES || memcmp(p, "PDM1", 4) != 0) {
+        return "not a packed PDM file";
+    }
+    if (get_le16(p + 6) != PDM_FILE_VERSION) {
+        return "unsupported version";
+    }
+    size_t headerSize = get_le16(p + 4);
+    if (headerSize < PDM_FILE_HEADER_BYTES || headerSize > r->mapSize) {
+        return "bad header size";
+    }
+    if (get_le32(p + 8) == 0 || get_le32(p + 8) > 0x7fffffffu || p[12] > PDM_MSB_FIRST || p[13] == 0) {
+        return "bad bit rate, bit order or channel count";
+    }
+    uint64_t bits = get_le64(p + 16);
+    if (bits / 8 > r->mapSize - headerSize || (bits + 7) / 8 > r->mapSize - headerSize) {
+        return "file shorter than its length";
+    }
+    return NULL;
+}
+
+int pdm_reader_open(pdm_reader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        fprintf(stderr, "Error: '%s' is not a packed PDM file\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map '%s'\n", path);
+        return -1;
+    }
+    r->map = (unsigned char *)map;
+    r->mapSize = (size_t)st.st_size;
+
+    const char *problem = check_header(r);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: '%s': %s\n", path, problem);
+        pdm_reader_close(r);
+        return -1;
+    }
+    r->info.bitRate = (int)get_le32(r->map + 8);
+    r->info.bitOrder = r->map[12];
+    r->info.channels = r->map[13];
+    r->info.numBits = get_le64(r->map + 16);
+    r->data = r->map + get_le16(r->map + 4);
+    madvise(r->map, r->mapSize, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void pdm_reader_close(pdm_reader *r) {
+    if (r->map != NULL) {
+        munmap(r->map, r->mapSize);
+    }
+    memset(r, 0, sizeof(*r));
+}
+
+size_t pdm_reader_read(pdm_reader *r, uint64_t *words, size_t maxBits) {
+    uint64_t left = r->info.numBits - r->pos;
+    size_t bits = left < maxBits ? (size_t)left : maxBits;
+    size_t bytes = (bits + 7) / 8;
+    const unsigned char *src = r->data + r->pos / 8;
+
+    memset(words, 0, sizeof(uint64_t) * ((bits + 63) / 64));
+    if (r->info.bitOrder == PDM_LSB_FIRST && host_is_little_endian()) {
+        memcpy(words, src, bytes);
+    } else {
+        for (size_t i = 0; i < bytes; i++) {
+            unsigned char b = r->info.bitOrder == PDM_MSB_FIRST ? reverse_bits(src[i]) : src[i];
+            words[i / 8] |= (uint64_t)b << (8 * (i % 8));
+        }
+    }
+    // The unused bits of the last byte are zero on disk, but do not trust it
+    if (bits % 64 != 0) {
+        words[bits / 64] &= (1ULL << (bits % 64)) - 1;
+    }
+    r->pos += bits;
+    return bits;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+static void write_header(unsigned char *h, const pdm_info *info) {
+    memset(h, 0, PDM_FILE_HEADER_BYTES);
+    memcpy(h, "PDM1", 4);
+    put_le16(h + 4, PDM_FILE_HEADER_BYTES);
+    put_le16(h + 6, PDM_FILE_VERSION);
+    put_le32(h + 8, (uint32_t)info->bitRate);
+    h[12] = (unsigned char)info->bitOrder;
+    h[13] = (unsigned char)info->channels;
+    put_le64(h + 16, info->numBits);
+}
+
+// Extend the output file and its mapping to hold at least bits bits
+static int pdm_writer_reserve(pdm_writer *w, uint64_t bits) {
+    if (bits <= w->capacity) {
+        return 0;
+    }
+    uint64_t capacity = w->capacity > 0 ? w->capacity : PDM_MIN_WRITE_BITS;
+    while (capacity < bits) {
+        capacity *= 2;
+    }
+    size_t size = PDM_FILE_HEADER_BYTES + (size_t)(capacity / 8);
+
+    if (w->map != NULL) {
+        munmap(w->map, w->mapSize);
+        w->map = NULL;
+    }
+    if (ftruncate(w->fd, (off_t)size) != 0) {
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    w->map = (unsigned char *)map;
+    w->mapSize = size;
+    w->capacity = capacity;
+    return 0;
+}
+
+int pdm_writer_open(pdm_writer *w, const char *path, int bitRate, int bitOrder, int channels, uint64_t expectedBits) {
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    if (bitRate < 1 || (bitOrder != PDM_LSB_FIRST && bitOrder != PDM_MSB_FIRST) || channels < 1 || channels > 255) {
+        fprintf(stderr, "Error: Invalid PDM format: %d Hz, bit order %d, %d channels\n", bitRate, bitOrder, channels);
+        return -1;
+    }
+    w->info.bitRate = bitRate;
+    w->info.bitOrder = bitOrder;
+    w->info.channels = channels;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || ftruncate(fd, 0) != 0) {
+        fprintf(stderr, "Error: Could not open output file '%s' (packed PDM needs a regular file)\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    w->fd = fd;
+    if (pdm_writer_reserve(w, expectedBits > 0 ? expectedBits : 1) != 0) {
+        fprintf(stderr, "Error: Could not extend the output file\n");
+        pdm_writer_close(w);
+        return -1;
+    }
+    return 0;
+}
+
+int pdm_writer_write(pdm_writer *w, const uint64_t *words, size_t numBits) {
+    if (w->info.numBits % 8 != 0) {
+        fprintf(stderr, "Error: Packed PDM data can only be appended after whole bytes\n");
+        return -1;
+    }
+    if (pdm_writer_reserve(w, w->info.numBits + numBits) != 0) {
+        fprintf(stderr, "Error: Could not extend the output file\n");
+        return -1;
+    }
+    unsigned char *dst = w->map + PDM_FILE_HEADER_BYTES + w->info.numBits / 8;
+    size_t bytes = (numBits + 7) / 8;
+    for (size_t i = 0; i < bytes; i++) {
+        unsigned char b = (unsigned char)(words[i / 8] >> (8 * (i % 8)));
+        if (i == bytes - 1 && numBits % 8 != 0) {
+            b &= (unsigned char)((1u << (numBits % 8)) - 1);
+        }
+        dst[i] = w->info.bitOrder == PDM_MSB_FIRST ? reverse_bits(b) : b;
+    }
+    w->info.numBits += numBits;
+    return 0;
+}
+
+int pdm_writer_close(pdm_writer *w) {
+    int status = 0;
+    if (w->fd >= 0) {
+        // Fill in the length and drop the unused preallocation
+        if (w->map != NULL) {
+            write_header(w->map, &w->info);
+            munmap(w->map, w->mapSize);
+        } else {
+            status = -1;  // a failed extension already lost the mapping
+        }
+        if (ftruncate(w->fd, (off_t)(PDM_FILE_HEADER_BYTES + (w->info.numBits + 7) / 8)) != 0) {
+            fprintf(stderr, "Error: Could not finalize the output file\n");
+            status = -1;
+        }
+        if (close(w->fd) != 0) {
+            status = -1;
+        }
+    }
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// $readmemb text
+
+// Whitespace separates entries, '_' inside one is ignored and // and /* */
+// comments are skipped
+long pdm_read_readmemb(const char *path, uint64_t **wordsOut) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", path);
+        return -1;
+    }
+    size_t capacity = 1024;
+    uint64_t *words = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    long bits = 0;
+    long line = 1;
+    int c;
+    int status = words == NULL ? -1 : 0;
+    while (status == 0 && (c = fgetc(f)) != EOF) {
+        if (c == '\n') {
+            line++;
+            continue;
+        }
+        if (isspace(c)) {
+            continue;
+        }
+        if (c == '/') {
+            int next = fgetc(f);
+            if (next == '/') {
+                while ((c = fgetc(f)) != EOF && c != '\n') {
+                }
+                line++;
+                continue;
+            }
+            if (next == '*') {
+                int prev = 0;
+                while ((c = fgetc(f)) != EOF && !(prev == '*' && c == '/')) {
+                    line += c == '\n';
+                    prev = c;
+                }
+                continue;
+            }
+            fprintf(stderr, "Error: %s:%ld: '/' is not a binary digit\n", path, line);
+            status = -1;
+            break;
+        }
+
+        // One entry: its last digit is the bit, as $readmemb truncates to the memory width
+        int bit = -1;
+        while (c != EOF && !isspace(c)) {
+            if (c == '0' || c == '1') {
+                bit = c - '0';
+            } else if (c != '_') {
+                fprintf(stderr, "Error: %s:%ld: '%c' is not a binary digit\n", path, line, c);
+                status = -1;
+                break;
+            }
+            c = fgetc(f);
+        }
+        if (status != 0) {
+            break;
+        }
+        if (c == '\n') {
+            ungetc(c, f);
+        }
+        if (bit < 0) {
+            continue;
+        }
+        if ((size_t)bits / 64 >= capacity) {
+            uint64_t *grown = (uint64_t *)realloc(words, sizeof(uint64_t) * capacity * 2);
+            if (grown == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+                status = -1;
+                break;
+            }
+            memset(grown + capacity, 0, sizeof(uint64_t) * capacity);
+            words = grown;
+            capacity *= 2;
+        }
+        words[bits / 64] |= (uint64_t)bit << (bits % 64);
+        bits++;
+    }
+    fclose(f);
+    if (status != 0) {
+        if (words == NULL) {
+            fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        }
+        free(words);
+        return -1;
+    }
+    *wordsOut = words;
+    return bits;
+}
+
+int pdm_append_readmemb(FILE *f, const uint64_t *words, uint64_t numBits) {
+    char line[2 * 64];
+    for (uint64_t k = 0; k < (numBits + 63) / 64; k++) {
+        int count = k + 1 < (numBits + 63) / 64 || numBits % 64 == 0 ? 64 : (int)(numBits % 64);
+        for (int i = 0; i < count; i++) {
+            line[2 * i] = (char)('0' + ((words[k] >> i) & 1));
+            line[2 * i + 1] = '\n';
+        }
+        fwrite(line, 1, (size_t)count * 2, f);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+int pdm_write_readmemb(const char *path, const uint64_t *words, uint64_t numBits) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", path);
+        return -1;
+    }
+    int status = pdm_append_readmemb(f, words, numBits);
+    if (fclose(f) != 0 || status != 0) {
+        fprintf(stderr, "Error: Could not write '%s'\n", path);
+        return -1;
+    }
+    return 0;
+}
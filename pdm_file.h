@@ -0,0 +1,92 @@
+#ifndef PDM_FILE_H
+#define PDM_FILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+// Packed PDM captures (.pdm): one bit per clock edge after a 32-byte header.
+//
+//   offset  bytes
+//        0      4   magic "PDM1"
+//        4      2   header size (32)
+//        6      2   version (1)
+//        8      4   bit rate, Hz: the PDM clock, shared by all channels
+//       12      1   bit order: 0 = first bit of each byte in its LSB, 1 = MSB
+//       13      1   channels, interleaved per clock edge (channel c on bits
+//                   c, c + channels, ...)
+//       14      2   reserved, 0
+//       16      8   length in bits, all channels together
+//       24      8   reserved, 0
+//       32          ceil(length / 8) bytes of bits, in clock order
+//
+// Multi-byte fields are little endian; bits past the length in the last
+// byte are zero. The reader and writer map the file. Bits are handed over
+// packed 64 per word, bit i of a block in bit i % 64 of word i / 64: the
+// layout cic_pdm and pdm_decim take, whatever the bit order on disk.
+
+#define PDM_FILE_HEADER_BYTES 32
+
+typedef enum {
+    PDM_LSB_FIRST = 0,
+    PDM_MSB_FIRST = 1
+} pdm_bit_order;
+
+typedef struct {
+    int bitRate;
+    int bitOrder;       // pdm_bit_order
+    int channels;
+    uint64_t numBits;
+} pdm_info;
+
+typedef struct {
+    pdm_info info;
+    unsigned char *map;         // whole file
+    size_t mapSize;
+    const unsigned char *data;  // first byte of bits
+    uint64_t pos;               // next bit to read
+} pdm_reader;
+
+// 1 if path is a regular file starting with the .pdm magic, else 0
+int pdm_file_probe(const char *path);
+
+// Returns 0, or -1 with a message on stderr
+int pdm_reader_open(pdm_reader *r, const char *path);
+void pdm_reader_close(pdm_reader *r);
+
+// Read up to maxBits bits, a multiple of 64, from the current position.
+// Returns the bits read, 0 at the end.
+size_t pdm_reader_read(pdm_reader *r, uint64_t *words, size_t maxBits);
+
+typedef struct {
+    pdm_info info;
+    int fd;
+    unsigned char *map;
+    size_t mapSize;
+    uint64_t capacity;          // bits the current mapping holds
+} pdm_writer;
+
+// expectedBits sizes the initial preallocation; 0 if unknown
+int pdm_writer_open(pdm_writer *w, const char *path, int bitRate, int bitOrder, int channels, uint64_t expectedBits);
+
+// Append numBits bits of words. Calls may be chained as long as every call
+// but the last passes a multiple of 8 bits. Returns 0 or -1.
+int pdm_writer_write(pdm_writer *w, const uint64_t *words, size_t numBits);
+
+// Writes the final length; returns -1 if any bit could not be written
+int pdm_writer_close(pdm_writer *w);
+
+// $readmemb text as read_pdm_from_file.sv loads it, one 1-bit entry per
+// word. Returns the number of bits (stored in a malloc'd *words, packed as
+// above), or -1 with a message.
+long pdm_read_readmemb(const char *path, uint64_t **words);
+
+// The same bits back as text, one "0" or "1" per line like the stimulus
+// files. Returns 0 or -1.
+int pdm_write_readmemb(const char *path, const uint64_t *words, uint64_t numBits);
+
+// The same appended to an open stream, for text written a block at a time.
+// Returns -1 if the stream has an error.
+int pdm_append_readmemb(FILE *f, const uint64_t *words, uint64_t numBits);
+
+#endif
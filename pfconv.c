@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pfconv.h"
+#include "stats.h"
+#include "arena.h"
+
+void pfconv_free(pfconv_state *st) {
+    stats_memory(-(long long)st->bufferBytes);
+    arena_free(st->filter);
+    arena_free(st->fdl);
+    arena_free(st->accum);
+    arena_free(st->timeBuf);
+    arena_free(st->inputBuf);
+    fft_real_free(st->fft);
+    memset(st, 0, sizeof(*st));
+}
+
+int pfconv_init(pfconv_state *st, const float *ir, int taps, int blockSize) {
+    memset(st, 0, sizeof(*st));
+    if (blockSize < 2 || blockSize % 2 != 0 || taps < 1) {
+        fprintf(stderr, "Error: Convolution block size must be even and the filter non-empty\n");
+        return -1;
+    }
+
+    int n = 2 * blockSize;
+    st->blockSize = blockSize;
+    st->numPartitions = (taps + blockSize - 1) / blockSize;
+    st->numBins = blockSize + 1;
+
+    st->fft = fft_real_alloc(n);
+    if (st->fft == NULL) {
+        fprintf(stderr, "Error: Failed to allocate FFT configuration.\n");
+        pfconv_free(st);
+        return -1;
+    }
+
+    size_t spectra = (size_t)st->numPartitions * st->numBins;
+    st->filter = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * spectra);
+    st->fdl = (fft_cpx *)arena_calloc(spectra, sizeof(fft_cpx));
+    st->accum = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * st->numBins);
+    st->timeBuf = (float *)arena_alloc(sizeof(float) * n);
+    st->inputBuf = (float *)arena_calloc(n, sizeof(float));
+    if (st->filter == NULL || st->fdl == NULL || st->accum == NULL || st->timeBuf == NULL || st->inputBuf == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for convolution buffers.\n");
+        pfconv_free(st);
+        return -1;
+    }
+    st->bufferBytes = sizeof(fft_cpx) * (2 * spectra + st->numBins) + sizeof(float) * 2 * (size_t)n;
+    stats_memory((long long)st->bufferBytes);
+
+    // Partition spectra: each blockSize slice of the IR zero-padded to 2*blockSize
+    for (int p = 0; p < st->numPartitions; p++) {
+        for (int i = 0; i < n; i++) {
+            int tap = p * blockSize + i;
+            st->timeBuf[i] = (i < blockSize && tap < taps) ? ir[tap] / n : 0.0f;
+        }
+        fft_real_forward(st->fft, st->timeBuf, st->filter + (size_t)p * st->numBins);
+    }
+    st->kern = dsp_kernels_get();
+    return 0;
+}
+
+void pfconv_reset(pfconv_state *st) {
+    memset(st->fdl, 0, sizeof(fft_cpx) * (size_t)st->numPartitions * st->numBins);
+    memset(st->inputBuf, 0, sizeof(float) * 2 * st->blockSize);
+    st->fdlHead = 0;
+    st->fill = 0;
+}
+
+// Convolve the block in the second half of inputBuf and emit `emit` samples
+static int pfconv_block(pfconv_state *st, int emit, pfconv_sink sink, void *ctx) {
+    int b = st->blockSize;
+    int bins = st->numBins;
+
+    // The newest input spectrum goes into the FDL slot of the oldest one
+    uint64_t t = stats_begin();
+    st->fdlHead = (st->fdlHead + st->numPartitions - 1) % st->numPartitions;
+    fft_real_forward(st->fft, st->inputBuf, st->fdl + (size_t)st->fdlHead * bins);
+    t = stats_lap(STATS_FFT, t);
+
+    // Y = sum over partitions of X[k - p] * H[p]
+    memset(st->accum, 0, sizeof(fft_cpx) * bins);
+    for (int p = 0; p < st->numPartitions; p++) {
+        const fft_cpx *x = st->fdl + (size_t)((st->fdlHead + p) % st->numPartitions) * bins;
+        const fft_cpx *h = st->filter + (size_t)p * bins;
+        st->kern->cmul_add(st->accum, x, h, bins);
+    }
+    t = stats_lap(STATS_FILTER, t);
+
+    fft_real_inverse(st->fft, st->accum, st->timeBuf);
+    stats_lap(STATS_IFFT, t);
+    stats_count(STATS_BLOCKS, 1);
+
+    // Overlap-save: the first half is circular wrap-around, the second is valid
+    if (emit > 0 && sink(ctx, st->timeBuf + b, emit) != 0) {
+        return -1;
+    }
+
+    // The current block becomes the previous one
+    memcpy(st->inputBuf, st->inputBuf + b, sizeof(float) * b);
+    st->fill = 0;
+    return 0;
+}
+
+int pfconv_push(pfconv_state *st, const float *samples, int count, pfconv_sink sink, void *ctx) {
+    int b = st->blockSize;
+
+    while (count > 0) {
+        int take = b - st->fill;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(st->inputBuf + b + st->fill, samples, sizeof(float) * take);
+        st->fill += take;
+        samples += take;
+        count -= take;
+
+        if (st->fill == b && pfconv_block(st, b, sink, ctx) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int pfconv_flush(pfconv_state *st, pfconv_sink sink, void *ctx) {
+    int emit = st->fill;
+    if (emit == 0) {
+        return 0;
+    }
+    memset(st->inputBuf + st->blockSize + emit, 0, sizeof(float) * (st->blockSize - emit));
+    return pfconv_block(st, emit, sink, ctx);
+}
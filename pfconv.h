@@ -0,0 +1,48 @@
+#ifndef PFCONV_H
+#define PFCONV_H
+
+#include <stddef.h>
+#include "fft.h"
+#include "dsp_kernels.h"
+
+// Called with each block of finished output samples
+typedef int (*pfconv_sink)(void *ctx, const float *samples, int count);
+
+// Uniformly partitioned overlap-save convolution. The impulse response is
+// cut into blockSize-long partitions whose 2*blockSize-point spectra are
+// precomputed; each input block is transformed once and pushed into a
+// frequency-domain delay line (FDL), and the output block is the sum over
+// partitions of FDL[p] * H[p]. Latency is one block, cost stays FFT-based.
+typedef struct {
+    int blockSize;
+    int numPartitions;
+    int numBins;           // blockSize + 1 bins of a 2*blockSize real FFT
+
+    fft_real *fft;
+    fft_cpx *filter;       // numPartitions * numBins partition spectra, 1/(2*blockSize) folded in
+    fft_cpx *fdl;          // numPartitions * numBins input spectra, ring indexed by fdlHead
+    int fdlHead;           // slot of the newest input spectrum
+    fft_cpx *accum;        // numBins
+    float *timeBuf;        // 2*blockSize FFT scratch
+    float *inputBuf;       // previous block followed by the current one
+    int fill;              // samples of the current block received so far
+    const dsp_kernels *kern;
+    size_t bufferBytes;    // heap buffers above, for the stats report
+} pfconv_state;
+
+// ir holds taps samples of the FIR filter; blockSize must be even
+int pfconv_init(pfconv_state *st, const float *ir, int taps, int blockSize);
+void pfconv_free(pfconv_state *st);
+
+// Clear the delay line and input so a new stream can start; the partition
+// spectra and plans are kept
+void pfconv_reset(pfconv_state *st);
+
+// Feed input samples; each completed block is convolved and handed to the sink
+int pfconv_push(pfconv_state *st, const float *samples, int count, pfconv_sink sink, void *ctx);
+
+// End of input: zero-pad the partial block and emit its samples. The output
+// has exactly as many samples as the input; the filter tail is cut off.
+int pfconv_flush(pfconv_state *st, pfconv_sink sink, void *ctx);
+
+#endif
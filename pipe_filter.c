@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "wav_processor.h"
+#include "spsc_ring.h"
+#include "eq_live.h"
+#include "stats.h"
+#include "dsp_kernels.h"
+
+#define PIPE_PERIOD_FRAMES 256   // frames moved per read()/write() call
+#define PIPE_WAIT_NS 100000      // back-off while a ring is full or empty
+
+// Shared between the reader, DSP and writer threads. Everything is
+// allocated before the threads start; the threads only touch atomics and
+// the two rings, so the audio path never locks or allocates.
+typedef struct {
+    int inFd, outFd;
+    int sampleRate;
+    int sinkDelay;      // frames a real-time sink buffers before it plays
+    int channels;
+    pcm_format format;
+    int sampleBytes;
+
+    spsc_ring inRing;   // reader -> DSP
+    spsc_ring outRing;  // DSP -> writer
+
+    channel_job *jobs;
+    const dsp_kernels *kern;
+    float **inPlanes;           // jobs[c].in
+    const float **outPlanes;    // jobs[c].out
+    eq_live *live;      // live EQ changes, NULL without a control FIFO
+    float *dspIn;       // interleaved frames popped from inRing
+    float *dspOut;      // interleaved frames waiting for outRing
+
+    atomic_int inputDone;   // reader hit EOF
+    atomic_int outputDone;  // DSP flushed the filter tail
+    atomic_int failed;      // any thread gave up; the others stop
+    int readStatus, dspStatus, writeStatus;
+
+    atomic_long readerStalls;  // reader waited on a full input ring: backpressure, nothing lost
+    atomic_long underruns;     // output fell behind the sample clock (see writer_thread)
+    size_t inPeak, outPeak;    // highest ring fill seen, in samples
+} pipe_state;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Play time of frames at the stream's rate
+static uint64_t frames_ns(const pipe_state *ps, uint64_t frames) {
+    return frames * 1000000000u / (uint64_t)ps->sampleRate;
+}
+
+static void pipe_wait(void) {
+    struct timespec ts = {0, PIPE_WAIT_NS};
+    nanosleep(&ts, NULL);
+}
+
+static float pcm_to_float(const unsigned char *p, pcm_format format) {
+    if (format == PCM_S16) {
+        int16_t s;
+        memcpy(&s, p, sizeof(s));
+        return s / 32768.0f;
+    }
+    float f;
+    memcpy(&f, p, sizeof(f));
+    return f;
+}
+
+// Returns 1 if the sample had to be clipped
+static int float_to_pcm(float x, unsigned char *p, pcm_format format) {
+    if (format == PCM_S16) {
+        // Same scale libsndfile uses when writing floats to PCM16
+        double d = x * 32767.0;
+        int16_t s = (int16_t)lrint(d > 32767.0 ? 32767.0 : d < -32768.0 ? -32768.0 : d);
+        memcpy(p, &s, sizeof(s));
+        return d >= 32767.5 || d < -32768.5;
+    }
+    memcpy(p, &x, sizeof(x));
+    return 0;
+}
+
+// Push all of src into ring, backing off while it is full. Returns -1 if
+// another thread failed meanwhile. Each wait counts once in *stalls.
+static int ring_push_all(pipe_state *ps, spsc_ring *ring, const float *src, size_t n, atomic_long *stalls, size_t *peak) {
+    int stalled = 0;
+    while (n > 0) {
+        size_t done = spsc_ring_write(ring, src, n);
+        src += done;
+        n -= done;
+        size_t fill = ring->capacity - spsc_ring_writable(ring);
+        if (fill > *peak) {
+            *peak = fill;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (atomic_load(&ps->failed)) {
+            return -1;
+        }
+        if (!stalled && stalls != NULL) {
+            atomic_fetch_add(stalls, 1);
+        }
+        stalled = 1;
+        pipe_wait();
+    }
+    return 0;
+}
+
+static void *reader_thread(void *arg) {
+    pipe_state *ps = (pipe_state *)arg;
+    unsigned char raw[PIPE_PERIOD_FRAMES * sizeof(float) * 8];
+    float samples[sizeof(raw) / sizeof(int16_t)];
+    size_t carry = 0;  // bytes of a partial sample left from the last read
+
+    for (;;) {
+        ssize_t got = read(ps->inFd, raw + carry, sizeof(raw) - carry);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            fprintf(stderr, "Error: Could not read from input: %s\n", strerror(errno));
+            ps->readStatus = -1;
+            atomic_store(&ps->failed, 1);
+            break;
+        }
+        if (got == 0) {
+            if (carry != 0) {
+                fprintf(stderr, "Warning: Input ended in the middle of a sample; dropped %zu bytes\n", carry);
+            }
+            break;
+        }
+
+        uint64_t t = stats_begin();
+        size_t avail = carry + (size_t)got;
+        size_t count = avail / ps->sampleBytes;
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = pcm_to_float(raw + i * ps->sampleBytes, ps->format);
+        }
+        stats_lap(STATS_READ, t);
+        stats_count(STATS_BYTES_READ, (uint64_t)got);
+        carry = avail - count * ps->sampleBytes;
+        memmove(raw, raw + count * ps->sampleBytes, carry);
+
+        if (ring_push_all(ps, &ps->inRing, samples, count, &ps->readerStalls, &ps->inPeak) != 0) {
+            break;
+        }
+    }
+    atomic_store(&ps->inputDone, 1);
+    return NULL;
+}
+
+// Run one push or flush over every channel inline and hand the result to the writer
+static int dsp_step(pipe_state *ps, int frames, int flush) {
+    int channels = ps->channels;
+    if (ps->live != NULL) {
+        eq_live_update(ps->live);  // between steps, so every channel switches at the same block
+    }
+    if (!flush) {
+        ps->kern->deinterleave(ps->dspIn, channels, ps->inPlanes, frames);
+    }
+    for (int c = 0; c < channels; c++) {
+        ps->jobs[c].inCount = flush ? 0 : frames;
+        ps->jobs[c].flush = flush;
+        run_channel_job(&ps->jobs[c]);
+        if (ps->jobs[c].status != 0 || ps->jobs[c].outCount != ps->jobs[0].outCount) {
+            fprintf(stderr, "Error: Channel %d failed to filter its block\n", c);
+            return -1;
+        }
+    }
+    int outFrames = ps->jobs[0].outCount;
+    ps->kern->interleave(ps->outPlanes, channels, ps->dspOut, outFrames);
+    return ring_push_all(ps, &ps->outRing, ps->dspOut, (size_t)outFrames * channels, NULL, &ps->outPeak);
+}
+
+static void *dsp_thread(void *arg) {
+    pipe_state *ps = (pipe_state *)arg;
+    int channels = ps->channels;
+
+    while (!atomic_load(&ps->failed)) {
+        // Check for EOF before looking at the ring so the last samples the
+        // reader pushed are never missed
+        int done = atomic_load(&ps->inputDone);
+        size_t frames = spsc_ring_readable(&ps->inRing) / channels;
+        if (frames == 0) {
+            if (done) {
+                ps->dspStatus = dsp_step(ps, 0, 1);
+                break;
+            }
+            pipe_wait();
+            continue;
+        }
+        if (frames > STREAM_CHUNK_FRAMES) {
+            frames = STREAM_CHUNK_FRAMES;
+        }
+        spsc_ring_read(&ps->inRing, ps->dspIn, frames * channels);
+        if ((ps->dspStatus = dsp_step(ps, (int)frames, 0)) != 0) {
+            break;
+        }
+    }
+    if (ps->dspStatus != 0) {
+        atomic_store(&ps->failed, 1);
+    }
+    atomic_store(&ps->outputDone, 1);
+    return NULL;
+}
+
+static void *writer_thread(void *arg) {
+    pipe_state *ps = (pipe_state *)arg;
+    float samples[PIPE_PERIOD_FRAMES * 8];
+    unsigned char raw[sizeof(samples)];
+    size_t periodSamples = (size_t)PIPE_PERIOD_FRAMES * ps->channels;
+    if (periodSamples > sizeof(samples) / sizeof(samples[0])) {
+        periodSamples = sizeof(samples) / sizeof(samples[0]);
+    }
+    int started = 0;
+    int underrun = 0;         // the sink ran dry during this wait
+    uint64_t clockStart = 0;  // sink time zero: the first write, less the frames before it
+    uint64_t framesOut = 0;
+
+    while (!atomic_load(&ps->failed)) {
+        int done = atomic_load(&ps->outputDone);
+        size_t count = spsc_ring_read(&ps->outRing, samples, periodSamples);
+        if (count == 0) {
+            if (done) {
+                break;
+            }
+            // An empty ring is an underrun only if a sink playing at the
+            // sample rate, started sinkDelay frames after the first write,
+            // has by now played everything written. Input that arrives
+            // faster than real time never gets there, whatever the waits.
+            // The sink then buffers afresh from the next write, as a device
+            // does after an xrun.
+            uint64_t dryAt = clockStart + frames_ns(ps, framesOut + (uint64_t)ps->sinkDelay);
+            if (started && !underrun && now_ns() > dryAt) {
+                atomic_fetch_add(&ps->underruns, 1);
+                underrun = 1;
+            }
+            pipe_wait();
+            continue;
+        }
+        if (!started || underrun) {
+            clockStart = now_ns() - frames_ns(ps, framesOut);
+            started = 1;
+            underrun = 0;
+        }
+        framesOut += count / ps->channels;
+
+        uint64_t t = stats_begin();
+        uint64_t clipped = 0;
+        for (size_t i = 0; i < count; i++) {
+            clipped += float_to_pcm(samples[i], raw + i * ps->sampleBytes, ps->format);
+        }
+        stats_lap(STATS_WRITE, t);
+        stats_count(STATS_CLIPPED, clipped);
+        size_t bytes = count * ps->sampleBytes;
+        size_t off = 0;
+        while (off < bytes) {
+            ssize_t put = write(ps->outFd, raw + off, bytes - off);
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            if (put < 0) {
+                fprintf(stderr, "Error: Could not write to output: %s\n", strerror(errno));
+                ps->writeStatus = -1;
+                atomic_store(&ps->failed, 1);
+                return NULL;
+            }
+            off += (size_t)put;
+        }
+        stats_count(STATS_BYTES_WRITTEN, (uint64_t)bytes);
+    }
+    return NULL;
+}
+
+int pipe_filter(int inFd, int outFd, int sampleRate, int channels, pcm_format format, const filter_options *opts,
+                const char *controlPath) {
+    pipe_state *ps = (pipe_state *)calloc(1, sizeof(pipe_state));
+    if (ps == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    ps->inFd = inFd;
+    ps->outFd = outFd;
+    ps->sampleRate = sampleRate;
+    ps->channels = channels;
+    ps->format = format;
+    ps->sampleBytes = format == PCM_S16 ? (int)sizeof(int16_t) : (int)sizeof(float);
+    atomic_init(&ps->inputDone, 0);
+    atomic_init(&ps->outputDone, 0);
+    atomic_init(&ps->failed, 0);
+    atomic_init(&ps->readerStalls, 0);
+    atomic_init(&ps->underruns, 0);
+
+    // The filter holds back at most one frame (or block, or nothing for the
+    // IIR cascade); each ring holds that plus a couple of I/O periods, which
+    // bounds the total latency
+    int maxBlock = opts->iir ? 0 : opts->lowLatency ? opts->blockSize : opts->stft.frameSize;
+    size_t ringFrames = (size_t)maxBlock + 2 * PIPE_PERIOD_FRAMES;
+    // Output comes a hop at a time, in step with input that comes a period
+    // at a time: a sink holding a block and a period rides out the jitter
+    ps->sinkDelay = maxBlock + PIPE_PERIOD_FRAMES;
+    int status = 0;
+    int initialized = 0;
+    ps->jobs = (channel_job *)calloc(channels, sizeof(channel_job));
+    ps->kern = dsp_kernels_get();
+    ps->inPlanes = (float **)calloc(channels, sizeof(float *));
+    ps->outPlanes = (const float **)calloc(channels, sizeof(float *));
+    ps->dspIn = (float *)malloc(sizeof(float) * STREAM_CHUNK_FRAMES * channels);
+    ps->dspOut = (float *)malloc(sizeof(float) * (STREAM_CHUNK_FRAMES + maxBlock) * channels);
+    if (ps->jobs == NULL || ps->inPlanes == NULL || ps->outPlanes == NULL || ps->dspIn == NULL || ps->dspOut == NULL
+        || spsc_ring_init(&ps->inRing, ringFrames * channels) != 0
+        || spsc_ring_init(&ps->outRing, ringFrames * channels) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        status = -1;
+    }
+    for (; status == 0 && initialized < channels; initialized++) {
+        if (channel_job_init(&ps->jobs[initialized], opts, sampleRate) != 0) {
+            status = -1;
+            break;
+        }
+        ps->inPlanes[initialized] = ps->jobs[initialized].in;
+        ps->outPlanes[initialized] = ps->jobs[initialized].out;
+    }
+    eq_control *control = NULL;
+    if (status == 0 && controlPath != NULL) {
+        ps->live = eq_live_create(&opts->stft, sampleRate, channels);
+        for (int c = 0; ps->live != NULL && c < channels; c++) {
+            if (eq_live_attach(ps->live, &ps->jobs[c].st) != 0) {
+                eq_live_destroy(ps->live);
+                ps->live = NULL;
+            }
+        }
+        if (ps->live == NULL) {
+            fprintf(stderr, "Error: Could not set up live EQ control\n");
+            status = -1;
+        } else if ((control = eq_control_start(controlPath, ps->live, &opts->eq)) == NULL) {
+            status = -1;
+        }
+    }
+
+    if (status == 0) {
+        long long ringBytes = (long long)(sizeof(float) * (ps->inRing.capacity + ps->outRing.capacity
+                                                           + (2 * STREAM_CHUNK_FRAMES + (size_t)maxBlock) * channels));
+        stats_memory(ringBytes);
+        size_t bufferedFrames = (ps->inRing.capacity + ps->outRing.capacity) / channels;
+        size_t boundFrames = (size_t)maxBlock + bufferedFrames;
+        fprintf(stderr, "Pipe: %d Hz, %d channel(s), %s; latency %d frames (%.1f ms) in the filter, "
+                        "at most %zu frames (%.1f ms) with ring buffering\n",
+                sampleRate, channels, format == PCM_S16 ? "s16" : "f32",
+                maxBlock, 1000.0 * maxBlock / sampleRate,
+                boundFrames, 1000.0 * boundFrames / sampleRate);
+
+        pthread_t reader, dsp, writer;
+        int started = 0;
+        if (pthread_create(&reader, NULL, reader_thread, ps) == 0) {
+            started++;
+            if (pthread_create(&dsp, NULL, dsp_thread, ps) == 0) {
+                started++;
+                if (pthread_create(&writer, NULL, writer_thread, ps) == 0) {
+                    started++;
+                }
+            }
+        }
+        if (started < 3) {
+            fprintf(stderr, "Error: Could not start pipe threads\n");
+            atomic_store(&ps->failed, 1);
+            status = -1;
+        }
+        // A failure elsewhere would leave the reader blocked in read() on a
+        // quiet input; it returns with the next chunk or at EOF
+        if (started > 2) {
+            pthread_join(writer, NULL);
+        }
+        if (started > 1) {
+            pthread_join(dsp, NULL);
+        }
+        if (started > 0) {
+            pthread_join(reader, NULL);
+        }
+
+        if (ps->readStatus != 0 || ps->dspStatus != 0 || ps->writeStatus != 0) {
+            status = -1;
+        }
+        fprintf(stderr, "Pipe: %ld backpressure wait(s), %ld underrun(s); peak buffering %zu in / %zu out frames\n",
+                atomic_load(&ps->readerStalls), atomic_load(&ps->underruns),
+                ps->inPeak / channels, ps->outPeak / channels);
+        if (ps->live != NULL) {
+            fprintf(stderr, "Pipe: %ld of %ld live EQ change(s) applied before the input ended\n",
+                    eq_live_applied(ps->live), eq_live_published(ps->live));
+        }
+        stats_memory(-ringBytes);
+    }
+
+    eq_control_stop(control);
+    eq_live_destroy(ps->live);
+
+    for (int c = 0; c < initialized; c++) {
+        channel_job_free(&ps->jobs[c]);
+    }
+    spsc_ring_free(&ps->inRing);
+    spsc_ring_free(&ps->outRing);
+    free(ps->jobs);
+    free(ps->inPlanes);
+    free(ps->outPlanes);
+    free(ps->dspIn);
+    free(ps->dspOut);
+    free(ps);
+    return status;
+}
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "wav_processor.h"
+#include "stats.h"
+
+#define SEGMENT_FRAMES 65536  // nominal output frames per segment, rounded to a hop multiple
+
+// Segments complete out of order; the writer waits on this for the next one
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t segmentDone;
+} segment_sync;
+
+typedef struct {
+    const char *inputFile;
+    const SF_INFO *sfinfo;
+    const filter_options *opts;
+    sf_count_t start;  // first output frame
+    sf_count_t end;    // one past the last output frame
+    float *out;        // (end - start) frames per channel, one plane after another
+    int status;
+    int done;
+    segment_sync *sync;
+} segment_job;
+
+// Read exactly `frames` frames starting at `pos` into planes, zero-filling
+// before the start of the file; returns the frames actually available from the file
+static sf_count_t read_at(wav_reader *in, sf_count_t pos, float *const *planes, sf_count_t frames) {
+    int channels = in->info.channels;
+    sf_count_t lead = pos < 0 ? -pos : 0;
+    if (lead > frames) {
+        lead = frames;
+    }
+    for (int c = 0; c < channels; c++) {
+        memset(planes[c], 0, sizeof(float) * lead);
+    }
+    if (lead == frames) {
+        return 0;
+    }
+    if (wav_reader_seek(in, pos + lead) != 0) {
+        return -1;
+    }
+
+    float **shifted = (float **)malloc(sizeof(float *) * channels);
+    if (shifted == NULL) {
+        return -1;
+    }
+    for (int c = 0; c < channels; c++) {
+        shifted[c] = planes[c] + lead;
+    }
+    sf_count_t got = wav_reader_read(in, shifted, frames - lead);
+    free(shifted);
+    return got;
+}
+
+// Filter output frames [start, end). start is a multiple of the hop, so the
+// channel filters' blocks line up with the single-stream filter's. They are
+// primed with the frameSize - hopSize frames before start and fed up to a
+// frame past end, so every output frame sees exactly the blocks the
+// single-stream filter gives it, accumulated in the same order.
+static int filter_segment(segment_job *seg) {
+    const SF_INFO *sfinfo = seg->sfinfo;
+    const filter_options *opts = seg->opts;
+    int channels = sfinfo->channels;
+    int historyFrames = opts->stft.frameSize - opts->stft.hopSize;
+    int lookahead = opts->stft.frameSize;
+    sf_count_t wanted = seg->end - seg->start;
+    sf_count_t produced = 0;
+    int status = 0;
+
+    wav_reader in;
+    if (wav_reader_open(&in, seg->inputFile) != 0) {
+        return -1;
+    }
+
+    channel_job *jobs = (channel_job *)calloc(channels, sizeof(channel_job));
+    float **planes = (float **)malloc(sizeof(float *) * channels);
+    float *history = (float *)malloc(sizeof(float) * (historyFrames > 0 ? historyFrames : 1) * channels);
+    int initialized = 0;
+    if (jobs == NULL || planes == NULL || history == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        status = -1;
+    }
+    for (; status == 0 && initialized < channels; initialized++) {
+        if (channel_job_init(&jobs[initialized], opts, sfinfo->samplerate) != 0) {
+            status = -1;
+        }
+    }
+
+    // Prime every channel with the samples just before the segment
+    if (status == 0 && seg->start > 0 && historyFrames > 0) {
+        sf_count_t lead = seg->start < historyFrames ? historyFrames - seg->start : 0;
+        for (int c = 0; c < channels; c++) {
+            planes[c] = history + (size_t)c * historyFrames;
+        }
+        if (read_at(&in, seg->start - historyFrames, planes, historyFrames) != historyFrames - lead) {
+            fprintf(stderr, "Error: Could not read segment history\n");
+            status = -1;
+        }
+        for (int c = 0; status == 0 && c < channels; c++) {
+            channel_job_prime(&jobs[c], planes[c]);
+        }
+    }
+    if (status == 0 && wav_reader_seek(&in, seg->start) != 0) {
+        fprintf(stderr, "Error: Could not seek to frame %lld\n", (long long)seg->start);
+        status = -1;
+    }
+    for (int c = 0; status == 0 && c < channels; c++) {
+        planes[c] = jobs[c].in;
+    }
+
+    // Feed through end + lookahead, or to the end of the file and flush
+    sf_count_t remaining = wanted + lookahead;
+    int atEof = 0;
+    while (status == 0 && produced < wanted) {
+        sf_count_t want = remaining < STREAM_CHUNK_FRAMES ? remaining : STREAM_CHUNK_FRAMES;
+        sf_count_t got = 0;
+        if (want > 0 && !atEof) {
+            got = wav_reader_read(&in, planes, want);
+        }
+        if (got <= 0) {
+            atEof = 1;
+        }
+        remaining -= got > 0 ? got : 0;
+
+        for (int c = 0; c < channels; c++) {
+            jobs[c].flush = got <= 0;
+            jobs[c].inCount = got > 0 ? (int)got : 0;
+            run_channel_job(&jobs[c]);
+            if (jobs[c].status != 0) {
+                status = -1;
+            }
+        }
+        if (status != 0) {
+            break;
+        }
+
+        sf_count_t frames = jobs[0].outCount;
+        if (frames > wanted - produced) {
+            frames = wanted - produced;
+        }
+        for (int c = 0; c < channels; c++) {
+            memcpy(seg->out + (size_t)c * wanted + produced, jobs[c].out, sizeof(float) * frames);
+        }
+        produced += frames;
+
+        if (got <= 0 && produced < wanted) {
+            fprintf(stderr, "Error: Segment at frame %lld ended early\n", (long long)seg->start);
+            status = -1;
+        }
+    }
+
+    for (int c = 0; c < initialized; c++) {
+        channel_job_free(&jobs[c]);
+    }
+    free(jobs);
+    free(planes);
+    free(history);
+    wav_reader_close(&in);
+    return status;
+}
+
+static void run_segment_job(void *arg) {
+    segment_job *seg = (segment_job *)arg;
+    seg->status = filter_segment(seg);
+
+    pthread_mutex_lock(&seg->sync->lock);
+    seg->done = 1;
+    pthread_cond_broadcast(&seg->sync->segmentDone);
+    pthread_mutex_unlock(&seg->sync->lock);
+}
+
+int segment_filter(const char *inputFile, const SF_INFO *sfinfo, wav_writer *out, const filter_options *opts, thread_pool *pool) {
+    int hop = opts->stft.hopSize;
+    int channels = sfinfo->channels;
+    sf_count_t total = sfinfo->frames;
+
+    // Segment boundaries must sit on block boundaries of the single-stream
+    // filter, i.e. on multiples of the hop
+    sf_count_t length = (SEGMENT_FRAMES / hop > 0 ? SEGMENT_FRAMES / hop : 1) * (sf_count_t)hop;
+    sf_count_t numSegments = total > 0 ? (total + length - 1) / length : 1;
+
+    // Bound memory: only a few segments per worker may be in flight
+    int window = 2 * thread_pool_size(pool);
+    segment_job **segs = (segment_job **)calloc(numSegments, sizeof(segment_job *));
+    if (segs == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+
+    const float **planes = (const float **)malloc(sizeof(float *) * channels);
+    if (planes == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(segs);
+        return -1;
+    }
+
+    segment_sync sync;
+    pthread_mutex_init(&sync.lock, NULL);
+    pthread_cond_init(&sync.segmentDone, NULL);
+
+    int status = 0;
+    sf_count_t submitted = 0;
+    sf_count_t written = 0;
+    while (written < numSegments) {
+        while (status == 0 && submitted < numSegments && submitted - written < window) {
+            segment_job *seg = (segment_job *)calloc(1, sizeof(segment_job));
+            sf_count_t start = submitted * length;
+            sf_count_t end = submitted == numSegments - 1 ? total : start + length;
+            float *out = seg != NULL ? (float *)malloc(sizeof(float) * ((end - start) * channels + 1)) : NULL;
+            if (seg == NULL || out == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+                free(seg);
+                status = -1;
+                break;
+            }
+            stats_memory((long long)(sizeof(float) * ((end - start) * channels + 1)));
+            seg->inputFile = inputFile;
+            seg->sfinfo = sfinfo;
+            seg->opts = opts;
+            seg->start = start;
+            seg->end = end;
+            seg->out = out;
+            seg->sync = &sync;
+            segs[submitted] = seg;
+            if (thread_pool_submit(pool, run_segment_job, seg) != 0) {
+                run_segment_job(seg);
+            }
+            submitted++;
+        }
+        if (written == submitted) {
+            break;  // nothing in flight after an error
+        }
+
+        // Write segments strictly in order as they complete
+        segment_job *seg = segs[written];
+        pthread_mutex_lock(&sync.lock);
+        while (!seg->done) {
+            pthread_cond_wait(&sync.segmentDone, &sync.lock);
+        }
+        pthread_mutex_unlock(&sync.lock);
+
+        sf_count_t frames = seg->end - seg->start;
+        if (status == 0 && seg->status != 0) {
+            status = -1;
+        }
+        for (int c = 0; c < channels; c++) {
+            planes[c] = seg->out + (size_t)c * frames;
+        }
+        if (status == 0 && frames > 0 && wav_writer_write(out, planes, frames) != 0) {
+            status = -1;
+        }
+        stats_memory(-(long long)(sizeof(float) * (frames * channels + 1)));
+        free(seg->out);
+        free(seg);
+        segs[written++] = NULL;
+    }
+
+    // After an error, let in-flight segments finish before their jobs go away
+    thread_pool_wait(pool);
+    for (sf_count_t i = written; i < submitted; i++) {
+        if (segs[i] != NULL) {
+            stats_memory(-(long long)(sizeof(float) * ((segs[i]->end - segs[i]->start) * channels + 1)));
+            free(segs[i]->out);
+            free(segs[i]);
+        }
+    }
+    free(segs);
+    free(planes);
+    pthread_cond_destroy(&sync.segmentDone);
+    pthread_mutex_destroy(&sync.lock);
+    return status;
+}
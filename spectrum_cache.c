@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "spectrum_cache.h"
+#include "fft.h"
+
+#define SPECTRUM_CACHE_VERSION 1
+#define SPECTRUM_CACHE_BOM 0x01020304u
+
+static uint32_t get_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_le64(const unsigned char *p) {
+    return (uint64_t)get_le32(p) | (uint64_t)get_le32(p + 4) << 32;
+}
+
+static void put_le16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void put_le64(unsigned char *p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+// FNV-1a taking a whole word per multiply, so hashing runs near memory speed
+int spectrum_cache_hash_file(const char *path, uint64_t *hash, uint64_t *bytes) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: Could not read input file '%s'\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *p = NULL;
+    if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Error: Could not map '%s'\n", path);
+            close(fd);
+            return -1;
+        }
+        p = (const unsigned char *)map;
+        madvise(map, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        h = (h ^ get_le64(p + i)) * 0x100000001b3ull;
+    }
+    for (; i < size; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    if (p != NULL) {
+        munmap((void *)p, size);
+    }
+    *hash = h;
+    *bytes = size;
+    return 0;
+}
+
+static void key_layout(spectrum_cache *c, const spectrum_cache_key *key) {
+    c->key = *key;
+    c->numBins = key->stft.frameSize / 2 + 1;
+    c->blockBytes = (size_t)c->numBins * 2 * (key->precision / 8);
+    c->mapSize = SPECTRUM_CACHE_HEADER_BYTES + c->blockBytes * key->numBlocks * key->channels;
+    c->kern = dsp_kernels_get();
+}
+
+static void write_header(unsigned char *p, const spectrum_cache_key *key) {
+    memset(p, 0, SPECTRUM_CACHE_HEADER_BYTES);
+    memcpy(p, "SPC1", 4);
+    put_le16(p + 4, SPECTRUM_CACHE_HEADER_BYTES);
+    put_le16(p + 6, SPECTRUM_CACHE_VERSION);
+    put_le64(p + 8, key->inputHash);
+    put_le64(p + 16, key->inputBytes);
+    put_le32(p + 24, (uint32_t)key->sampleRate);
+    put_le16(p + 28, (uint16_t)key->channels);
+    put_le16(p + 30, (uint16_t)key->precision);
+    put_le32(p + 32, (uint32_t)key->stft.frameSize);
+    put_le32(p + 36, (uint32_t)key->stft.hopSize);
+    put_le16(p + 40, (uint16_t)key->stft.analysisWindow);
+    uint32_t bom = SPECTRUM_CACHE_BOM;
+    memcpy(p + 44, &bom, sizeof(bom));
+    put_le64(p + 48, (uint64_t)key->numBlocks);
+    size_t nameLen = strlen(FFT_BACKEND_NAME);
+    memcpy(p + 56, FFT_BACKEND_NAME, nameLen < 8 ? nameLen : 8);
+}
+
+int spectrum_cache_open(spectrum_cache *c, const char *path, const spectrum_cache_key *key, const char **why) {
+    memset(c, 0, sizeof(*c));
+    key_layout(c, key);
+    size_t expectedSize = c->mapSize;
+    c->mapSize = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *why = "no cache yet";
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size != expectedSize) {
+        close(fd);
+        *why = "input or configuration changed";
+        return -1;
+    }
+    void *map = mmap(NULL, expectedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        *why = "could not map it";
+        return -1;
+    }
+    c->map = (unsigned char *)map;
+    c->mapSize = expectedSize;
+
+    // The whole header must be what this run would write
+    unsigned char header[SPECTRUM_CACHE_HEADER_BYTES];
+    write_header(header, key);
+    if (memcmp(c->map, header, sizeof(header)) != 0) {
+        spectrum_cache_close(c);
+        *why = "input or configuration changed";
+        return -1;
+    }
+    madvise(c->map, c->mapSize, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int spectrum_cache_create(spectrum_cache *c, const char *path, const spectrum_cache_key *key) {
+    memset(c, 0, sizeof(*c));
+    key_layout(c, key);
+    size_t size = c->mapSize;
+    c->mapSize = 0;
+    c->writing = 1;
+
+    c->path = strdup(path);
+    c->tmpPath = (char *)malloc(strlen(path) + 5);
+    if (c->path == NULL || c->tmpPath == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        spectrum_cache_close(c);
+        return -1;
+    }
+    sprintf(c->tmpPath, "%s.tmp", path);
+
+    int fd = open(c->tmpPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Warning: Could not create spectrum cache '%s'\n", c->tmpPath);
+        spectrum_cache_close(c);
+        return -1;
+    }
+    // Real blocks, not a sparse file: out of space has to show up here, not
+    // as SIGBUS on a store to the mapping halfway through the render
+    int err = posix_fallocate(fd, 0, (off_t)size);
+    if (err != 0) {
+        fprintf(stderr, "Warning: Could not reserve %.1f MB for spectrum cache '%s': %s\n", size / 1e6, c->tmpPath,
+                strerror(err));
+        close(fd);
+        spectrum_cache_close(c);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Warning: Could not map spectrum cache '%s'\n", c->tmpPath);
+        spectrum_cache_close(c);
+        return -1;
+    }
+    c->map = (unsigned char *)map;
+    c->mapSize = size;
+    return 0;
+}
+
+static unsigned char *block_at(const spectrum_cache *c, int channel, long long block) {
+    return c->map + SPECTRUM_CACHE_HEADER_BYTES + c->blockBytes * ((size_t)channel * c->key.numBlocks + block);
+}
+
+void spectrum_cache_store(spectrum_cache *c, int channel, long long block, const fft_cpx *spectrum) {
+    unsigned char *p = block_at(c, channel, block);
+    if (c->key.precision == SPECTRUM_F16) {
+        c->kern->to_half((uint16_t *)p, (const float *)spectrum, 2 * c->numBins);
+    } else {
+        memcpy(p, spectrum, c->blockBytes);
+    }
+}
+
+void spectrum_cache_load(const spectrum_cache *c, int channel, long long block, fft_cpx *spectrum) {
+    const unsigned char *p = block_at(c, channel, block);
+    if (c->key.precision == SPECTRUM_F16) {
+        c->kern->from_half((float *)spectrum, (const uint16_t *)p, 2 * c->numBins);
+    } else {
+        memcpy(spectrum, p, c->blockBytes);
+    }
+}
+
+int spectrum_cache_commit(spectrum_cache *c) {
+    write_header(c->map, &c->key);
+    // Every block on disk before the name appears, so a crash cannot leave
+    // a valid header in front of spectra that were never written
+    int status = msync(c->map, c->mapSize, MS_SYNC) == 0 ? 0 : -1;
+    if (munmap(c->map, c->mapSize) != 0) {
+        status = -1;
+    }
+    c->map = NULL;
+    if (status == 0 && rename(c->tmpPath, c->path) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not save spectrum cache '%s'\n", c->path);
+    }
+    spectrum_cache_close(c);
+    return status;
+}
+
+void spectrum_cache_close(spectrum_cache *c) {
+    if (c->map != NULL) {
+        munmap(c->map, c->mapSize);
+    }
+    if (c->writing && c->tmpPath != NULL) {
+        unlink(c->tmpPath);  // a no-op once committed
+    }
+    free(c->path);
+    free(c->tmpPath);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,89 @@
+#ifndef SPECTRUM_CACHE_H
+#define SPECTRUM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stft.h"
+#include "dsp_kernels.h"
+
+// On-disk cache of the forward spectra of the STFT filter, so a rerun with
+// a different EQ only applies the new gains, the inverse FFT and the
+// overlap-add: the input is neither decoded nor transformed again.
+//
+//   offset  bytes
+//        0      4   magic "SPC1"
+//        4      2   header size (64)
+//        6      2   version (1)
+//        8      8   hash of the input file (FNV-1a over 8-byte words)
+//       16      8   input file size in bytes
+//       24      4   sample rate
+//       28      2   channels
+//       30      2   bits per stored value: 16 (IEEE half) or 32 (float)
+//       32      4   frame size
+//       36      4   hop size
+//       40      2   analysis window (window_type)
+//       42      2   reserved, 0
+//       44      4   0x01020304 in the writer's byte order
+//       48      8   blocks per channel
+//       56      8   FFT backend name, NUL padded
+//       64          for each channel, for each block, frameSize/2 + 1 bins
+//                   of (real, imaginary) values
+//
+// Header fields are little endian, spectra in the writer's byte order (the
+// byte order mark makes another host miss). Everything that shapes the
+// spectra is in the key; the synthesis window and the EQ are not, since
+// they only act after the forward FFT. A cache is written under a
+// temporary name and renamed into place once complete, so an interrupted
+// run never leaves a partial cache behind.
+
+#define SPECTRUM_CACHE_HEADER_BYTES 64
+
+typedef enum {
+    SPECTRUM_F16 = 16,  // half the size; replayed output about -80 dB from the exact one
+    SPECTRUM_F32 = 32   // replays bit-exactly
+} spectrum_precision;
+
+typedef struct {
+    uint64_t inputHash;
+    uint64_t inputBytes;
+    int sampleRate;
+    int channels;
+    int precision;      // spectrum_precision
+    stft_config stft;
+    long long numBlocks;
+} spectrum_cache_key;
+
+typedef struct {
+    spectrum_cache_key key;
+    int numBins;
+    size_t blockBytes;
+    unsigned char *map;  // whole file
+    size_t mapSize;
+    int writing;
+    char *path;          // final and temporary names, writing only
+    char *tmpPath;
+    const dsp_kernels *kern;
+} spectrum_cache;
+
+// Hash and size of a file's contents, for the key. Returns 0 or -1.
+int spectrum_cache_hash_file(const char *path, uint64_t *hash, uint64_t *bytes);
+
+// Map the cache at path if it holds exactly key's spectra. Returns 0, or -1
+// with *why set to the reason it cannot be used (nothing printed).
+int spectrum_cache_open(spectrum_cache *c, const char *path, const spectrum_cache_key *key, const char **why);
+
+// Start a new cache for key, its space reserved up front. Returns 0, or -1
+// with a warning (no room for it, say); the render can go on without one.
+int spectrum_cache_create(spectrum_cache *c, const char *path, const spectrum_cache_key *key);
+
+// Channels may be stored and loaded concurrently from different threads
+void spectrum_cache_store(spectrum_cache *c, int channel, long long block, const fft_cpx *spectrum);
+void spectrum_cache_load(const spectrum_cache *c, int channel, long long block, fft_cpx *spectrum);
+
+// Finish a created cache and move it into place. Returns 0, or -1 with a message.
+int spectrum_cache_commit(spectrum_cache *c);
+
+// Unmap; a created cache that was not committed is deleted
+void spectrum_cache_close(spectrum_cache *c);
+
+#endif
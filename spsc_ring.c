@@ -0,0 +1,26 @@
+#include <stdlib.h>
+#include "spsc_ring.h"
+
+int spsc_ring_init(spsc_ring *r, size_t minCapacity) {
+    size_t capacity = 1;
+    while (capacity < minCapacity) {
+        capacity <<= 1;
+    }
+
+    r->buf = (float *)calloc(capacity, sizeof(float));
+    if (r->buf == NULL) {
+        return -1;
+    }
+    r->capacity = capacity;
+    r->mask = capacity - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+void spsc_ring_free(spsc_ring *r) {
+    free(r->buf);
+    r->buf = NULL;
+    r->capacity = 0;
+    r->mask = 0;
+}
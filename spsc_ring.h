@@ -0,0 +1,67 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define SPSC_CACHE_LINE 64
+
+// Single-producer/single-consumer lock-free ring of floats. One thread
+// writes, one thread reads; neither ever locks or allocates. Capacity is
+// rounded up to a power of two and indices run freely, wrapping via mask.
+typedef struct {
+    float *buf;
+    size_t capacity;
+    size_t mask;
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;  // next write position, owned by the producer
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;  // next read position, owned by the consumer
+} spsc_ring;
+
+int spsc_ring_init(spsc_ring *r, size_t minCapacity);
+void spsc_ring_free(spsc_ring *r);
+
+// Samples the consumer can read right now
+static inline size_t spsc_ring_readable(spsc_ring *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    return head - tail;
+}
+
+// Free space the producer can fill right now
+static inline size_t spsc_ring_writable(spsc_ring *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return r->capacity - (head - tail);
+}
+
+// Producer side: copy up to n samples in, returns how many fit
+static inline size_t spsc_ring_write(spsc_ring *r, const float *src, size_t n) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t space = r->capacity - (head - tail);
+    if (n > space) {
+        n = space;
+    }
+    for (size_t i = 0; i < n; i++) {
+        r->buf[(head + i) & r->mask] = src[i];
+    }
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+    return n;
+}
+
+// Consumer side: copy up to n samples out, returns how many were available
+static inline size_t spsc_ring_read(spsc_ring *r, float *dst, size_t n) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t avail = head - tail;
+    if (n > avail) {
+        n = avail;
+    }
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = r->buf[(tail + i) & r->mask];
+    }
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "stats.h"
+
+int stats_enabled = 0;
+
+typedef struct stats_slot {
+    uint64_t ns[STATS_NUM_STAGES];
+    uint64_t calls[STATS_NUM_STAGES];
+    uint64_t counters[STATS_NUM_COUNTERS];
+    struct stats_slot *next;
+} stats_slot;
+
+static const char *stage_names[STATS_NUM_STAGES] = {
+    "read", "window", "fft", "filter", "ifft", "overlap_add", "write"
+};
+
+static const char *counter_names[STATS_NUM_COUNTERS] = {
+    "blocks", "bytes_read", "bytes_written", "clipped_samples"
+};
+
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static stats_slot *slots = NULL;  // every thread's slot, kept until exit
+static _Thread_local stats_slot *local_slot = NULL;
+
+static atomic_llong memory_now;
+static atomic_llong memory_peak;
+static uint64_t start_ns;
+
+void stats_enable(void) {
+    atomic_init(&memory_now, 0);
+    atomic_init(&memory_peak, 0);
+    start_ns = stats_now_ns();
+    stats_enabled = 1;
+}
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// The calling thread's slot, registered on first use
+static stats_slot *get_slot(void) {
+    if (local_slot == NULL) {
+        stats_slot *slot = (stats_slot *)calloc(1, sizeof(stats_slot));
+        if (slot == NULL) {
+            return NULL;
+        }
+        pthread_mutex_lock(&slots_lock);
+        slot->next = slots;
+        slots = slot;
+        pthread_mutex_unlock(&slots_lock);
+        local_slot = slot;
+    }
+    return local_slot;
+}
+
+uint64_t stats_record(stats_stage stage, uint64_t start) {
+    uint64_t now = stats_now_ns();
+    stats_slot *slot = get_slot();
+    if (slot != NULL) {
+        slot->ns[stage] += now - start;
+        slot->calls[stage]++;
+    }
+    return now;
+}
+
+void stats_add(stats_counter counter, uint64_t n) {
+    stats_slot *slot = get_slot();
+    if (slot != NULL) {
+        slot->counters[counter] += n;
+    }
+}
+
+void stats_track_memory(long long bytes) {
+    long long now = atomic_fetch_add(&memory_now, bytes) + bytes;
+    long long peak = atomic_load(&memory_peak);
+    while (now > peak && !atomic_compare_exchange_weak(&memory_peak, &peak, now)) {
+    }
+}
+
+void stats_report(FILE *out) {
+    if (!stats_enabled) {
+        return;
+    }
+    uint64_t ns[STATS_NUM_STAGES] = {0};
+    uint64_t calls[STATS_NUM_STAGES] = {0};
+    uint64_t counters[STATS_NUM_COUNTERS] = {0};
+    int threads = 0;
+    pthread_mutex_lock(&slots_lock);
+    for (const stats_slot *slot = slots; slot != NULL; slot = slot->next) {
+        for (int s = 0; s < STATS_NUM_STAGES; s++) {
+            ns[s] += slot->ns[s];
+            calls[s] += slot->calls[s];
+        }
+        for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+            counters[c] += slot->counters[c];
+        }
+        threads++;
+    }
+    pthread_mutex_unlock(&slots_lock);
+
+    // Stage times are summed over threads, so with several workers they
+    // can add up to more than the wall time
+    uint64_t staged = 0;
+    for (int s = 0; s < STATS_NUM_STAGES; s++) {
+        staged += ns[s];
+    }
+    fprintf(out, "{\n  \"wall_ns\": %llu,\n  \"threads\": %d,\n  \"stages\": {\n",
+            (unsigned long long)(stats_now_ns() - start_ns), threads);
+    for (int s = 0; s < STATS_NUM_STAGES; s++) {
+        fprintf(out, "    \"%s\": {\"calls\": %llu, \"ns\": %llu, \"ns_per_call\": %.1f, \"share\": %.4f}%s\n",
+                stage_names[s], (unsigned long long)calls[s], (unsigned long long)ns[s],
+                calls[s] > 0 ? (double)ns[s] / calls[s] : 0.0,
+                staged > 0 ? (double)ns[s] / staged : 0.0,
+                s + 1 < STATS_NUM_STAGES ? "," : "");
+    }
+    fprintf(out, "  },\n");
+    for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+        fprintf(out, "  \"%s\": %llu,\n", counter_names[c], (unsigned long long)counters[c]);
+    }
+    fprintf(out, "  \"peak_buffer_bytes\": %lld\n}\n", atomic_load(&memory_peak));
+}
@@ -0,0 +1,71 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Per-stage timers and counters of the hot path. They are always compiled
+// in; until stats_enable() is called every probe is a single branch on a
+// flag that never changes during a run. Each thread accumulates into its own
+// slot, so enabled probes take no lock and share no cache lines.
+
+typedef enum {
+    STATS_READ,         // decode: file or pipe bytes -> planar float
+    STATS_WINDOW,       // analysis window and zero padding
+    STATS_FFT,          // forward FFT
+    STATS_FILTER,       // spectral gain, or the partitions' multiply-accumulate
+    STATS_IFFT,         // inverse FFT
+    STATS_OVERLAP_ADD,  // synthesis window, overlap-add and normalization
+    STATS_WRITE,        // encode: planar float -> file or pipe bytes
+    STATS_NUM_STAGES
+} stats_stage;
+
+typedef enum {
+    STATS_BLOCKS,         // FFT blocks filtered
+    STATS_BYTES_READ,
+    STATS_BYTES_WRITTEN,
+    STATS_CLIPPED,        // output samples clipped to the PCM16 range
+    STATS_NUM_COUNTERS
+} stats_counter;
+
+extern int stats_enabled;
+
+// Turn collection on; call before any worker thread starts
+void stats_enable(void);
+
+uint64_t stats_now_ns(void);
+
+// Add the time since start to stage; returns the current time so
+// consecutive stages can be timed with one clock read each
+uint64_t stats_record(stats_stage stage, uint64_t start);
+
+void stats_add(stats_counter counter, uint64_t n);
+
+// Heap buffers allocated (positive) or freed (negative); the peak is reported
+void stats_track_memory(long long bytes);
+
+// Print everything collected as one JSON object; call after the workers
+// have finished
+void stats_report(FILE *out);
+
+static inline uint64_t stats_begin(void) {
+    return stats_enabled ? stats_now_ns() : 0;
+}
+
+static inline uint64_t stats_lap(stats_stage stage, uint64_t start) {
+    return stats_enabled ? stats_record(stage, start) : 0;
+}
+
+static inline void stats_count(stats_counter counter, uint64_t n) {
+    if (stats_enabled) {
+        stats_add(counter, n);
+    }
+}
+
+static inline void stats_memory(long long bytes) {
+    if (stats_enabled) {
+        stats_track_memory(bytes);
+    }
+}
+
+#endif
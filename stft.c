@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stft.h"
+#include "stats.h"
+#include "arena.h"
+
+static const struct {
+    const char *name;
+    window_type type;
+} window_names[] = {
+    {"rect", WINDOW_RECT},
+    {"hann", WINDOW_HANN},
+    {"hamming", WINDOW_HAMMING},
+    {"blackman-harris", WINDOW_BLACKMAN_HARRIS},
+    {"sqrt-hann", WINDOW_SQRT_HANN},
+};
+
+void stft_config_default(stft_config *cfg) {
+    cfg->frameSize = 1024;
+    cfg->hopSize = 512;  // 50% overlap
+    cfg->analysisWindow = WINDOW_HAMMING;
+    cfg->synthesisWindow = WINDOW_RECT;
+}
+
+const char *stft_config_check(const stft_config *cfg) {
+    if (cfg->frameSize < 2 || cfg->frameSize % 2 != 0) {
+        return "frame size must be an even number of at least 2";
+    }
+    if (cfg->hopSize < 1 || cfg->hopSize > cfg->frameSize) {
+        return "hop size must be between 1 and the frame size";
+    }
+    return NULL;
+}
+
+int stft_parse_window(const char *name, window_type *type) {
+    for (size_t i = 0; i < sizeof(window_names) / sizeof(window_names[0]); i++) {
+        if (strcmp(name, window_names[i].name) == 0) {
+            *type = window_names[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *stft_window_name(window_type type) {
+    for (size_t i = 0; i < sizeof(window_names) / sizeof(window_names[0]); i++) {
+        if (window_names[i].type == type) {
+            return window_names[i].name;
+        }
+    }
+    return "unknown";
+}
+
+void stft_fill_window(float *w, int n, window_type type) {
+    for (int i = 0; i < n; i++) {
+        double x = 2.0 * M_PI * i / n;
+        double v;
+        switch (type) {
+        case WINDOW_HANN:
+            v = 0.5 - 0.5 * cos(x);
+            break;
+        case WINDOW_HAMMING:
+            v = 0.54 - 0.46 * cos(x);
+            break;
+        case WINDOW_BLACKMAN_HARRIS:
+            v = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+            break;
+        case WINDOW_SQRT_HANN:
+            v = sqrt(0.5 - 0.5 * cos(x));
+            break;
+        default:
+            v = 1.0;
+            break;
+        }
+        w[i] = (float)v;
+    }
+}
+
+// Overlap-add normalization: the output sample at phase p of a hop is the
+// sum of analysis*synthesis over every frame covering it, so dividing by that
+// sum gives unity gain for any window pair and hop, not just COLA ones.
+static int build_ola_norm(stft_state *st) {
+    int n = st->cfg.frameSize;
+    int hop = st->cfg.hopSize;
+    double maxSum = 0.0;
+    double minSum = INFINITY;
+
+    for (int p = 0; p < hop; p++) {
+        double sum = 0.0;
+        for (int i = p; i < n; i += hop) {
+            sum += (double)st->analysis[i] * st->synthesis[i];
+        }
+        st->olaNorm[p] = (float)sum;
+        if (sum > maxSum) maxSum = sum;
+        if (sum < minSum) minSum = sum;
+    }
+
+    if (!(minSum > 1e-6 * maxSum)) {
+        return -1;
+    }
+    for (int p = 0; p < hop; p++) {
+        st->olaNorm[p] = 1.0f / st->olaNorm[p];
+    }
+    return 0;
+}
+
+void stft_free(stft_state *st) {
+    stats_memory(-(long long)st->bufferBytes);
+    arena_free(st->analysis);
+    arena_free(st->synthesis);
+    arena_free(st->olaNorm);
+    arena_free(st->binGain);
+    arena_free(st->time_buf);
+    arena_free(st->spectrum);
+    arena_free(st->fft_input);
+    arena_free(st->fft_output);
+    arena_free(st->ifft_output);
+    arena_free(st->frame);
+    arena_free(st->overlapBuffer);
+    fft_real_free(st->rfft);
+    fft_complex_free(st->cfft_fwd);
+    fft_complex_free(st->cfft_inv);
+    memset(st, 0, sizeof(*st));
+}
+
+int stft_init(stft_state *st, const stft_config *cfg, int sampleRate, const eq_preset *eq, int useComplexFft) {
+    memset(st, 0, sizeof(*st));
+
+    const char *problem = stft_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid STFT configuration: %s\n", problem);
+        return -1;
+    }
+
+    int n = cfg->frameSize;
+    st->cfg = *cfg;
+    st->numBins = n / 2 + 1;
+    st->sampleRate = sampleRate;
+    st->useComplexFft = useComplexFft;
+
+    int planFailed, bufFailed;
+    if (useComplexFft) {
+        st->cfft_fwd = fft_complex_alloc(n, 0);
+        st->cfft_inv = fft_complex_alloc(n, 1);
+        planFailed = st->cfft_fwd == NULL || st->cfft_inv == NULL;
+
+        st->fft_input = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * n);
+        st->fft_output = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * n);
+        st->ifft_output = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * n);
+        bufFailed = st->fft_input == NULL || st->fft_output == NULL || st->ifft_output == NULL;
+    } else {
+        st->rfft = fft_real_alloc(n);
+        planFailed = st->rfft == NULL;
+
+        st->time_buf = (float *)arena_alloc(sizeof(float) * n);
+        st->spectrum = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * st->numBins);
+        bufFailed = st->time_buf == NULL || st->spectrum == NULL;
+    }
+
+    if (planFailed) {
+        fprintf(stderr, "Error: Failed to allocate FFT configuration.\n");
+        stft_free(st);
+        return -1;
+    }
+
+    st->analysis = (float *)arena_alloc(sizeof(float) * n);
+    st->synthesis = (float *)arena_alloc(sizeof(float) * n);
+    st->olaNorm = (float *)arena_alloc(sizeof(float) * cfg->hopSize);
+    st->binGain = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * (useComplexFft ? n : st->numBins));
+    st->frame = (float *)arena_calloc(n, sizeof(float));
+    st->overlapBuffer = (float *)arena_calloc(n, sizeof(float));
+    if (bufFailed || st->analysis == NULL || st->synthesis == NULL || st->olaNorm == NULL ||
+        st->binGain == NULL || st->frame == NULL || st->overlapBuffer == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for FFT buffers.\n");
+        stft_free(st);
+        return -1;
+    }
+    st->bufferBytes = sizeof(float) * (4 * (size_t)n + cfg->hopSize)
+                    + sizeof(fft_cpx) * (useComplexFft ? 4 * (size_t)n : 2 * (size_t)st->numBins)
+                    + (useComplexFft ? 0 : sizeof(float) * (size_t)n);
+    stats_memory((long long)st->bufferBytes);
+
+    stft_fill_window(st->analysis, n, cfg->analysisWindow);
+    stft_fill_window(st->synthesis, n, cfg->synthesisWindow);
+    if (build_ola_norm(st) != 0) {
+        fprintf(stderr, "Error: %s/%s windows with hop %d do not cover every sample\n",
+                stft_window_name(cfg->analysisWindow), stft_window_name(cfg->synthesisWindow), cfg->hopSize);
+        stft_free(st);
+        return -1;
+    }
+    // Fold the 1/N scale of the unnormalized inverse FFT into the synthesis window
+    for (int i = 0; i < n; i++) {
+        st->synthesis[i] /= n;
+    }
+    eq_build_gain_table(eq, sampleRate, n, st->binGain);
+    if (useComplexFft) {
+        // Negative frequencies get the conjugate gain so the result stays real
+        for (int k = st->numBins; k < n; k++) {
+            st->binGain[k].r = st->binGain[n - k].r;
+            st->binGain[k].i = -st->binGain[n - k].i;
+        }
+    }
+    st->gain = st->binGain;
+    st->kern = dsp_kernels_get();
+    stft_reset(st);
+    return 0;
+}
+
+void stft_reset(stft_state *st) {
+    int n = st->cfg.frameSize;
+    memset(st->frame, 0, n * sizeof(float));
+    memset(st->overlapBuffer, 0, n * sizeof(float));
+    // Start with frameSize - hopSize samples of silence so the first real
+    // sample is covered by as many frames as every other one; the matching
+    // output is dropped, keeping the output aligned with the input.
+    st->frameFill = n - st->cfg.hopSize;
+    st->skip = st->frameFill;
+    st->blockIndex = 0;
+}
+
+// Mirrors stft_push and stft_flush: one block per hop of input once the
+// frame is full, then one per hop of what is left in it
+long long stft_block_count(const stft_config *cfg, long long frames) {
+    long long hop = cfg->hopSize;
+    long long tail = cfg->frameSize - hop + frames % hop;
+    return frames / hop + (tail + hop - 1) / hop;
+}
+
+void stft_prime(stft_state *st, const float *history) {
+    memcpy(st->frame, history, (st->cfg.frameSize - st->cfg.hopSize) * sizeof(float));
+}
+
+// Real-input path: only the N/2+1 unique bins are transformed and filtered
+static void stft_block_real(stft_state *st) {
+    int n = st->cfg.frameSize;
+    int fill = st->frameFill;
+
+    uint64_t t = stats_begin();
+    if (st->source != NULL) {
+        st->source(st->spectrumCtx, st->blockIndex, st->spectrum, st->numBins);
+        t = stats_lap(STATS_FFT, t);
+    } else {
+        st->kern->mul(st->time_buf, st->frame, st->analysis, fill);
+        memset(st->time_buf + fill, 0, (n - fill) * sizeof(float));  // Zero padding
+        t = stats_lap(STATS_WINDOW, t);
+
+        fft_real_forward(st->rfft, st->time_buf, st->spectrum);
+        if (st->tap != NULL) {
+            st->tap(st->spectrumCtx, st->blockIndex, st->spectrum, st->numBins);
+        }
+        t = stats_lap(STATS_FFT, t);
+    }
+
+    // Every EQ band is already folded into the gains: one complex multiply per bin
+    const fft_cpx *gain = st->gain;
+    if (st->fadeLeft > 0) {
+        // Linear in the gains, reaching the new table on the last faded block
+        float a = (float)(st->fadeBlocks - st->fadeLeft + 1) / st->fadeBlocks;
+        for (int k = 0; k < st->numBins; k++) {
+            st->fadeGain[k].r = st->gainFrom[k].r + a * (gain[k].r - st->gainFrom[k].r);
+            st->fadeGain[k].i = st->gainFrom[k].i + a * (gain[k].i - st->gainFrom[k].i);
+        }
+        gain = st->fadeGain;
+        st->fadeLeft--;
+    }
+    st->kern->cmul(st->spectrum, gain, st->numBins);
+    t = stats_lap(STATS_FILTER, t);
+
+    fft_real_inverse(st->rfft, st->spectrum, st->time_buf);
+    t = stats_lap(STATS_IFFT, t);
+
+    st->kern->mul_add(st->overlapBuffer, st->time_buf, st->synthesis, n);
+    stats_lap(STATS_OVERLAP_ADD, t);
+}
+
+// Complex path: the real block is packed with zeroed imaginary parts and
+// filtered with the full mirrored gain table
+static void stft_block_complex(stft_state *st) {
+    int n = st->cfg.frameSize;
+
+    uint64_t t = stats_begin();
+    for (int i = 0; i < n; i++) {
+        st->fft_input[i].r = (i < st->frameFill) ? st->frame[i] * st->analysis[i] : 0.0f;
+        st->fft_input[i].i = 0.0f;  // Imaginary part
+    }
+    t = stats_lap(STATS_WINDOW, t);
+
+    fft_complex_run(st->cfft_fwd, st->fft_input, st->fft_output);
+    t = stats_lap(STATS_FFT, t);
+
+    st->kern->cmul(st->fft_output, st->binGain, n);
+    t = stats_lap(STATS_FILTER, t);
+
+    fft_complex_run(st->cfft_inv, st->fft_output, st->ifft_output);
+    t = stats_lap(STATS_IFFT, t);
+
+    for (int i = 0; i < n; i++) {
+        st->overlapBuffer[i] += st->ifft_output[i].r * st->synthesis[i];
+    }
+    stats_lap(STATS_OVERLAP_ADD, t);
+}
+
+// Filter one block (st->frame, zero-padded past frameFill) and emit the
+// first `emit` samples of the overlap buffer, which are now final.
+static int stft_block(stft_state *st, int emit, stft_sink sink, void *ctx) {
+    int n = st->cfg.frameSize;
+    int hop = st->cfg.hopSize;
+
+    if (st->useComplexFft) {
+        stft_block_complex(st);
+    } else {
+        stft_block_real(st);
+    }
+
+    // The first hop of the overlap buffer has received its last contribution
+    uint64_t t = stats_begin();
+    st->kern->mul(st->overlapBuffer, st->overlapBuffer, st->olaNorm, emit);
+    stats_lap(STATS_OVERLAP_ADD, t);
+    stats_count(STATS_BLOCKS, 1);
+    int drop = emit < st->skip ? emit : st->skip;
+    st->skip -= drop;
+    if (emit > drop && sink(ctx, st->overlapBuffer + drop, emit - drop) != 0) {
+        return -1;
+    }
+
+    // Update the overlap buffer (shift the previous part)
+    memmove(st->overlapBuffer, st->overlapBuffer + hop, (n - hop) * sizeof(float));
+    memset(st->overlapBuffer + (n - hop), 0, hop * sizeof(float));
+
+    // Slide the input block forward by one hop
+    memmove(st->frame, st->frame + hop, (n - hop) * sizeof(float));
+    st->frameFill -= hop;
+    st->blockIndex++;
+    return 0;
+}
+
+int stft_push(stft_state *st, const float *samples, int count, stft_sink sink, void *ctx) {
+    int n = st->cfg.frameSize;
+
+    while (count > 0) {
+        int take = n - st->frameFill;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(st->frame + st->frameFill, samples, take * sizeof(float));
+        st->frameFill += take;
+        samples += take;
+        count -= take;
+
+        if (st->frameFill == n && stft_block(st, st->cfg.hopSize, sink, ctx) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int stft_flush(stft_state *st, stft_sink sink, void *ctx) {
+    while (st->frameFill > 0) {
+        int emit = st->frameFill < st->cfg.hopSize ? st->frameFill : st->cfg.hopSize;
+        if (stft_block(st, emit, sink, ctx) != 0) {
+            return -1;
+        }
+    }
+    st->frameFill = 0;
+    return 0;
+}
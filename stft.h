@@ -0,0 +1,122 @@
+#ifndef STFT_H
+#define STFT_H
+
+#include <stddef.h>
+#include "fft.h"
+#include "eq.h"
+#include "dsp_kernels.h"
+
+// Analysis/synthesis window shapes. All are periodic (DFT-even), so the
+// usual hops (N/2, N/4) overlap-add to a constant.
+typedef enum {
+    WINDOW_RECT,
+    WINDOW_HANN,
+    WINDOW_HAMMING,
+    WINDOW_BLACKMAN_HARRIS,
+    WINDOW_SQRT_HANN
+} window_type;
+
+typedef struct {
+    int frameSize;               // FFT length, must be even
+    int hopSize;                 // 1..frameSize
+    window_type analysisWindow;  // applied before the forward FFT
+    window_type synthesisWindow; // applied after the inverse FFT
+} stft_config;
+
+// Called with each run of finished output samples
+typedef int (*stft_sink)(void *ctx, const float *samples, int count);
+
+// Reads (tap) or fills (source) the numBins-bin forward spectrum of block
+// number `block` of the stream
+typedef void (*stft_spectrum_fn)(void *ctx, long long block, fft_cpx *spectrum, int numBins);
+
+// Per-stream STFT filter: FFT plans, tables built once per configuration,
+// scratch buffers and the overlap-add tail. Memory use depends only on the
+// frame size, never on the stream length. Only the buffers of the selected
+// FFT path are allocated.
+typedef struct {
+    stft_config cfg;
+    int numBins;           // frameSize/2 + 1 unique bins of a real spectrum
+    int sampleRate;
+    int useComplexFft;     // full complex FFT instead of the real-input one
+
+    // Tables, built in stft_init
+    float *analysis;       // analysis window
+    float *synthesis;      // synthesis window with the 1/N inverse FFT scale folded in
+    float *olaNorm;        // per-phase 1/sum of overlapped window products, hopSize entries
+    fft_cpx *binGain;      // compiled EQ response per bin, numBins entries
+                           // (all frameSize, mirrored, on the complex path)
+    const dsp_kernels *kern;
+
+    // Spectrum cache hooks, real-input path only. With tap set every forward
+    // spectrum is handed to it; with source set the spectra come from it
+    // and the input samples are never windowed or transformed.
+    stft_spectrum_fn tap;
+    stft_spectrum_fn source;
+    void *spectrumCtx;
+    long long blockIndex;  // blocks filtered since the stream started
+
+    // Gains in use on the real-input path: binGain, or a live EQ table
+    // (eq_live.h). After a change, fadeLeft more blocks blend gainFrom into
+    // gain, each with its own step, in fadeGain.
+    const fft_cpx *gain;
+    const fft_cpx *gainFrom;
+    fft_cpx *fadeGain;     // numBins entries, owned by the live EQ
+    int fadeBlocks;
+    int fadeLeft;
+
+    // Real-input path: N real samples in, N/2+1 bins out
+    fft_real *rfft;
+    float *time_buf;
+    fft_cpx *spectrum;
+
+    // Complex path: both halves of the spectrum
+    fft_complex *cfft_fwd;
+    fft_complex *cfft_inv;
+    fft_cpx *fft_input;
+    fft_cpx *fft_output;
+    fft_cpx *ifft_output;
+
+    float *frame;          // input samples of the current block
+    int frameFill;         // valid samples in frame
+    float *overlapBuffer;  // overlap-add accumulator
+    int skip;              // leading padding samples still to drop from the output
+    size_t bufferBytes;    // heap buffers above, for the stats report
+} stft_state;
+
+void stft_config_default(stft_config *cfg);
+
+// Returns NULL if the configuration is usable, otherwise a description of the problem
+const char *stft_config_check(const stft_config *cfg);
+
+// Window name ("hann", "hamming", "blackman-harris", "sqrt-hann", "rect") to type; -1 if unknown
+int stft_parse_window(const char *name, window_type *type);
+const char *stft_window_name(window_type type);
+
+// Periodic window of length n, computed in double precision once per configuration
+void stft_fill_window(float *w, int n, window_type type);
+
+int stft_init(stft_state *st, const stft_config *cfg, int sampleRate, const eq_preset *eq, int useComplexFft);
+void stft_free(stft_state *st);
+
+// Forget the stream so the state can filter a new one, keeping the plans,
+// tables, buffers and hooks
+void stft_reset(stft_state *st);
+
+// Blocks a stream of `frames` samples goes through, flush included
+long long stft_block_count(const stft_config *cfg, long long frames);
+
+// Replace the silence a fresh stream starts with by the frameSize - hopSize
+// input samples that precede it. Call right after stft_init; output then
+// starts at the first pushed sample and is identical to what one stream
+// running over the whole input would have produced from there on.
+void stft_prime(stft_state *st, const float *history);
+
+// Feed input samples; every complete block is filtered and its finished hop
+// handed to the sink immediately.
+int stft_push(stft_state *st, const float *samples, int count, stft_sink sink, void *ctx);
+
+// End of input: run the zero-padded tail blocks until every sample is out
+int stft_flush(stft_state *st, stft_sink sink, void *ctx);
+
+#endif
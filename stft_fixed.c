@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stft_fixed.h"
+#include "stats.h"
+#include "arena.h"
+
+// Round x to the nearest integer and saturate it to [lo, hi]
+static int64_t quantize(double x, int64_t lo, int64_t hi) {
+    double v = floor(x + 0.5);
+    return v > (double)hi ? hi : v < (double)lo ? lo : (int64_t)v;
+}
+
+static void quantize_window(int16_t *q, int n, window_type type, float *scratch) {
+    stft_fill_window(scratch, n, type);
+    for (int i = 0; i < n; i++) {
+        q[i] = (int16_t)quantize(scratch[i] * 32768.0, INT16_MIN, INT16_MAX);
+    }
+}
+
+// The overlap-add holds sum(x * analysis * synthesis) / N in Q29; each phase
+// p of a hop is scaled back to Q15 by N / (sum of the quantized window
+// products at p * 2^14), stored with one shift for all phases
+static int build_ola_norm(stft_fixed_state *st) {
+    int n = st->cfg.frameSize;
+    int hop = st->cfg.hopSize;
+    double *scale = (double *)arena_alloc(sizeof(double) * hop);
+    if (scale == NULL) {
+        return -1;
+    }
+    double maxSum = 0.0;
+    double minSum = INFINITY;
+    double maxScale = 0.0;
+    for (int p = 0; p < hop; p++) {
+        double sum = 0.0;
+        for (int i = p; i < n; i += hop) {
+            sum += (st->analysis[i] / 32768.0) * (st->synthesis[i] / 32768.0);
+        }
+        if (sum > maxSum) maxSum = sum;
+        if (sum < minSum) minSum = sum;
+        scale[p] = sum > 0.0 ? n / (sum * 16384.0) : 0.0;
+        if (scale[p] > maxScale) maxScale = scale[p];
+    }
+
+    int exponent;
+    frexp(maxScale, &exponent);  // maxScale < 2^exponent
+    st->normShift = 31 - exponent;
+    int status = minSum > 1e-6 * maxSum && st->normShift >= 1 && st->normShift <= 62 ? 0 : -1;
+    for (int p = 0; status == 0 && p < hop; p++) {
+        st->olaNorm[p] = (int32_t)quantize(ldexp(scale[p], st->normShift), 0, INT32_MAX);
+    }
+    arena_free(scale);
+    return status;
+}
+
+// The EQ response for every bin, negative frequencies conjugated, with the
+// exponent chosen so the largest component still fits in Q31
+static int build_gain_table(stft_fixed_state *st, const eq_preset *eq) {
+    int n = st->cfg.frameSize;
+    int numBins = n / 2 + 1;
+    fft_cpx *gains = (fft_cpx *)arena_alloc(sizeof(fft_cpx) * numBins);
+    if (gains == NULL) {
+        return -1;
+    }
+    eq_build_gain_table(eq, st->sampleRate, n, gains);
+
+    double maxGain = 0.0;
+    for (int k = 0; k < numBins; k++) {
+        maxGain = fmax(maxGain, fmax(fabs(gains[k].r), fabs(gains[k].i)));
+    }
+    int exponent;
+    frexp(maxGain, &exponent);
+    exponent = exponent < 0 ? 0 : exponent > 30 ? 30 : exponent;
+    st->gainShift = 31 - exponent;
+
+    for (int k = 0; k < n; k++) {
+        const fft_cpx *g = &gains[k < numBins ? k : n - k];
+        double sign = k < numBins ? 1.0 : -1.0;
+        st->binGain[k].r = (int32_t)quantize(ldexp(g->r, st->gainShift), -INT32_MAX, INT32_MAX);
+        st->binGain[k].i = (int32_t)quantize(ldexp(sign * g->i, st->gainShift), -INT32_MAX, INT32_MAX);
+    }
+    arena_free(gains);
+    return 0;
+}
+
+void stft_fixed_free(stft_fixed_state *st) {
+    stats_memory(-(long long)st->bufferBytes);
+    arena_free(st->analysis);
+    arena_free(st->synthesis);
+    arena_free(st->olaNorm);
+    arena_free(st->binGain);
+    arena_free(st->time_buf);
+    arena_free(st->spectrum);
+    arena_free(st->ifft_output);
+    arena_free(st->frame);
+    arena_free(st->overlapBuffer);
+    arena_free(st->out);
+    fft_fixed_free(st->fwd);
+    fft_fixed_free(st->inv);
+    memset(st, 0, sizeof(*st));
+}
+
+int stft_fixed_init(stft_fixed_state *st, const stft_config *cfg, int sampleRate, const eq_preset *eq) {
+    memset(st, 0, sizeof(*st));
+
+    const char *problem = stft_config_check(cfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid STFT configuration: %s\n", problem);
+        return -1;
+    }
+
+    int n = cfg->frameSize;
+    int hop = cfg->hopSize;
+    st->cfg = *cfg;
+    st->sampleRate = sampleRate;
+
+    st->fwd = fft_fixed_alloc(n, 0);
+    st->inv = st->fwd != NULL ? fft_fixed_alloc(n, 1) : NULL;
+    if (st->fwd == NULL || st->inv == NULL) {
+        fprintf(stderr, "Error: Failed to allocate FFT configuration.\n");
+        stft_fixed_free(st);
+        return -1;
+    }
+
+    st->analysis = (int16_t *)arena_alloc(sizeof(int16_t) * n);
+    st->synthesis = (int16_t *)arena_alloc(sizeof(int16_t) * n);
+    st->olaNorm = (int32_t *)arena_alloc(sizeof(int32_t) * hop);
+    st->binGain = (fft_fixed_cpx *)arena_alloc(sizeof(fft_fixed_cpx) * n);
+    st->time_buf = (int32_t *)arena_alloc(sizeof(int32_t) * n);
+    st->spectrum = (fft_fixed_cpx *)arena_alloc(sizeof(fft_fixed_cpx) * n);
+    st->ifft_output = (fft_fixed_cpx *)arena_alloc(sizeof(fft_fixed_cpx) * n);
+    st->frame = (int16_t *)arena_calloc(n, sizeof(int16_t));
+    st->overlapBuffer = (int32_t *)arena_calloc(n, sizeof(int32_t));
+    st->out = (int16_t *)arena_alloc(sizeof(int16_t) * hop);
+    float *scratch = (float *)arena_alloc(sizeof(float) * n);
+    if (st->analysis == NULL || st->synthesis == NULL || st->olaNorm == NULL || st->binGain == NULL ||
+        st->time_buf == NULL || st->spectrum == NULL || st->ifft_output == NULL || st->frame == NULL ||
+        st->overlapBuffer == NULL || st->out == NULL || scratch == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for FFT buffers.\n");
+        arena_free(scratch);
+        stft_fixed_free(st);
+        return -1;
+    }
+    st->bufferBytes = sizeof(int16_t) * (3 * (size_t)n + hop) + sizeof(int32_t) * (2 * (size_t)n + hop)
+                    + sizeof(fft_fixed_cpx) * 3 * (size_t)n;
+    stats_memory((long long)st->bufferBytes);
+
+    quantize_window(st->analysis, n, cfg->analysisWindow, scratch);
+    quantize_window(st->synthesis, n, cfg->synthesisWindow, scratch);
+    arena_free(scratch);
+    if (build_ola_norm(st) != 0) {
+        fprintf(stderr, "Error: %s/%s windows with hop %d do not cover every sample in fixed point\n",
+                stft_window_name(cfg->analysisWindow), stft_window_name(cfg->synthesisWindow), hop);
+        stft_fixed_free(st);
+        return -1;
+    }
+    if (build_gain_table(st, eq) != 0) {
+        fprintf(stderr, "Error: Failed to allocate memory for FFT buffers.\n");
+        stft_fixed_free(st);
+        return -1;
+    }
+    st->kern = dsp_kernels_get();
+    stft_fixed_reset(st);
+    return 0;
+}
+
+void stft_fixed_reset(stft_fixed_state *st) {
+    int n = st->cfg.frameSize;
+    memset(st->frame, 0, n * sizeof(int16_t));
+    memset(st->overlapBuffer, 0, n * sizeof(int32_t));
+    st->frameFill = n - st->cfg.hopSize;
+    st->skip = st->frameFill;
+}
+
+void stft_fixed_prime(stft_fixed_state *st, const int16_t *history) {
+    memcpy(st->frame, history, (st->cfg.frameSize - st->cfg.hopSize) * sizeof(int16_t));
+}
+
+static int stft_fixed_block(stft_fixed_state *st, int emit, stft_fixed_sink sink, void *ctx) {
+    int n = st->cfg.frameSize;
+    int hop = st->cfg.hopSize;
+    int fill = st->frameFill;
+
+    uint64_t t = stats_begin();
+    st->kern->window_q15(st->time_buf, st->frame, st->analysis, fill);
+    memset(st->time_buf + fill, 0, (n - fill) * sizeof(int32_t));  // Zero padding
+    t = stats_lap(STATS_WINDOW, t);
+
+    fft_fixed_run_real(st->fwd, st->time_buf, st->spectrum);
+    t = stats_lap(STATS_FFT, t);
+
+    st->kern->cmul_q31(st->spectrum, st->binGain, st->gainShift, n);
+    t = stats_lap(STATS_FILTER, t);
+
+    fft_fixed_run(st->inv, st->spectrum, st->ifft_output);
+    t = stats_lap(STATS_IFFT, t);
+
+    st->kern->mul_add_q15(st->overlapBuffer, st->ifft_output, st->synthesis, n);
+
+    // The first hop of the overlap buffer has received its last contribution
+    int64_t round = 1LL << (st->normShift - 1);
+    for (int i = 0; i < emit; i++) {
+        int64_t v = ((int64_t)st->overlapBuffer[i] * st->olaNorm[i] + round) >> st->normShift;
+        st->out[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+    }
+    stats_lap(STATS_OVERLAP_ADD, t);
+    stats_count(STATS_BLOCKS, 1);
+    int drop = emit < st->skip ? emit : st->skip;
+    st->skip -= drop;
+    if (emit > drop && sink(ctx, st->out + drop, emit - drop) != 0) {
+        return -1;
+    }
+
+    memmove(st->overlapBuffer, st->overlapBuffer + hop, (n - hop) * sizeof(int32_t));
+    memset(st->overlapBuffer + (n - hop), 0, hop * sizeof(int32_t));
+    memmove(st->frame, st->frame + hop, (n - hop) * sizeof(int16_t));
+    st->frameFill -= hop;
+    return 0;
+}
+
+int stft_fixed_push(stft_fixed_state *st, const int16_t *samples, int count, stft_fixed_sink sink, void *ctx) {
+    int n = st->cfg.frameSize;
+
+    while (count > 0) {
+        int take = n - st->frameFill;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(st->frame + st->frameFill, samples, take * sizeof(int16_t));
+        st->frameFill += take;
+        samples += take;
+        count -= take;
+
+        if (st->frameFill == n && stft_fixed_block(st, st->cfg.hopSize, sink, ctx) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int stft_fixed_flush(stft_fixed_state *st, stft_fixed_sink sink, void *ctx) {
+    while (st->frameFill > 0) {
+        int emit = st->frameFill < st->cfg.hopSize ? st->frameFill : st->cfg.hopSize;
+        if (stft_fixed_block(st, emit, sink, ctx) != 0) {
+            return -1;
+        }
+    }
+    st->frameFill = 0;
+    return 0;
+}
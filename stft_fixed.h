@@ -0,0 +1,66 @@
+#ifndef STFT_FIXED_H
+#define STFT_FIXED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fft_fixed.h"
+#include "stft.h"
+#include "eq.h"
+#include "dsp_kernels.h"
+
+// Integer version of the STFT filter, modelling a datapath like the FPGA's:
+// 16-bit samples in and out, no floating point per sample. Formats:
+//
+//   samples, windows   Q15 (int16); a window value of 1.0 saturates to 32767
+//   windowed block     Q29 (int32), one bit of headroom for the FFT
+//   spectrum           Q29 scaled by 1/N by the fixed-point FFT
+//   EQ gain            Q(31 - e) per bin, e the smallest exponent with every
+//                      |gain| < 2^e; the product saturates to +-FFT_FIXED_MAX
+//   overlap-add        Q29 scaled by 1/N (int32, saturating)
+//   output             Q15: times N / sum of window products, rounded and
+//                      saturated to int16
+//
+// The FFT is complex, as on an FFT core, with zero imaginary input; frame
+// sizes must be powers of two. Results are exact integers, so every kernel
+// variant, and any implementation of the same arithmetic, gives the same
+// output. Compared with the float filter the output is within a few LSBs.
+typedef struct {
+    stft_config cfg;
+    int sampleRate;
+
+    // Tables, built in stft_fixed_init
+    int16_t *analysis;
+    int16_t *synthesis;
+    int32_t *olaNorm;       // per phase: N / (window product sum * 2^14), in Q(normShift)
+    int normShift;
+    fft_fixed_cpx *binGain; // all frameSize bins, mirrored, Q(gainShift)
+    int gainShift;
+    const dsp_kernels *kern;
+
+    fft_fixed *fwd;
+    fft_fixed *inv;
+    int32_t *time_buf;      // windowed block
+    fft_fixed_cpx *spectrum;
+    fft_fixed_cpx *ifft_output;
+
+    int16_t *frame;         // input samples of the current block
+    int frameFill;
+    int32_t *overlapBuffer;
+    int16_t *out;           // one finished hop
+    int skip;
+    size_t bufferBytes;
+} stft_fixed_state;
+
+// Called with each run of finished output samples
+typedef int (*stft_fixed_sink)(void *ctx, const int16_t *samples, int count);
+
+int stft_fixed_init(stft_fixed_state *st, const stft_config *cfg, int sampleRate, const eq_preset *eq);
+void stft_fixed_free(stft_fixed_state *st);
+
+// The same contracts as stft_reset, stft_prime, stft_push and stft_flush
+void stft_fixed_reset(stft_fixed_state *st);
+void stft_fixed_prime(stft_fixed_state *st, const int16_t *history);
+int stft_fixed_push(stft_fixed_state *st, const int16_t *samples, int count, stft_fixed_sink sink, void *ctx);
+int stft_fixed_flush(stft_fixed_state *st, stft_fixed_sink sink, void *ctx);
+
+#endif
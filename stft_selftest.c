@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stft.h"
+
+// Runs the same random multichannel input through the real-input and the
+// complex FFT paths of the STFT filter and fails if any output sample
+// differs by more than STFT_TEST_TOLERANCE, over several frame/hop/window
+// configurations and presets:
+//
+//   ./stft_selftest
+//
+// Input is pushed in uneven chunks and flushed, as the stream filters do.
+
+#define STFT_TEST_TOLERANCE 1e-5
+#define STFT_TEST_CHANNELS 3
+#define STFT_TEST_FRAMES 20011     // not a multiple of any hop
+#define STFT_TEST_RATE 48000
+
+typedef struct {
+    float *samples;
+    int count;
+    int capacity;
+} collect_buf;
+
+static int collect_sink(void *ctx, const float *samples, int count) {
+    collect_buf *buf = (collect_buf *)ctx;
+    if (buf->count + count > buf->capacity) {
+        fprintf(stderr, "Error: The filter produced more output than it was given input\n");
+        return -1;
+    }
+    memcpy(buf->samples + buf->count, samples, sizeof(float) * count);
+    buf->count += count;
+    return 0;
+}
+
+// Filter one channel; returns the samples written to out, or -1
+static int run_path(const stft_config *cfg, const eq_preset *eq, int useComplexFft, const float *in, float *out) {
+    stft_state st;
+    if (stft_init(&st, cfg, STFT_TEST_RATE, eq, useComplexFft) != 0) {
+        return -1;
+    }
+    collect_buf buf = {out, 0, STFT_TEST_FRAMES};
+    int status = 0;
+    for (int pos = 0, step = 1; status == 0 && pos < STFT_TEST_FRAMES; pos += step, step = step * 7 % 1009 + 1) {
+        int count = STFT_TEST_FRAMES - pos < step ? STFT_TEST_FRAMES - pos : step;
+        status = stft_push(&st, in + pos, count, collect_sink, &buf);
+    }
+    if (status == 0) {
+        status = stft_flush(&st, collect_sink, &buf);
+    }
+    stft_free(&st);
+    return status == 0 ? buf.count : -1;
+}
+
+int main(void) {
+    stft_config configs[4];
+    stft_config_default(&configs[0]);
+    configs[1] = (stft_config){256, 64, WINDOW_HANN, WINDOW_HANN};
+    configs[2] = (stft_config){2048, 512, WINDOW_SQRT_HANN, WINDOW_SQRT_HANN};
+    configs[3] = (stft_config){512, 128, WINDOW_BLACKMAN_HARRIS, WINDOW_RECT};
+
+    eq_preset presets[2];
+    eq_preset_default(&presets[0]);
+    eq_preset *eq = &presets[1];
+    memset(eq, 0, sizeof(*eq));
+    eq->preampDb = -3.0;
+    eq->bands[eq->numBands++] = (eq_band){EQ_LOW_SHELF, 120.0, 6.0, 0.7};
+    eq->bands[eq->numBands++] = (eq_band){EQ_PEAKING, 2500.0, -9.0, 2.0};
+    eq->bands[eq->numBands++] = (eq_band){EQ_LOWPASS, 15000.0, 0.0, 0.707};
+
+    float *in = (float *)malloc(sizeof(float) * STFT_TEST_FRAMES * STFT_TEST_CHANNELS);
+    float *outReal = (float *)malloc(sizeof(float) * STFT_TEST_FRAMES);
+    float *outComplex = (float *)malloc(sizeof(float) * STFT_TEST_FRAMES);
+    if (in == NULL || outReal == NULL || outComplex == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        free(in);
+        free(outReal);
+        free(outComplex);
+        return 1;
+    }
+    srand(12345);
+    for (int i = 0; i < STFT_TEST_FRAMES * STFT_TEST_CHANNELS; i++) {
+        in[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+    }
+
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        for (size_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+            const stft_config *cfg = &configs[c];
+            double worst = 0.0;
+            int ok = 1;
+            for (int ch = 0; ok && ch < STFT_TEST_CHANNELS; ch++) {
+                const float *chIn = in + (size_t)ch * STFT_TEST_FRAMES;
+                int nReal = run_path(cfg, &presets[p], 0, chIn, outReal);
+                int nComplex = run_path(cfg, &presets[p], 1, chIn, outComplex);
+                if (nReal < 0 || nComplex < 0 || nReal != nComplex) {
+                    fprintf(stderr, "Error: Output lengths differ: real %d, complex %d\n", nReal, nComplex);
+                    ok = 0;
+                    break;
+                }
+                for (int i = 0; i < nReal; i++) {
+                    double d = fabs((double)outReal[i] - outComplex[i]);
+                    worst = d > worst ? d : worst;
+                }
+            }
+            ok = ok && worst <= STFT_TEST_TOLERANCE;
+            failed += !ok;
+            printf("%s frame %d hop %d %s/%s, preset %zu: max difference %.2e\n", ok ? "ok  " : "FAIL",
+                   cfg->frameSize, cfg->hopSize, stft_window_name(cfg->analysisWindow),
+                   stft_window_name(cfg->synthesisWindow), p, worst);
+        }
+    }
+    free(in);
+    free(outReal);
+    free(outComplex);
+    if (failed > 0) {
+        fprintf(stderr, "Error: %d configuration(s) differ between the real and complex FFT paths\n", failed);
+        return 1;
+    }
+    return 0;
+}
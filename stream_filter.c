@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wav_processor.h"
+
+int wav_writer_sink(void *ctx, const float *const *planes, int frames) {
+    return wav_writer_write((wav_writer *)ctx, planes, frames);
+}
+
+// Read the input in fixed-size chunks and write each hop as soon as it is
+// finished. Channels are filtered independently, each with its own
+// overlap-add state, concurrently when a pool is given. Peak memory is one
+// read chunk plus one FFT frame of state per channel.
+int stream_filter(wav_reader *in, wav_writer *out, const filter_options *opts, thread_pool *pool) {
+    eq_engine *e = eq_engine_create(in->info.samplerate, in->info.channels, opts, pool);
+    if (e == NULL) {
+        return -1;
+    }
+    int status = stream_filter_engine(in, out, e);
+    eq_engine_destroy(e);
+    return status;
+}
+
+int stream_filter_engine(wav_reader *in, wav_writer *out, eq_engine *e) {
+    // The reader converts straight into the engine's input planes and the
+    // writer straight from its output planes
+    float *const *inPlanes = eq_engine_input(e);
+    int status = 0;
+    sf_count_t framesRead;
+    sf_count_t totalRead = 0;
+    while (status == 0 && (framesRead = wav_reader_read(in, inPlanes, STREAM_CHUNK_FRAMES)) > 0) {
+        totalRead += framesRead;
+        status = eq_engine_run(e, (int)framesRead, wav_writer_sink, out);
+    }
+    if (framesRead < 0) {
+        status = -1;
+    }
+
+    if (status == 0) {
+        status = eq_engine_flush(e, wav_writer_sink, out);
+    }
+    if (status == 0 && in->info.frames > 0 && totalRead != in->info.frames) {
+        fprintf(stderr, "Warning: Expected %lld frames but read %lld frames\n", (long long)in->info.frames, (long long)totalRead);
+    }
+    return status;
+}
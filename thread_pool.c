@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+typedef thread_pool_job pool_job;
+
+// Per-worker deque: the owner pushes and pops at the tail, thieves take
+// from the head, so stolen work is the oldest (usually largest) job.
+typedef struct {
+    pthread_mutex_t lock;
+    pool_job *head;
+    pool_job *tail;
+} job_queue;
+
+typedef struct {
+    thread_pool *pool;
+    int index;
+} worker_arg;
+
+struct thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t workAvailable;
+    pthread_cond_t allDone;
+    int unclaimed;      // queued jobs no worker has claimed yet
+    int pending;        // queued + running jobs
+    int stopping;
+    unsigned nextQueue; // round-robin target for jobs submitted from outside the pool
+    int numThreads;
+    int numStarted;     // workers actually running, joined on destroy
+    job_queue *queues;
+    worker_arg *args;
+    pthread_t *threads;
+};
+
+static __thread int currentWorker = -1;
+static __thread thread_pool *currentPool = NULL;
+
+int thread_pool_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+int thread_pool_worker_index(const thread_pool *pool) {
+    return currentPool == pool ? currentWorker : -1;
+}
+
+static void queue_push_tail(job_queue *q, pool_job *job) {
+    pthread_mutex_lock(&q->lock);
+    job->next = NULL;
+    job->prev = q->tail;
+    if (q->tail != NULL) {
+        q->tail->next = job;
+    } else {
+        q->head = job;
+    }
+    q->tail = job;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static pool_job *queue_pop(job_queue *q, int fromTail) {
+    pthread_mutex_lock(&q->lock);
+    pool_job *job = fromTail ? q->tail : q->head;
+    if (job != NULL) {
+        if (job->prev != NULL) {
+            job->prev->next = job->next;
+        } else {
+            q->head = job->next;
+        }
+        if (job->next != NULL) {
+            job->next->prev = job->prev;
+        } else {
+            q->tail = job->prev;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+// Take a claimed job: own queue first (newest), then steal the oldest job
+// of the other workers. A claim guarantees a job exists somewhere, but a
+// racing submitter may not have been scanned yet, so loop until found.
+static pool_job *take_job(thread_pool *pool, int self) {
+    for (;;) {
+        pool_job *job = queue_pop(&pool->queues[self], 1);
+        for (int i = 1; job == NULL && i < pool->numThreads; i++) {
+            job = queue_pop(&pool->queues[(self + i) % pool->numThreads], 0);
+        }
+        if (job != NULL) {
+            return job;
+        }
+    }
+}
+
+static void *pool_worker(void *arg) {
+    worker_arg *wa = (worker_arg *)arg;
+    thread_pool *pool = wa->pool;
+    currentPool = pool;
+    currentWorker = wa->index;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->unclaimed == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->workAvailable, &pool->lock);
+        }
+        if (pool->unclaimed == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;  // stopping and nothing left to do
+        }
+        pool->unclaimed--;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool_job *job = take_job(pool, wa->index);
+        int allocated = job->allocated;  // a caller's node is theirs again once fn returns
+        job->fn(job->arg);
+        if (allocated) {
+            free(job);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_broadcast(&pool->allDone);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+thread_pool *thread_pool_create(int numThreads) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+
+    thread_pool *pool = (thread_pool *)calloc(1, sizeof(thread_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->threads = (pthread_t *)calloc(numThreads, sizeof(pthread_t));
+    pool->queues = (job_queue *)calloc(numThreads, sizeof(job_queue));
+    pool->args = (worker_arg *)calloc(numThreads, sizeof(worker_arg));
+    if (pool->threads == NULL || pool->queues == NULL || pool->args == NULL) {
+        free(pool->threads);
+        free(pool->queues);
+        free(pool->args);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workAvailable, NULL);
+    pthread_cond_init(&pool->allDone, NULL);
+    for (int i = 0; i < numThreads; i++) {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+    }
+
+    // Queues exist for every requested worker so the count is fixed before
+    // any thread can start stealing
+    pool->numThreads = numThreads;
+    for (int i = 0; i < numThreads; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].index = i;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, &pool->args[i]) != 0) {
+            // Jobs would sit in queues nobody owns; stop what did start
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+        pool->numStarted++;
+    }
+    return pool;
+}
+
+static void queue_job(thread_pool *pool, pool_job *job) {
+    // Workers keep their own follow-up jobs; outside jobs are spread round-robin
+    int target = thread_pool_worker_index(pool);
+    if (target < 0) {
+        target = (int)(__atomic_fetch_add(&pool->nextQueue, 1, __ATOMIC_RELAXED) % (unsigned)pool->numThreads);
+    }
+    queue_push_tail(&pool->queues[target], job);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pool->unclaimed++;
+    pthread_cond_signal(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_pool_submit(thread_pool *pool, thread_pool_fn fn, void *arg) {
+    pool_job *job = (pool_job *)malloc(sizeof(pool_job));
+    if (job == NULL) {
+        return -1;
+    }
+    job->fn = fn;
+    job->arg = arg;
+    job->allocated = 1;
+    queue_job(pool, job);
+    return 0;
+}
+
+void thread_pool_submit_job(thread_pool *pool, thread_pool_job *job, thread_pool_fn fn, void *arg) {
+    job->fn = fn;
+    job->arg = arg;
+    job->allocated = 0;
+    queue_job(pool, job);
+}
+
+void thread_pool_wait(thread_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->allDone, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_pool_size(const thread_pool *pool) {
+    return pool->numThreads;
+}
+
+void thread_pool_destroy(thread_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->workAvailable);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->numStarted; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool->numThreads; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+    pthread_cond_destroy(&pool->allDone);
+    pthread_cond_destroy(&pool->workAvailable);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->queues);
+    free(pool->args);
+    free(pool);
+}
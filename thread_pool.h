@@ -0,0 +1,48 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+typedef void (*thread_pool_fn)(void *arg);
+
+typedef struct thread_pool thread_pool;
+
+// A queued job. thread_pool_submit allocates one per call;
+// thread_pool_submit_job takes one the caller owns, so a caller that runs
+// the same jobs every block (the channels of a stream) queues them without
+// allocating. Fields are the pool's while the job is queued or running.
+typedef struct thread_pool_job {
+    thread_pool_fn fn;
+    void *arg;
+    struct thread_pool_job *prev;
+    struct thread_pool_job *next;
+    int allocated;   // freed by the pool once it has run
+} thread_pool_job;
+
+// Number of online CPUs (at least 1)
+int thread_pool_cpu_count(void);
+
+// Start numThreads workers; NULL on failure
+thread_pool *thread_pool_create(int numThreads);
+
+// Queue fn(arg) to run on a worker. Each worker owns a deque and idle
+// workers steal from the others, so uneven jobs still keep every core busy.
+// Jobs submitted from a worker go to that worker's own deque.
+// Returns -1 if the job could not be queued.
+int thread_pool_submit(thread_pool *pool, thread_pool_fn fn, void *arg);
+
+// The same with a caller-owned node, which must stay valid and untouched
+// until thread_pool_wait returns. Cannot fail.
+void thread_pool_submit_job(thread_pool *pool, thread_pool_job *job, thread_pool_fn fn, void *arg);
+
+// Block until every job submitted so far has finished
+void thread_pool_wait(thread_pool *pool);
+
+int thread_pool_size(const thread_pool *pool);
+
+// Index (0..size-1) of the calling worker thread of this pool, -1 if the
+// caller is not one of its workers. Lets jobs keep per-worker state.
+int thread_pool_worker_index(const thread_pool *pool);
+
+// Finish queued jobs, stop the workers and free the pool
+void thread_pool_destroy(thread_pool *pool);
+
+#endif
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "modulator.h"
+#include "pdm_file.h"
+#include "wav_io.h"
+
+// Plays an equalized WAV through a model of the speaker-side modulators and
+// writes the bit stream the speaker pin would carry:
+//
+//   ./wav2pdm out.wav speaker.pdm                     pcm_to_pdm, 64x, order 1
+//   ./wav2pdm --order 2 --channel 0 out.wav pdm_left.txt
+//   ./wav2pdm --pwm --bit-depth 8 out.wav pwm.pdm      pcm_to_pwm
+//
+// An output named *.pdm is a packed capture (pdm_file.h) that pdm2wav and
+// pdm_convert take back; anything else, or "-" for stdout, is $readmemb
+// text with one bit per line, like the tbs stimulus files. Channels are
+// interleaved per clock, channel 0 first; --channel keeps one. The first-order
+// loop is the one tbs/ds_gen.py runs per sample, on integers. --check also
+// runs the clock-by-clock reference models and fails on any difference.
+
+#define CHUNK_BITS (1 << 22)       // bits per channel per block
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input.wav> <output.pdm|output.txt|->\n", prog);
+    fprintf(stderr, "  --pwm                 model pcm_to_pwm instead of pcm_to_pdm\n");
+    fprintf(stderr, "  --order N             PDM: sigma-delta order, 1 or 2 (default 1)\n");
+    fprintf(stderr, "                        PWM: noise shaping of the requantization, 0..2\n");
+    fprintf(stderr, "                        (default 0: the top bits, truncated)\n");
+    fprintf(stderr, "  --oversample N        PDM clocks per PCM sample (default 64)\n");
+    fprintf(stderr, "  --width N             PCM bits into the modulator (default 24)\n");
+    fprintf(stderr, "  --bit-depth N         PWM counter bits, BIT_DEPTH (default 8)\n");
+    fprintf(stderr, "  --channel N           only channel N (from 0) of the input\n");
+    fprintf(stderr, "  --msb-first           packed output with the first bit of each byte in its top bit\n");
+    fprintf(stderr, "  --check               compare against the clock-by-clock reference models\n");
+    fprintf(stderr, "  --kernels NAME        force the DSP kernel set: scalar, sse2, avx2, avx512\n");
+}
+
+// Value of an option that takes an argument; NULL (with a message) if missing
+static const char *option_value(int argc, char *argv[], int *argi) {
+    if (*argi + 1 >= argc) {
+        fprintf(stderr, "Error: Option '%s' needs a value\n", argv[*argi]);
+        return NULL;
+    }
+    return argv[++*argi];
+}
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// The models of one channel: the packed one, and its reference for --check
+typedef struct {
+    int pwm;
+    pdm_mod pdm;
+    pwm_mod pwmMod;
+    pdm_mod pdmRef;
+    pwm_mod pwmRef;
+} channel_mod;
+
+static size_t run_mod(channel_mod *m, const int32_t *in, size_t count, uint64_t *words) {
+    return m->pwm ? pwm_mod_process(&m->pwmMod, in, count, words) : pdm_mod_process(&m->pdm, in, count, words);
+}
+
+static int check_block(channel_mod *m, int channel, const int32_t *in, size_t count, const uint64_t *words,
+                       unsigned char *ref, unsigned long long base) {
+    size_t bits = m->pwm ? pwm_mod_ref_process(&m->pwmRef, in, count, ref) : pdm_mod_ref_process(&m->pdmRef, in, count, ref);
+    for (size_t k = 0; k < bits; k++) {
+        if (((words[k / 64] >> (k % 64)) & 1) != ref[k]) {
+            fprintf(stderr, "Error: Channel %d bit %llu differs: packed model %d, reference %d\n",
+                    channel, base + k, (int)((words[k / 64] >> (k % 64)) & 1), ref[k]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    pdm_mod_config pdmCfg;
+    pdm_mod_config_default(&pdmCfg);
+    pwm_mod_config pwmCfg;
+    pwm_mod_config_default(&pwmCfg);
+    int pwm = 0;
+    int order = -1;
+    int width = -1;
+    int channel = -1;
+    int msbFirst = 0;
+    int check = 0;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        const char *opt = argv[argi];
+        const char *value = NULL;
+        if (strcmp(opt, "--pwm") == 0) {
+            pwm = 1;
+            continue;
+        }
+        if (strcmp(opt, "--msb-first") == 0) {
+            msbFirst = 1;
+            continue;
+        }
+        if (strcmp(opt, "--check") == 0) {
+            check = 1;
+            continue;
+        }
+        if ((value = option_value(argc, argv, &argi)) == NULL) {
+            return 1;
+        }
+        if (strcmp(opt, "--order") == 0) {
+            order = atoi(value);
+        } else if (strcmp(opt, "--oversample") == 0) {
+            pdmCfg.oversample = atoi(value);
+        } else if (strcmp(opt, "--width") == 0) {
+            width = atoi(value);
+        } else if (strcmp(opt, "--bit-depth") == 0) {
+            pwmCfg.bitDepth = atoi(value);
+        } else if (strcmp(opt, "--channel") == 0) {
+            channel = atoi(value);
+            if (channel < 0) {
+                fprintf(stderr, "Error: --channel needs a channel number from 0\n");
+                return 1;
+            }
+        } else if (strcmp(opt, "--kernels") == 0) {
+            if (dsp_kernels_select(value) != 0) {
+                fprintf(stderr, "Error: Kernel set '%s' is unknown or not supported by this CPU\n", value);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - argi != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *inPath = argv[argi];
+    const char *outPath = argv[argi + 1];
+    if (order >= 0) {
+        pdmCfg.order = order;
+        pwmCfg.order = order;
+    }
+    if (width >= 0) {
+        pdmCfg.width = width;
+        pwmCfg.width = width;
+    }
+    const char *problem = pwm ? pwm_mod_config_check(&pwmCfg) : pdm_mod_config_check(&pdmCfg);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid %s modulator configuration: %s\n", pwm ? "PWM" : "PDM", problem);
+        return 1;
+    }
+    int inWidth = pwm ? pwmCfg.width : pdmCfg.width;
+    size_t bitsPerSample = pwm ? (size_t)1 << pwmCfg.bitDepth : (size_t)pdmCfg.oversample;
+
+    wav_reader r;
+    if (wav_reader_open(&r, inPath) != 0) {
+        return 1;
+    }
+    int inChannels = r.info.channels;
+    if (channel >= inChannels) {
+        fprintf(stderr, "Error: '%s' has %d channels; there is no channel %d\n", inPath, inChannels, channel);
+        wav_reader_close(&r);
+        return 1;
+    }
+    int channels = channel >= 0 ? 1 : inChannels;
+    long long bitRate = (long long)r.info.samplerate * (long long)bitsPerSample * channels;
+    int packedOut = has_suffix(outPath, ".pdm");
+    if (packedOut && bitRate > INT_MAX) {
+        fprintf(stderr, "Error: The bit rate (%lld Hz) does not fit a .pdm header\n", bitRate);
+        wav_reader_close(&r);
+        return 1;
+    }
+
+    // Whole words per channel in every block but the last
+    size_t chunkFrames = CHUNK_BITS / bitsPerSample / 64 * 64;
+    chunkFrames = chunkFrames < 64 ? 64 : chunkFrames;
+    size_t chunkWords = (chunkFrames * bitsPerSample + 63) / 64;
+
+    channel_mod *mods = (channel_mod *)calloc((size_t)channels, sizeof(channel_mod));
+    float **planes = (float **)calloc((size_t)inChannels, sizeof(float *));
+    float **fill = (float **)calloc((size_t)inChannels, sizeof(float *));
+    uint64_t **words = (uint64_t **)calloc((size_t)channels, sizeof(uint64_t *));
+    int32_t *pcm = (int32_t *)malloc(sizeof(int32_t) * chunkFrames);
+    uint64_t *out = (uint64_t *)malloc(sizeof(uint64_t) * chunkWords * channels);
+    unsigned char *ref = check ? (unsigned char *)malloc(chunkFrames * bitsPerSample) : NULL;
+    int status = mods != NULL && planes != NULL && fill != NULL && words != NULL && pcm != NULL && out != NULL && (!check || ref != NULL) ? 0 : -1;
+    for (int c = 0; status == 0 && c < inChannels; c++) {
+        planes[c] = (float *)malloc(sizeof(float) * chunkFrames);
+        status = planes[c] != NULL ? 0 : -1;
+    }
+    for (int c = 0; status == 0 && c < channels; c++) {
+        words[c] = (uint64_t *)malloc(sizeof(uint64_t) * chunkWords);
+        status = words[c] != NULL ? 0 : -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+    }
+    for (int c = 0; status == 0 && c < channels; c++) {
+        channel_mod *m = &mods[c];
+        m->pwm = pwm;
+        if (pwm) {
+            status = pwm_mod_init(&m->pwmMod, &pwmCfg) == 0 && pwm_mod_init(&m->pwmRef, &pwmCfg) == 0 ? 0 : -1;
+        } else {
+            status = pdm_mod_init(&m->pdm, &pdmCfg) == 0 && pdm_mod_init(&m->pdmRef, &pdmCfg) == 0 ? 0 : -1;
+        }
+    }
+
+    pdm_writer packed;
+    int packedOpen = 0;
+    FILE *text = NULL;
+    if (status == 0 && packedOut) {
+        uint64_t expected = r.info.frames > 0 ? (uint64_t)r.info.frames * bitsPerSample * channels : 0;
+        status = pdm_writer_open(&packed, outPath, (int)bitRate, msbFirst ? PDM_MSB_FIRST : PDM_LSB_FIRST, channels, expected);
+        packedOpen = status == 0;
+    } else if (status == 0) {
+        text = strcmp(outPath, "-") == 0 ? stdout : fopen(outPath, "w");
+        if (text == NULL) {
+            fprintf(stderr, "Error: Could not open output file '%s'\n", outPath);
+            status = -1;
+        }
+    }
+
+    double start = now_seconds();
+    double modSeconds = 0.0;
+    unsigned long long totalBits = 0;
+    long long totalFrames = 0;
+    while (status == 0) {
+        // Fill the block, so only the last one can end mid-word
+        size_t frames = 0;
+        while (frames < chunkFrames) {
+            for (int c = 0; c < inChannels; c++) {
+                fill[c] = planes[c] + frames;
+            }
+            sf_count_t got = wav_reader_read(&r, fill, (sf_count_t)(chunkFrames - frames));
+            if (got < 0) {
+                status = -1;
+            }
+            if (got <= 0) {
+                break;
+            }
+            frames += (size_t)got;
+        }
+        if (status != 0 || frames == 0) {
+            break;
+        }
+
+        double t = now_seconds();
+        size_t bits = 0;
+        for (int c = 0; c < channels; c++) {
+            mod_from_float(planes[channel >= 0 ? channel : c], inWidth, pcm, frames);
+            bits = run_mod(&mods[c], pcm, frames, words[c]);
+            if (check && check_block(&mods[c], channel >= 0 ? channel : c, pcm, frames, words[c], ref,
+                                     (unsigned long long)totalFrames * bitsPerSample) != 0) {
+                status = -1;
+                break;
+            }
+        }
+        mod_interleave((const uint64_t *const *)words, channels, bits, out);
+        modSeconds += now_seconds() - t;
+        if (status != 0) {
+            break;
+        }
+
+        if (packedOpen) {
+            status = pdm_writer_write(&packed, out, bits * channels);
+        } else if (pdm_append_readmemb(text, out, bits * channels) != 0) {
+            fprintf(stderr, "Error: Could not write '%s'\n", outPath);
+            status = -1;
+        }
+        totalBits += bits * channels;
+        totalFrames += (long long)frames;
+    }
+    if (packedOpen && pdm_writer_close(&packed) != 0) {
+        status = -1;
+    }
+    if (text != NULL && text != stdout && fclose(text) != 0) {
+        fprintf(stderr, "Error: Could not write '%s'\n", outPath);
+        status = -1;
+    }
+    double elapsed = now_seconds() - start;
+    if (status == 0) {
+        fprintf(stderr, "%s: %lld frames -> %llu bits at %lld Hz; modulator %.1f Mbit/s, %.1fx realtime overall\n",
+                pwm ? "PWM" : "PDM", totalFrames, totalBits, bitRate,
+                modSeconds > 0.0 ? (double)totalBits / modSeconds / 1e6 : 0.0,
+                elapsed > 0.0 ? (double)totalFrames / r.info.samplerate / elapsed : 0.0);
+        if (check) {
+            fprintf(stderr, "%s: packed model matches the clock-by-clock reference\n", pwm ? "PWM" : "PDM");
+        }
+    }
+
+    for (int c = 0; mods != NULL && c < channels; c++) {
+        if (!pwm) {
+            pdm_mod_free(&mods[c].pdm);
+            pdm_mod_free(&mods[c].pdmRef);
+        }
+    }
+    for (int c = 0; planes != NULL && c < inChannels; c++) {
+        free(planes[c]);
+    }
+    for (int c = 0; words != NULL && c < channels; c++) {
+        free(words[c]);
+    }
+    free(mods);
+    free(planes);
+    free(fill);
+    free(words);
+    free(pcm);
+    free(out);
+    free(ref);
+    wav_reader_close(&r);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "wav_processor.h"
+#include "dsp_kernels.h"
+#include "fft.h"
+
+// Benchmark of the filter pipeline on synthetic signals. For every signal,
+// channel count and length it writes a PCM16 file, then times
+//
+//   write       planar float -> WAV file (wav_writer)
+//   load        WAV file -> planar float (wav_reader)
+//   filter      the channel filters on in-memory planes
+//   end_to_end  file -> filter -> file, as the command line runs it
+//
+// over every frame size, hop and thread count given. Each result is one CSV
+// line on stdout; the best of --repeat runs is reported.
+
+#define BENCH_MAX_VALUES 16
+
+typedef struct {
+    int values[BENCH_MAX_VALUES];
+    int count;
+} bench_list;
+
+typedef enum {
+    SIGNAL_SWEEP,
+    SIGNAL_NOISE,
+    SIGNAL_SILENCE
+} bench_signal;
+
+static const char *signal_names[] = {"sweep", "noise", "silence"};
+
+typedef struct {
+    bench_list frames;
+    bench_list hopDivs;   // hop = frame / value
+    bench_list channels;
+    bench_list seconds;
+    bench_list threads;
+    int signals[3];
+    int numSignals;
+    int sampleRate;
+    int repeat;
+    const char *dir;
+    filter_options opts;
+} bench_config;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Comma-separated positive integers
+static int parse_list(const char *text, bench_list *list) {
+    list->count = 0;
+    while (*text != '\0') {
+        char *end;
+        long v = strtol(text, &end, 10);
+        if (end == text || v < 1 || list->count == BENCH_MAX_VALUES || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        list->values[list->count++] = (int)v;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return list->count > 0 ? 0 : -1;
+}
+
+static int parse_signals(const char *text, bench_config *cfg) {
+    cfg->numSignals = 0;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", text);
+    for (char *name = strtok(buf, ","); name != NULL; name = strtok(NULL, ",")) {
+        int found = -1;
+        for (int s = 0; s < 3; s++) {
+            if (strcmp(name, signal_names[s]) == 0) {
+                found = s;
+            }
+        }
+        if (found < 0 || cfg->numSignals == 3) {
+            return -1;
+        }
+        cfg->signals[cfg->numSignals++] = found;
+    }
+    return cfg->numSignals > 0 ? 0 : -1;
+}
+
+// Fill one plane per channel. The sweep is exponential from 20 Hz to 0.9x
+// Nyquist with a different start phase per channel; the noise is uniform
+// with its own seed per channel, so channels are never identical.
+static void synthesize(bench_signal signal, float *const *planes, int channels, sf_count_t frames, int sampleRate) {
+    double f0 = 20.0, f1 = 0.45 * sampleRate;
+    double duration = (double)frames / sampleRate;
+    double k = log(f1 / f0);
+    for (int c = 0; c < channels; c++) {
+        uint32_t state = 0x9e3779b9u * (uint32_t)(c + 1);
+        for (sf_count_t i = 0; i < frames; i++) {
+            float v = 0.0f;
+            if (signal == SIGNAL_SWEEP) {
+                double t = (double)i / sampleRate;
+                double phase = 2.0 * M_PI * f0 * duration / k * (exp(t / duration * k) - 1.0);
+                v = (float)(0.5 * sin(phase + c * 0.7));
+            } else if (signal == SIGNAL_NOISE) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                v = (float)(state / 4294967296.0 - 0.5);
+            }
+            planes[c][i] = v;
+        }
+    }
+}
+
+static int write_planes(const char *path, float *const *planes, int channels, sf_count_t frames, int sampleRate) {
+    wav_writer w;
+    if (wav_writer_open(&w, path, sampleRate, channels, frames, NULL) != 0) {
+        return -1;
+    }
+    int status = wav_writer_write(&w, (const float *const *)planes, frames);
+    if (wav_writer_close(&w) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+static int load_planes(const char *path, float *const *planes, sf_count_t frames) {
+    wav_reader r;
+    if (wav_reader_open(&r, path) != 0) {
+        return -1;
+    }
+    sf_count_t got = wav_reader_read(&r, planes, frames);
+    wav_reader_close(&r);
+    return got == frames ? 0 : -1;
+}
+
+// The channel filters alone: chunks of the planes pushed through one job per
+// channel, channels in parallel on the pool. Only the pushes are timed.
+static double filter_planes(float *const *planes, int channels, sf_count_t frames, int sampleRate,
+                            const filter_options *opts, thread_pool *pool) {
+    channel_job *jobs = (channel_job *)calloc(channels, sizeof(channel_job));
+    if (jobs == NULL) {
+        return -1.0;
+    }
+    int initialized = 0;
+    for (; initialized < channels; initialized++) {
+        if (channel_job_init(&jobs[initialized], opts, sampleRate) != 0) {
+            break;
+        }
+    }
+
+    double elapsed = -1.0;
+    if (initialized == channels) {
+        int status = 0;
+        double start = now_seconds();
+        // A last, empty round flushes the filters' tails
+        for (sf_count_t pos = 0;;) {
+            int count = (int)(frames - pos < STREAM_CHUNK_FRAMES ? frames - pos : STREAM_CHUNK_FRAMES);
+            for (int c = 0; c < channels; c++) {
+                memcpy(jobs[c].in, planes[c] + pos, sizeof(float) * count);
+                jobs[c].inCount = count;
+                jobs[c].flush = count == 0;
+                if (pool != NULL) {
+                    thread_pool_submit_job(pool, &jobs[c].node, run_channel_job, &jobs[c]);
+                } else {
+                    run_channel_job(&jobs[c]);
+                }
+            }
+            if (pool != NULL) {
+                thread_pool_wait(pool);
+            }
+            for (int c = 0; c < channels; c++) {
+                status |= jobs[c].status;
+            }
+            if (count == 0 || status != 0) {
+                break;
+            }
+            pos += count;
+        }
+        if (status == 0) {
+            elapsed = now_seconds() - start;
+        }
+    }
+
+    for (int c = 0; c < initialized; c++) {
+        channel_job_free(&jobs[c]);
+    }
+    free(jobs);
+    return elapsed;
+}
+
+// The command line's file mode: segments on the pool for several threads,
+// otherwise a stream with the channels in parallel
+static int filter_file(const char *inputFile, const char *outputFile, const filter_options *opts, int threads) {
+    wav_reader in;
+    if (wav_reader_open(&in, inputFile) != 0) {
+        return -1;
+    }
+    SF_INFO sfinfo = in.info;
+    wav_writer out;
+    if (wav_writer_open(&out, outputFile, sfinfo.samplerate, sfinfo.channels, sfinfo.frames, &in) != 0) {
+        wav_reader_close(&in);
+        return -1;
+    }
+
+    int segmented = threads > 1 && !opts->lowLatency && !opts->iir;
+    int workers = segmented || threads < sfinfo.channels ? threads : sfinfo.channels;
+    thread_pool *pool = workers > 1 ? thread_pool_create(workers) : NULL;
+    int status;
+    if (segmented && pool != NULL) {
+        status = segment_filter(inputFile, &sfinfo, &out, opts, pool);
+    } else {
+        status = stream_filter(&in, &out, opts, pool);
+    }
+    thread_pool_destroy(pool);
+
+    if (wav_writer_close(&out) != 0) {
+        status = -1;
+    }
+    wav_reader_close(&in);
+    return status;
+}
+
+static void print_result(const char *stage, bench_signal signal, int channels, int seconds, int frame, int hop,
+                         int threads, double elapsed, sf_count_t frames, int sampleRate) {
+    double samples = (double)frames * channels;
+    printf("%s,%s,%d,%d,%d,%d,%d,%s,%s,%.6f,%.0f,%.2f\n", stage, signal_names[signal], channels, seconds,
+           frame, hop, threads, FFT_BACKEND_NAME, dsp_kernels_get()->name, elapsed, samples / elapsed,
+           (double)frames / sampleRate / elapsed);
+    fflush(stdout);
+}
+
+// Best (shortest) time over the repeats; negative if any run failed
+#define BEST_OF(repeat, best, expr)                         \
+    do {                                                    \
+        best = -1.0;                                        \
+        for (int r_ = 0; r_ < (repeat); r_++) {             \
+            double t_ = (expr);                             \
+            if (t_ < 0.0) {                                 \
+                best = -1.0;                                \
+                break;                                      \
+            }                                               \
+            if (best < 0.0 || t_ < best) {                  \
+                best = t_;                                  \
+            }                                               \
+        }                                                   \
+    } while (0)
+
+static double timed_write(const char *path, float *const *planes, int channels, sf_count_t frames, int sampleRate) {
+    double start = now_seconds();
+    return write_planes(path, planes, channels, frames, sampleRate) == 0 ? now_seconds() - start : -1.0;
+}
+
+static double timed_load(const char *path, float *const *planes, sf_count_t frames) {
+    double start = now_seconds();
+    return load_planes(path, planes, frames) == 0 ? now_seconds() - start : -1.0;
+}
+
+static double timed_end_to_end(const char *inputFile, const char *outputFile, const filter_options *opts, int threads) {
+    double start = now_seconds();
+    return filter_file(inputFile, outputFile, opts, threads) == 0 ? now_seconds() - start : -1.0;
+}
+
+// Every stage for one signal, channel count and length
+static int bench_stream(const bench_config *cfg, bench_signal signal, int channels, int seconds,
+                        const char *inputFile, const char *outputFile) {
+    sf_count_t frames = (sf_count_t)seconds * cfg->sampleRate;
+    int rate = cfg->sampleRate;
+    float **planes = (float **)calloc(channels, sizeof(float *));
+    if (planes == NULL) {
+        return -1;
+    }
+    int status = 0;
+    for (int c = 0; c < channels && status == 0; c++) {
+        planes[c] = (float *)malloc(sizeof(float) * (size_t)frames);
+        status = planes[c] == NULL ? -1 : 0;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not allocate %d x %d s of samples\n", channels, seconds);
+        goto done;
+    }
+    synthesize(signal, planes, channels, frames, rate);
+
+    double best;
+    BEST_OF(cfg->repeat, best, timed_write(inputFile, planes, channels, frames, rate));
+    if (best < 0.0) {
+        status = -1;
+        goto done;
+    }
+    print_result("write", signal, channels, seconds, 0, 0, 1, best, frames, rate);
+
+    BEST_OF(cfg->repeat, best, timed_load(inputFile, planes, frames));
+    if (best < 0.0) {
+        status = -1;
+        goto done;
+    }
+    print_result("load", signal, channels, seconds, 0, 0, 1, best, frames, rate);
+
+    for (int f = 0; f < cfg->frames.count; f++) {
+        for (int h = 0; h < cfg->hopDivs.count; h++) {
+            filter_options opts = cfg->opts;
+            int frame = cfg->frames.values[f];
+            int hop = frame / cfg->hopDivs.values[h];
+            if (opts.iir) {
+                // The cascade has neither frame nor hop: one run per thread count
+                if (f > 0 || h > 0) {
+                    break;
+                }
+                frame = 0;
+                hop = 0;
+            } else if (opts.lowLatency) {
+                // The convolution has no hop: one block in, one block out
+                if (h > 0) {
+                    break;
+                }
+                opts.blockSize = frame;
+                hop = frame;
+            } else {
+                opts.stft.frameSize = frame;
+                opts.stft.hopSize = hop;
+                const char *problem = stft_config_check(&opts.stft);
+                if (problem != NULL) {
+                    fprintf(stderr, "Warning: Skipping frame %d hop %d: %s\n", frame, hop, problem);
+                    continue;
+                }
+            }
+            for (int t = 0; t < cfg->threads.count; t++) {
+                int threads = cfg->threads.values[t];
+                int workers = threads < channels ? threads : channels;
+                thread_pool *pool = workers > 1 ? thread_pool_create(workers) : NULL;
+                BEST_OF(cfg->repeat, best, filter_planes(planes, channels, frames, rate, &opts, pool));
+                thread_pool_destroy(pool);
+                if (best < 0.0) {
+                    status = -1;
+                    goto done;
+                }
+                print_result("filter", signal, channels, seconds, frame, hop, threads, best, frames, rate);
+
+                BEST_OF(cfg->repeat, best, timed_end_to_end(inputFile, outputFile, &opts, threads));
+                if (best < 0.0) {
+                    status = -1;
+                    goto done;
+                }
+                print_result("end_to_end", signal, channels, seconds, frame, hop, threads, best, frames, rate);
+            }
+        }
+    }
+
+done:
+    for (int c = 0; c < channels; c++) {
+        free(planes[c]);
+    }
+    free(planes);
+    return status;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --frames LIST         FFT frame sizes, or block sizes with --low-latency\n");
+    fprintf(stderr, "                        (default 256,1024,4096)\n");
+    fprintf(stderr, "  --hop-divs LIST       hops as frame/N (default 2,4)\n");
+    fprintf(stderr, "  --channels LIST       channel counts (default 1,2,8)\n");
+    fprintf(stderr, "  --seconds LIST        signal lengths in seconds (default 10)\n");
+    fprintf(stderr, "  --threads LIST        thread counts (default 1 and the core count)\n");
+    fprintf(stderr, "  --signals LIST        sweep, noise, silence (default all)\n");
+    fprintf(stderr, "  --rate HZ             sample rate (default 48000)\n");
+    fprintf(stderr, "  --repeat N            runs per measurement, best is kept (default 3)\n");
+    fprintf(stderr, "  --window NAME         analysis window (default hamming)\n");
+    fprintf(stderr, "  --eq FILE             EQ preset (default: highpass at 500 Hz)\n");
+    fprintf(stderr, "  --complex-fft         use the full complex FFT\n");
+    fprintf(stderr, "  --fixed-point         time the integer STFT filter\n");
+    fprintf(stderr, "  --low-latency         time the partitioned convolution instead of the STFT\n");
+    fprintf(stderr, "  --iir f32|f64         time the biquad cascade instead of the STFT\n");
+    fprintf(stderr, "  --kernels NAME        force the DSP kernel set\n");
+    fprintf(stderr, "  --io NAME             WAV file I/O: mmap (default), uring, threads\n");
+    fprintf(stderr, "  --dir DIR             directory for the temporary WAV files (default /tmp)\n");
+    fprintf(stderr, "Output: CSV on stdout, one line per stage and configuration.\n");
+}
+
+int main(int argc, char *argv[]) {
+    bench_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    parse_list("256,1024,4096", &cfg.frames);
+    parse_list("2,4", &cfg.hopDivs);
+    parse_list("1,2,8", &cfg.channels);
+    parse_list("10", &cfg.seconds);
+    cfg.threads.values[0] = 1;
+    cfg.threads.count = 1;
+    int cpus = thread_pool_cpu_count();
+    if (cpus > 1) {
+        cfg.threads.values[cfg.threads.count++] = cpus;
+    }
+    parse_signals("sweep,noise,silence", &cfg);
+    cfg.sampleRate = 48000;
+    cfg.repeat = 3;
+    cfg.dir = "/tmp";
+    filter_options_default(&cfg.opts);
+
+    for (int argi = 1; argi < argc; argi++) {
+        const char *opt = argv[argi];
+        if (strcmp(opt, "--complex-fft") == 0) {
+            cfg.opts.useComplexFft = 1;
+            continue;
+        }
+        if (strcmp(opt, "--fixed-point") == 0) {
+            cfg.opts.fixedPoint = 1;
+            continue;
+        }
+        if (strcmp(opt, "--low-latency") == 0) {
+            cfg.opts.lowLatency = 1;
+            continue;
+        }
+        if (argi + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++argi];
+        int bad = 0;
+        if (strcmp(opt, "--frames") == 0) {
+            bad = parse_list(value, &cfg.frames);
+        } else if (strcmp(opt, "--hop-divs") == 0) {
+            bad = parse_list(value, &cfg.hopDivs);
+        } else if (strcmp(opt, "--channels") == 0) {
+            bad = parse_list(value, &cfg.channels);
+        } else if (strcmp(opt, "--seconds") == 0) {
+            bad = parse_list(value, &cfg.seconds);
+        } else if (strcmp(opt, "--threads") == 0) {
+            bad = parse_list(value, &cfg.threads);
+        } else if (strcmp(opt, "--signals") == 0) {
+            bad = parse_signals(value, &cfg);
+        } else if (strcmp(opt, "--rate") == 0) {
+            cfg.sampleRate = atoi(value);
+            bad = cfg.sampleRate < 1;
+        } else if (strcmp(opt, "--repeat") == 0) {
+            cfg.repeat = atoi(value);
+            bad = cfg.repeat < 1;
+        } else if (strcmp(opt, "--window") == 0) {
+            bad = stft_parse_window(value, &cfg.opts.stft.analysisWindow);
+        } else if (strcmp(opt, "--eq") == 0) {
+            if (eq_load_preset(value, &cfg.opts.eq) != 0) {
+                return 1;
+            }
+        } else if (strcmp(opt, "--kernels") == 0) {
+            bad = dsp_kernels_select(value);
+        } else if (strcmp(opt, "--iir") == 0) {
+            cfg.opts.iir = strcmp(value, "f32") == 0 ? 32 : strcmp(value, "f64") == 0 ? 64 : 0;
+            bad = cfg.opts.iir == 0;
+        } else if (strcmp(opt, "--io") == 0) {
+            bad = wav_io_select(value);
+        } else if (strcmp(opt, "--dir") == 0) {
+            cfg.dir = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        if (bad) {
+            fprintf(stderr, "Error: Invalid value for %s: '%s'\n", opt, value);
+            return 1;
+        }
+    }
+
+    char inputFile[4096], outputFile[4096];
+    snprintf(inputFile, sizeof(inputFile), "%s/wav_bench_%d_in.wav", cfg.dir, (int)getpid());
+    snprintf(outputFile, sizeof(outputFile), "%s/wav_bench_%d_out.wav", cfg.dir, (int)getpid());
+
+    printf("stage,signal,channels,seconds,frame,hop,threads,fft,kernels,wall_s,samples_per_s,realtime\n");
+    int status = 0;
+    for (int s = 0; s < cfg.numSignals && status == 0; s++) {
+        for (int c = 0; c < cfg.channels.count && status == 0; c++) {
+            for (int l = 0; l < cfg.seconds.count && status == 0; l++) {
+                status = bench_stream(&cfg, (bench_signal)cfg.signals[s], cfg.channels.values[c],
+                                      cfg.seconds.values[l], inputFile, outputFile);
+            }
+        }
+    }
+    unlink(inputFile);
+    unlink(outputFile);
+    if (status != 0) {
+        fprintf(stderr, "Error: Benchmark run failed\n");
+    }
+    return status == 0 ? 0 : 1;
+}
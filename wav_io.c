@@ -0,0 +1,803 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wav_io.h"
+#include "async_io.h"
+#include "dsp_kernels.h"
+#include "stats.h"
+
+#define WAV_HEADER_BYTES 44          // canonical RIFF + fmt + data header we write
+#define WAV_MAX_DATA_BYTES (UINT32_MAX - 36)  // the RIFF size field holds 36 + data bytes
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define WAV_MIN_WRITE_FRAMES 65536   // preallocation when the length is unknown
+#define WAV_PROBE_BYTES 65536        // read to find the data chunk without mapping
+#define WAV_ASYNC_BUFFERS 2          // one being converted while the other is in flight
+#define WAV_ASYNC_CHUNK_BYTES (1 << 20)
+#define WAV_ASYNC_ALIGN 4096
+
+typedef enum {
+    WAV_IO_MMAP,
+    WAV_IO_URING,
+    WAV_IO_THREADS
+} wav_io_mode;
+
+static wav_io_mode ioMode = WAV_IO_MMAP;
+
+// One chunk of the file. A reader's buffer holds frames [first, first +
+// frames) once its read is waited for; a writer's is filled up to frames
+// and then written out while the next buffer fills.
+typedef struct {
+    unsigned char *bytes;
+    async_io_req req;
+    sf_count_t first;
+    sf_count_t frames;
+    int pending;            // submitted and not waited for yet
+} wav_async_buffer;
+
+struct wav_async {
+    async_io *io;
+    int fd;
+    int output;
+    off_t base;             // file offset of frame 0
+    size_t frameBytes;
+    sf_count_t chunkFrames;
+    sf_count_t next;        // reader: first frame of the next chunk to request; writer: frames submitted
+    int current;            // buffer being converted
+    int failed;
+    float **inPlanes;       // the caller's planes advanced past the frames done
+    const float **outPlanes;
+    wav_async_buffer buf[WAV_ASYNC_BUFFERS];
+};
+
+static uint16_t get_le16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+// Mapped samples are read and written in place, so the host must share the
+// file's little-endian layout
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const unsigned char *)&probe == 1;
+}
+
+// Walk the RIFF chunks in the first size bytes of a file of fileSize bytes.
+// Returns 0 and fills the layout and *dataOffset if it is PCM16 or 32-bit
+// float; -1 means leave the file to libsndfile.
+static int parse_wav_header(wav_reader *r, const unsigned char *p, size_t size, size_t fileSize, size_t *dataOffset) {
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) {
+        return -1;
+    }
+
+    int haveFmt = 0;
+    int formatTag = 0, channels = 0, bits = 0, blockAlign = 0;
+    uint32_t sampleRate = 0;
+    size_t off = 12;
+    while (off + 8 <= size) {
+        const unsigned char *chunk = p + off;
+        size_t chunkSize = get_le32(chunk + 4);
+        size_t body = off + 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + chunkSize > size) {
+                return -1;
+            }
+            formatTag = get_le16(p + body);
+            channels = get_le16(p + body + 2);
+            sampleRate = get_le32(p + body + 4);
+            blockAlign = get_le16(p + body + 12);
+            bits = get_le16(p + body + 14);
+            if (formatTag == WAV_FORMAT_EXTENSIBLE) {
+                // The real format is the first two bytes of the subformat GUID
+                if (chunkSize < 40) {
+                    return -1;
+                }
+                formatTag = get_le16(p + body + 24);
+            }
+            haveFmt = 1;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFmt) {
+                return -1;
+            }
+            // Streamed writers leave the size at 0 or ~0; trust the file length then
+            if (chunkSize == 0 || body + chunkSize > fileSize) {
+                chunkSize = fileSize - body;
+            }
+
+            if (formatTag == WAV_FORMAT_PCM && bits == 16) {
+                r->sampleFormat = SF_FORMAT_PCM_16;
+            } else if (formatTag == WAV_FORMAT_FLOAT && bits == 32) {
+                r->sampleFormat = SF_FORMAT_FLOAT;
+            } else {
+                return -1;
+            }
+            if (channels < 1 || sampleRate < 1 || blockAlign != channels * (bits / 8)) {
+                return -1;
+            }
+
+            *dataOffset = body;
+            memset(&r->info, 0, sizeof(r->info));
+            r->info.frames = (sf_count_t)(chunkSize / blockAlign);
+            r->info.samplerate = (int)sampleRate;
+            r->info.channels = channels;
+            r->info.format = SF_FORMAT_WAV | r->sampleFormat;
+            r->info.sections = 1;
+            r->info.seekable = 1;
+            return 0;
+        }
+        off = body + chunkSize + (chunkSize & 1);  // chunks are word aligned
+    }
+    return -1;
+}
+
+static int ensure_scratch(float **scratch, sf_count_t *scratchFrames, sf_count_t frames, int channels) {
+    if (frames <= *scratchFrames) {
+        return 0;
+    }
+    float *grown = (float *)realloc(*scratch, sizeof(float) * frames * channels);
+    if (grown == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
+        return -1;
+    }
+    stats_memory((long long)(sizeof(float) * (frames - *scratchFrames) * channels));
+    *scratch = grown;
+    *scratchFrames = frames;
+    return 0;
+}
+
+int wav_io_select(const char *name) {
+    if (strcmp(name, "mmap") == 0) {
+        ioMode = WAV_IO_MMAP;
+    } else if (strcmp(name, "uring") == 0) {
+        ioMode = WAV_IO_URING;
+        if (!async_io_uring_supported()) {
+            fprintf(stderr, "Warning: io_uring is not available here; using I/O threads\n");
+            ioMode = WAV_IO_THREADS;
+        }
+    } else if (strcmp(name, "threads") == 0) {
+        ioMode = WAV_IO_THREADS;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static void async_free(wav_async *a) {
+    async_io_destroy(a->io);  // first: it waits for anything still in flight
+    for (int i = 0; i < WAV_ASYNC_BUFFERS; i++) {
+        free(a->buf[i].bytes);
+    }
+    stats_memory(-(long long)(a->chunkFrames * a->frameBytes * WAV_ASYNC_BUFFERS));
+    free(a->inPlanes);
+    free(a->outPlanes);
+    free(a);
+}
+
+// Finish every transfer in flight, then free the buffers and close the file
+static int async_close(wav_async *a) {
+    int status = a->failed ? -1 : 0;
+    for (int i = 0; i < WAV_ASYNC_BUFFERS; i++) {
+        wav_async_buffer *b = &a->buf[i];
+        if (b->pending && async_io_wait(a->io, &b->req) != (ssize_t)b->req.len) {
+            status = -1;
+        }
+        b->pending = 0;
+    }
+    if (close(a->fd) != 0) {
+        status = -1;
+    }
+    async_free(a);
+    return status;
+}
+
+// Buffers and a transfer queue for fd, whose frame 0 is at offset base.
+// On failure fd is left open.
+static wav_async *async_open(int fd, off_t base, int channels, size_t sampleBytes, int output) {
+    wav_async *a = (wav_async *)calloc(1, sizeof(wav_async));
+    if (a == NULL) {
+        return NULL;
+    }
+    a->io = async_io_create(ioMode == WAV_IO_URING ? ASYNC_IO_URING : ASYNC_IO_THREADS);
+    if (a->io == NULL && ioMode == WAV_IO_URING) {
+        a->io = async_io_create(ASYNC_IO_THREADS);  // e.g. out of locked memory for another ring
+    }
+    a->fd = fd;
+    a->output = output;
+    a->base = base;
+    a->frameBytes = (size_t)channels * sampleBytes;
+    a->chunkFrames = WAV_ASYNC_CHUNK_BYTES / a->frameBytes > 0 ? WAV_ASYNC_CHUNK_BYTES / a->frameBytes : 1;
+    a->inPlanes = (float **)malloc(sizeof(float *) * channels);
+    a->outPlanes = (const float **)malloc(sizeof(float *) * channels);
+    int ok = a->io != NULL && a->inPlanes != NULL && a->outPlanes != NULL;
+    for (int i = 0; ok && i < WAV_ASYNC_BUFFERS; i++) {
+        void *bytes = NULL;
+        ok = posix_memalign(&bytes, WAV_ASYNC_ALIGN, (size_t)a->chunkFrames * a->frameBytes) == 0;
+        a->buf[i].bytes = (unsigned char *)bytes;
+    }
+    stats_memory((long long)(a->chunkFrames * a->frameBytes * WAV_ASYNC_BUFFERS));
+    if (!ok) {
+        async_free(a);
+        return NULL;
+    }
+    return a;
+}
+
+// Finish b's transfer, if one is in flight
+static int async_ready(wav_async *a, wav_async_buffer *b) {
+    if (b->pending) {
+        b->pending = 0;
+        ssize_t moved = async_io_wait(a->io, &b->req);
+        if (moved != (ssize_t)b->req.len && !a->failed) {
+            fprintf(stderr, "Error: Could not %s\n", a->output ? "write the output file" : "read the input file");
+            a->failed = 1;
+        }
+    }
+    return a->failed ? -1 : 0;
+}
+
+static int async_submit(wav_async *a, wav_async_buffer *b, sf_count_t first, sf_count_t frames) {
+    b->req.fd = a->fd;
+    b->req.buf = b->bytes;
+    b->req.len = (size_t)frames * a->frameBytes;
+    b->req.offset = a->base + (off_t)first * (off_t)a->frameBytes;
+    b->req.write = a->output;
+    if (async_io_submit(a->io, &b->req) != 0) {
+        fprintf(stderr, "Error: Could not queue file I/O\n");
+        a->failed = 1;
+        return -1;
+    }
+    b->pending = 1;
+    return 0;
+}
+
+// Start reading the chunk at frame first into b; nothing past the end
+static int async_request(wav_reader *r, wav_async_buffer *b, sf_count_t first) {
+    wav_async *a = r->async;
+    sf_count_t left = r->info.frames - first;
+    b->first = first;
+    b->frames = left < a->chunkFrames ? (left > 0 ? left : 0) : a->chunkFrames;
+    return b->frames > 0 ? async_submit(a, b, first, b->frames) : 0;
+}
+
+// Drop what is buffered and read ahead from frame on
+static int async_restart(wav_reader *r, sf_count_t frame) {
+    wav_async *a = r->async;
+    for (int i = 0; i < WAV_ASYNC_BUFFERS; i++) {
+        if (async_ready(a, &a->buf[i]) != 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < WAV_ASYNC_BUFFERS; i++) {
+        if (async_request(r, &a->buf[i], frame + i * a->chunkFrames) != 0) {
+            return -1;
+        }
+    }
+    a->current = 0;
+    a->next = frame + WAV_ASYNC_BUFFERS * a->chunkFrames;
+    r->pos = frame;
+    return 0;
+}
+
+// The data chunk is found in the first bytes of the file, read with pread
+// rather than through a mapping; fd stays open either way
+static int open_async_reader(wav_reader *r, int fd, size_t fileSize) {
+    size_t probeSize = fileSize < WAV_PROBE_BYTES ? fileSize : WAV_PROBE_BYTES;
+    unsigned char *probe = (unsigned char *)malloc(probeSize);
+    if (probe == NULL) {
+        return -1;
+    }
+    size_t got = 0;
+    ssize_t n;
+    while (got < probeSize && (n = pread(fd, probe + got, probeSize - got, (off_t)got)) > 0) {
+        got += (size_t)n;
+    }
+    size_t dataOffset;
+    int status = parse_wav_header(r, probe, got, fileSize, &dataOffset);
+    free(probe);
+    if (status != 0) {
+        return -1;
+    }
+
+    size_t sampleBytes = r->sampleFormat == SF_FORMAT_PCM_16 ? sizeof(int16_t) : sizeof(float);
+    r->async = async_open(fd, (off_t)dataOffset, r->info.channels, sampleBytes, 0);
+    if (r->async == NULL) {
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (async_restart(r, 0) != 0) {
+        async_close(r->async);
+        r->async = NULL;
+        return -2;  // fd is closed
+    }
+    return 0;
+}
+
+int wav_reader_open(wav_reader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+
+    int fd = host_is_little_endian() ? open(path, O_RDONLY) : -1;
+    struct stat st;
+    if (fd >= 0 ? fstat(fd, &st) == 0 : stat(path, &st) == 0) {
+        r->dev = st.st_dev;
+        r->ino = st.st_ino;
+    }
+    if (fd >= 0 && r->ino != 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        if (ioMode != WAV_IO_MMAP) {
+            int status = open_async_reader(r, fd, (size_t)st.st_size);
+            if (status != -1) {
+                return status == 0 ? 0 : -1;
+            }
+            memset(r, 0, sizeof(*r));
+            r->dev = st.st_dev;
+            r->ino = st.st_ino;
+        }
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            r->map = (unsigned char *)map;
+            r->mapSize = (size_t)st.st_size;
+            size_t dataOffset;
+            if (parse_wav_header(r, r->map, r->mapSize, r->mapSize, &dataOffset) == 0) {
+                r->data = r->map + dataOffset;
+                madvise(r->map, r->mapSize, MADV_SEQUENTIAL);
+                close(fd);
+                return 0;
+            }
+            munmap(r->map, r->mapSize);
+            r->map = NULL;
+            r->mapSize = 0;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // Not a plain PCM16/float WAV (or not a regular file): let libsndfile decode it
+    r->sf = sf_open(path, SFM_READ, &r->info);
+    if (r->sf == NULL) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", path);
+        fprintf(stderr, "%s\n", sf_strerror(NULL));
+        return -1;
+    }
+    return 0;
+}
+
+void wav_reader_close(wav_reader *r) {
+    if (r->async != NULL) {
+        async_close(r->async);
+    }
+    if (r->map != NULL) {
+        munmap(r->map, r->mapSize);
+    }
+    if (r->sf != NULL) {
+        sf_close(r->sf);
+    }
+    stats_memory(-(long long)(sizeof(float) * r->scratchFrames * r->info.channels));
+    free(r->scratch);
+    memset(r, 0, sizeof(*r));
+}
+
+int wav_reader_seek(wav_reader *r, sf_count_t frame) {
+    if (r->sf != NULL) {
+        return sf_seek(r->sf, frame, SEEK_SET) < 0 ? -1 : 0;
+    }
+    if (frame < 0 || frame > r->info.frames) {
+        return -1;
+    }
+    if (r->async != NULL) {
+        // A seek inside the chunk at hand (a segment's history) keeps the read-ahead
+        wav_async_buffer *b = &r->async->buf[r->async->current];
+        if (b->pending || frame < b->first || frame >= b->first + b->frames) {
+            return async_restart(r, frame);
+        }
+    }
+    r->pos = frame;
+    return 0;
+}
+
+// Bytes per sample of the source, for the stats report
+static int source_sample_bytes(const wav_reader *r) {
+    switch (r->sf != NULL ? r->info.format & SF_FORMAT_SUBMASK : r->sampleFormat) {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+        return 1;
+    case SF_FORMAT_PCM_24:
+        return 3;
+    case SF_FORMAT_PCM_32:
+    case SF_FORMAT_FLOAT:
+        return 4;
+    case SF_FORMAT_DOUBLE:
+        return 8;
+    default:
+        return 2;
+    }
+}
+
+// Convert from the chunk at hand; each drained buffer is sent for the chunk
+// after the ones already in flight
+static sf_count_t read_async(wav_reader *r, float *const *planes, sf_count_t frames) {
+    wav_async *a = r->async;
+    int channels = r->info.channels;
+    if (frames > r->info.frames - r->pos) {
+        frames = r->info.frames - r->pos;
+    }
+    sf_count_t done = 0;
+    while (done < frames) {
+        wav_async_buffer *b = &a->buf[a->current];
+        if (async_ready(a, b) != 0) {
+            return -1;
+        }
+        sf_count_t at = r->pos - b->first;
+        if (at >= b->frames) {
+            if (async_request(r, b, a->next) != 0) {
+                return -1;
+            }
+            a->next += a->chunkFrames;
+            a->current = (a->current + 1) % WAV_ASYNC_BUFFERS;
+            continue;
+        }
+
+        sf_count_t n = b->frames - at < frames - done ? b->frames - at : frames - done;
+        for (int c = 0; c < channels; c++) {
+            a->inPlanes[c] = planes[c] + done;
+        }
+        const void *src = b->bytes + (size_t)at * a->frameBytes;
+        if (r->sampleFormat == SF_FORMAT_PCM_16) {
+            dsp_kernels_get()->deinterleave_s16((const int16_t *)src, channels, a->inPlanes, (int)n);
+        } else {
+            dsp_kernels_get()->deinterleave((const float *)src, channels, a->inPlanes, (int)n);
+        }
+        r->pos += n;
+        done += n;
+    }
+    return done;
+}
+
+static sf_count_t read_planes(wav_reader *r, float *const *planes, sf_count_t frames) {
+    int channels = r->info.channels;
+
+    if (r->async != NULL) {
+        return read_async(r, planes, frames);
+    }
+
+    if (r->sf != NULL) {
+        if (ensure_scratch(&r->scratch, &r->scratchFrames, frames, channels) != 0) {
+            return -1;
+        }
+        sf_count_t got = sf_readf_float(r->sf, r->scratch, frames);
+        if (got > 0) {
+            dsp_kernels_get()->deinterleave(r->scratch, channels, planes, (int)got);
+        }
+        return got;
+    }
+
+    if (frames > r->info.frames - r->pos) {
+        frames = r->info.frames - r->pos;
+    }
+    if (r->sampleFormat == SF_FORMAT_PCM_16) {
+        const int16_t *src = (const int16_t *)(const void *)r->data + r->pos * channels;
+        dsp_kernels_get()->deinterleave_s16(src, channels, planes, (int)frames);
+    } else if (((uintptr_t)r->data & (sizeof(float) - 1)) == 0) {
+        const float *src = (const float *)(const void *)r->data + r->pos * channels;
+        dsp_kernels_get()->deinterleave(src, channels, planes, (int)frames);
+    } else {
+        // A data chunk at an odd word offset: floats must be copied out bytewise
+        const unsigned char *src = r->data + (size_t)r->pos * channels * sizeof(float);
+        for (int c = 0; c < channels; c++) {
+            float *dst = planes[c];
+            for (sf_count_t i = 0; i < frames; i++) {
+                memcpy(&dst[i], src + ((size_t)i * channels + c) * sizeof(float), sizeof(float));
+            }
+        }
+    }
+    r->pos += frames;
+    return frames;
+}
+
+sf_count_t wav_reader_read(wav_reader *r, float *const *planes, sf_count_t frames) {
+    uint64_t t = stats_begin();
+    sf_count_t got = read_planes(r, planes, frames);
+    if (got > 0) {
+        stats_lap(STATS_READ, t);
+        stats_count(STATS_BYTES_READ, (uint64_t)got * r->info.channels * source_sample_bytes(r));
+    }
+    return got;
+}
+
+// Whether frames PCM16 frames still fit the 32-bit sizes of the header
+static int wav_size_fits(sf_count_t frames, int channels) {
+    return frames <= (sf_count_t)(WAV_MAX_DATA_BYTES / ((uint32_t)channels * 2));
+}
+
+static void write_wav_header(unsigned char *h, int sampleRate, int channels, sf_count_t frames) {
+    uint32_t dataBytes = (uint32_t)(frames * channels * 2);
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, 36 + dataBytes);
+    memcpy(h + 8, "WAVE", 4);
+    memcpy(h + 12, "fmt ", 4);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, WAV_FORMAT_PCM);
+    put_le16(h + 22, (uint16_t)channels);
+    put_le32(h + 24, (uint32_t)sampleRate);
+    put_le32(h + 28, (uint32_t)(sampleRate * channels * 2));
+    put_le16(h + 32, (uint16_t)(channels * 2));
+    put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, dataBytes);
+}
+
+// Extend the output file and its mapping to hold at least frames frames.
+// The blocks are allocated for real, not left sparse: a full disk then fails
+// here, with errno set, instead of raising SIGBUS on a store to the mapping.
+static int wav_writer_reserve(wav_writer *w, sf_count_t frames) {
+    if (frames <= w->capacity) {
+        return 0;
+    }
+    sf_count_t capacity = w->capacity > 0 ? w->capacity : WAV_MIN_WRITE_FRAMES;
+    while (capacity < frames) {
+        capacity *= 2;
+    }
+    size_t size = WAV_HEADER_BYTES + (size_t)capacity * w->channels * 2;
+    int err = posix_fallocate(w->fd, 0, (off_t)size);
+    if (err == ENOSPC && capacity > frames) {
+        // The doubled size may not fit where the frames asked for still do
+        capacity = frames;
+        size = WAV_HEADER_BYTES + (size_t)capacity * w->channels * 2;
+        err = posix_fallocate(w->fd, 0, (off_t)size);
+    }
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+
+    if (w->map != NULL) {
+        munmap(w->map, w->mapSize);
+        w->map = NULL;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    w->map = (unsigned char *)map;
+    w->mapSize = size;
+    w->capacity = capacity;
+    return 0;
+}
+
+int wav_writer_open(wav_writer *w, const char *path, int sampleRate, int channels, sf_count_t expectedFrames,
+                    const wav_reader *source) {
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    w->channels = channels;
+    w->sampleRate = sampleRate;
+
+    if (expectedFrames > 0 && !wav_size_fits(expectedFrames, channels)) {
+        fprintf(stderr, "Error: Output file '%s' would exceed the 4 GiB size limit of a WAV file\n", path);
+        return -1;
+    }
+    struct stat existing;
+    if (source != NULL && source->ino != 0 && stat(path, &existing) == 0 && existing.st_dev == source->dev
+        && existing.st_ino == source->ino) {
+        fprintf(stderr, "Error: Output file '%s' is the input file; it would be overwritten as it is read\n", path);
+        return -1;
+    }
+
+    if (host_is_little_endian()) {
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ftruncate(fd, 0) == 0) {
+            if (ioMode != WAV_IO_MMAP) {
+                // The header goes in front of the samples on close
+                w->async = async_open(fd, WAV_HEADER_BYTES, channels, sizeof(int16_t), 1);
+                if (w->async != NULL) {
+                    w->fd = fd;
+                    return 0;
+                }
+            }
+            w->fd = fd;
+            if (wav_writer_reserve(w, expectedFrames > 0 ? expectedFrames : 1) == 0) {
+                return 0;
+            }
+            int noSpace = errno == ENOSPC || errno == EDQUOT || errno == EFBIG;
+            if (noSpace) {
+                fprintf(stderr, "Error: Could not reserve space for output file '%s': %s\n", path, strerror(errno));
+                close(fd);
+                w->fd = -1;
+                return -1;
+            }
+            if (w->map != NULL) {
+                munmap(w->map, w->mapSize);
+                w->map = NULL;
+            }
+            w->capacity = 0;
+            // No real preallocation here (EOPNOTSUPP) or no mapping: write
+            // through buffers with pwrite, which reports a full disk as an error
+            w->async = async_open(fd, WAV_HEADER_BYTES, channels, sizeof(int16_t), 1);
+            if (w->async != NULL) {
+                return 0;
+            }
+            w->fd = -1;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    SF_INFO sfinfo = {0};
+    sfinfo.samplerate = sampleRate;
+    sfinfo.channels = channels;
+    sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+
+    w->sf = sf_open(path, SFM_WRITE, &sfinfo);
+    if (w->sf == NULL) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", path);
+        fprintf(stderr, "%s\n", sf_strerror(NULL));
+        return -1;
+    }
+    return 0;
+}
+
+// Send the filled part of the buffer at hand and move to the next one
+static int async_flush(wav_async *a) {
+    wav_async_buffer *b = &a->buf[a->current];
+    if (b->frames == 0) {
+        return 0;
+    }
+    if (async_submit(a, b, a->next, b->frames) != 0) {
+        return -1;
+    }
+    a->next += b->frames;
+    b->frames = 0;
+    a->current = (a->current + 1) % WAV_ASYNC_BUFFERS;
+    return 0;
+}
+
+// Convert into the buffer at hand; a full one is written while the next fills
+static int write_async(wav_writer *w, const float *const *planes, sf_count_t frames) {
+    wav_async *a = w->async;
+    int channels = w->channels;
+    sf_count_t done = 0;
+    while (done < frames) {
+        wav_async_buffer *b = &a->buf[a->current];
+        if (async_ready(a, b) != 0) {
+            return -1;
+        }
+        sf_count_t space = a->chunkFrames - b->frames;
+        sf_count_t n = space < frames - done ? space : frames - done;
+        for (int c = 0; c < channels; c++) {
+            a->outPlanes[c] = planes[c] + done;
+        }
+        int16_t *dst = (int16_t *)(void *)(b->bytes + (size_t)b->frames * a->frameBytes);
+        dsp_kernels_get()->interleave_s16(a->outPlanes, channels, dst, (int)n);
+        b->frames += n;
+        done += n;
+        if (b->frames == a->chunkFrames && async_flush(a) != 0) {
+            return -1;
+        }
+    }
+    w->written += frames;
+    return 0;
+}
+
+static int write_planes(wav_writer *w, const float *const *planes, sf_count_t frames) {
+    int channels = w->channels;
+
+    if (w->async != NULL) {
+        return write_async(w, planes, frames);
+    }
+
+    if (w->sf != NULL) {
+        if (ensure_scratch(&w->scratch, &w->scratchFrames, frames, channels) != 0) {
+            return -1;
+        }
+        dsp_kernels_get()->interleave(planes, channels, w->scratch, (int)frames);
+        sf_count_t written = sf_writef_float(w->sf, w->scratch, frames);
+        if (written != frames) {
+            fprintf(stderr, "Error: Could not write all samples to file (wrote %lld out of %lld frames)\n",
+                    (long long)written, (long long)frames);
+            return -1;
+        }
+        w->written += written;
+        return 0;
+    }
+
+    if (wav_writer_reserve(w, w->written + frames) != 0) {
+        fprintf(stderr, "Error: Could not extend the output file: %s\n", strerror(errno));
+        return -1;
+    }
+    int16_t *dst = (int16_t *)(void *)(w->map + WAV_HEADER_BYTES) + w->written * channels;
+    dsp_kernels_get()->interleave_s16(planes, channels, dst, (int)frames);
+    w->written += frames;
+    return 0;
+}
+
+// Samples that PCM16 conversion, clip(rint(x * 32767)), will clip
+static uint64_t count_clipped(const float *const *planes, int channels, sf_count_t frames) {
+    uint64_t clipped = 0;
+    for (int c = 0; c < channels; c++) {
+        for (sf_count_t i = 0; i < frames; i++) {
+            double d = planes[c][i] * 32767.0;
+            clipped += d >= 32767.5 || d < -32768.5;
+        }
+    }
+    return clipped;
+}
+
+int wav_writer_write(wav_writer *w, const float *const *planes, sf_count_t frames) {
+    if (!wav_size_fits(w->written + frames, w->channels)) {
+        fprintf(stderr, "Error: The output would exceed the 4 GiB size limit of a WAV file\n");
+        return -1;
+    }
+    uint64_t t = stats_begin();
+    if (write_planes(w, planes, frames) != 0) {
+        return -1;
+    }
+    if (stats_enabled) {
+        stats_lap(STATS_WRITE, t);
+        stats_add(STATS_BYTES_WRITTEN, (uint64_t)frames * w->channels * sizeof(int16_t));
+        stats_add(STATS_CLIPPED, count_clipped(planes, w->channels, frames));
+    }
+    return 0;
+}
+
+int wav_writer_close(wav_writer *w) {
+    int status = 0;
+    if (w->sf != NULL) {
+        sf_close(w->sf);
+    } else if (w->async != NULL) {
+        // Write out the last partial chunk, then the header with the final sizes
+        unsigned char header[WAV_HEADER_BYTES];
+        write_wav_header(header, w->sampleRate, w->channels, w->written);
+        if (async_flush(w->async) != 0 || pwrite(w->fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            status = -1;
+        }
+        if (async_close(w->async) != 0) {
+            status = -1;
+        }
+        if (status != 0) {
+            fprintf(stderr, "Error: Could not finalize the output file\n");
+        }
+    } else if (w->fd >= 0) {
+        // Fill in the final sizes and drop the unused preallocation
+        if (w->map != NULL) {
+            write_wav_header(w->map, w->sampleRate, w->channels, w->written);
+            munmap(w->map, w->mapSize);
+        } else {
+            status = -1;  // a failed extension already lost the mapping
+        }
+        if (ftruncate(w->fd, (off_t)(WAV_HEADER_BYTES + (size_t)w->written * w->channels * 2)) != 0) {
+            fprintf(stderr, "Error: Could not finalize the output file\n");
+            status = -1;
+        }
+        if (close(w->fd) != 0) {
+            status = -1;
+        }
+    }
+    stats_memory(-(long long)(sizeof(float) * w->scratchFrames * w->channels));
+    free(w->scratch);
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    return status;
+}
@@ -0,0 +1,88 @@
+#ifndef WAV_IO_H
+#define WAV_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sndfile.h>
+
+// Double-buffered file transfers of the uring and threads modes (wav_io.c)
+typedef struct wav_async wav_async;
+
+// How plain WAV files are moved, for every reader and writer opened after
+// the call (pick one before any thread starts):
+//   "mmap"     map the file and convert samples in place (the default)
+//   "uring"    read and write through io_uring, into a fixed set of aligned
+//              buffers: the next chunk of input is read and the previous
+//              chunk of output written while the current one is filtered.
+//              Falls back to "threads", with a warning, where the kernel
+//              does not allow io_uring.
+//   "threads"  the same with pread/pwrite on a small thread pool
+// Suits network and spinning-disk volumes, where a page fault of the
+// mapping stalls the filter for a whole device round trip. Returns -1 if
+// the name is unknown.
+int wav_io_select(const char *name);
+
+// Planar WAV input. Plain RIFF/WAVE PCM16 and 32-bit float files are
+// memory-mapped: the header is parsed here and samples are converted from
+// the mapped data chunk straight into the caller's per-channel buffers, with
+// no intermediate copy. Anything else goes through libsndfile.
+typedef struct {
+    SF_INFO info;                // stream layout, as libsndfile reports it
+    SNDFILE *sf;                 // libsndfile fallback; NULL when mapped
+    wav_async *async;            // read ahead instead of mapped (wav_io_select)
+    unsigned char *map;          // whole file
+    size_t mapSize;
+    const unsigned char *data;   // first frame of the data chunk
+    int sampleFormat;            // SF_FORMAT_PCM_16 or SF_FORMAT_FLOAT when mapped
+    sf_count_t pos;              // next frame to read
+    float *scratch;              // interleaved buffer for the libsndfile path
+    sf_count_t scratchFrames;
+    dev_t dev;                   // the input file, so that a writer can refuse
+    ino_t ino;                   // to overwrite it; ino 0 if unknown
+} wav_reader;
+
+// Returns 0 on success, -1 with a message on stderr otherwise
+int wav_reader_open(wav_reader *r, const char *path);
+void wav_reader_close(wav_reader *r);
+
+int wav_reader_seek(wav_reader *r, sf_count_t frame);
+
+// Read up to frames frames; channel c goes to planes[c]. Returns the frames
+// read, 0 at the end of the data, -1 on error.
+sf_count_t wav_reader_read(wav_reader *r, float *const *planes, sf_count_t frames);
+
+// Planar PCM16 WAV output. Regular files are preallocated (posix_fallocate,
+// so a full disk is an error rather than SIGBUS) and mapped, and samples are
+// converted straight into the mapping; the header is finalized and the file
+// trimmed on close. Where blocks cannot be preallocated the samples are
+// written with pwrite instead. Outputs that cannot be mapped (pipes,
+// devices) go through libsndfile.
+typedef struct {
+    SNDFILE *sf;                 // libsndfile fallback; NULL when mapped
+    wav_async *async;            // written behind instead of mapped (wav_io_select)
+    int fd;
+    unsigned char *map;
+    size_t mapSize;
+    sf_count_t capacity;         // frames the current mapping holds
+    sf_count_t written;
+    int channels;
+    int sampleRate;
+    float *scratch;              // interleaved buffer for the libsndfile path
+    sf_count_t scratchFrames;
+} wav_writer;
+
+// expectedFrames sizes the initial preallocation; <= 0 if unknown. The
+// output is truncated as it opens, so if it is the same file as source (the
+// reader it is made from, or NULL) it is refused before anything is touched.
+int wav_writer_open(wav_writer *w, const char *path, int sampleRate, int channels, sf_count_t expectedFrames,
+                    const wav_reader *source);
+
+// Returns -1 if any sample could not be written
+int wav_writer_close(wav_writer *w);
+
+// Append frames frames, channel c taken from planes[c]; returns 0 or -1.
+// A file whose data would pass the 4 GiB limit of the RIFF sizes is refused
+// here (and at open, when expectedFrames already passes it).
+int wav_writer_write(wav_writer *w, const float *const *planes, sf_count_t frames);
+
+#endif
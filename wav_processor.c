@@ -1,192 +1,342 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sndfile.h>
-#include "kissfft/kiss_fft.h"
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "wav_processor.h"
+#include "stats.h"
+#include "spectrum_cache.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <input_file.wav> <output_file.wav>\n", prog);
+    fprintf(stderr, "       %s --batch [options] <input_dir|file_list> <output_dir>\n", prog);
+    fprintf(stderr, "       %s --pipe --rate HZ --channels N [options] [input|-] [output|-]\n", prog);
+    fprintf(stderr, "  --frame N             FFT frame size, even (default 1024)\n");
+    fprintf(stderr, "  --hop N               hop between frames (default frame/2)\n");
+    fprintf(stderr, "  --window NAME         analysis window (default hamming)\n");
+    fprintf(stderr, "  --synthesis-window NAME  synthesis window (default rect)\n");
+    fprintf(stderr, "                        windows: rect, hann, hamming, blackman-harris, sqrt-hann\n");
+    fprintf(stderr, "  --eq FILE             EQ preset, one band per line (default: highpass at 500 Hz)\n");
+    fprintf(stderr, "  --threads N           split the file into segments filtered on N threads\n");
+    fprintf(stderr, "                        (default: one thread per channel, up to the core count)\n");
+    fprintf(stderr, "  --low-latency         partitioned convolution with one block of latency\n");
+    fprintf(stderr, "                        instead of the STFT filter\n");
+    fprintf(stderr, "  --block N             low-latency block size, even (default 128)\n");
+    fprintf(stderr, "  --taps N              low-latency FIR length (default 8192)\n");
+    fprintf(stderr, "  --iir f32|f64         biquad cascade in float or double instead of the STFT\n");
+    fprintf(stderr, "                        filter: sample by sample, zero latency, no lookahead\n");
+    fprintf(stderr, "  --complex-fft         use the full complex FFT instead of the real-input FFT\n");
+    fprintf(stderr, "  --fixed-point         filter in Q15/Q31 integer arithmetic, as the FPGA datapath\n");
+    fprintf(stderr, "                        does: 16-bit samples, power-of-two frames only\n");
+    fprintf(stderr, "  --batch               filter every .wav of a directory (or every path listed in\n");
+    fprintf(stderr, "                        a file) into output_dir, one file per worker at a time\n");
+    fprintf(stderr, "  --kernels NAME        force the DSP kernel set: scalar, sse2, avx2, avx512\n");
+    fprintf(stderr, "                        (default: the best this CPU supports)\n");
+    fprintf(stderr, "  --io mmap|uring|threads  how WAV files are read and written: mapped (default),\n");
+    fprintf(stderr, "                        or through io_uring or I/O threads, reading ahead and\n");
+    fprintf(stderr, "                        writing behind the filter (for network and spinning disks)\n");
+    fprintf(stderr, "  --pipe                filter raw interleaved PCM in real time, from stdin to\n");
+    fprintf(stderr, "                        stdout unless paths (e.g. FIFOs) are given\n");
+    fprintf(stderr, "  --rate HZ             pipe mode sample rate\n");
+    fprintf(stderr, "  --channels N          pipe mode channel count\n");
+    fprintf(stderr, "  --format s16|f32      pipe mode sample format (default s16)\n");
+    fprintf(stderr, "  --control FIFO        pipe mode: change the EQ while audio flows, one line per\n");
+    fprintf(stderr, "                        change (e.g. 'gain 1 -6', 'band 2 peaking 1000 3 1',\n");
+    fprintf(stderr, "                        'load FILE'; ';' joins commands); gains crossfade\n");
+    fprintf(stderr, "  --spectrum-cache FILE save the forward spectra to FILE, or, if it already holds\n");
+    fprintf(stderr, "                        them for this input and STFT configuration, reuse them so\n");
+    fprintf(stderr, "                        only the EQ, inverse FFT and overlap-add run\n");
+    fprintf(stderr, "  --cache-format f16|f32  spectrum cache values: half precision (default, half the\n");
+    fprintf(stderr, "                        size) or float (replays bit-exactly)\n");
+    fprintf(stderr, "  --stats               time every stage and print a JSON summary on stderr\n");
+    fprintf(stderr, "                        at exit\n");
+}
 
-#define FFT_SIZE 1024  // FFT size, should be a power of 2
+static void print_stats(void) {
+    stats_report(stderr);
+}
 
-// Function to load a WAV file
-float* load_wav(const char *inputFile, SNDFILE **infile, SF_INFO *sfinfo, sf_count_t *numSamples) {
-    if ((*infile = sf_open(inputFile, SFM_READ, sfinfo)) == NULL) {
-        fprintf(stderr, "Error: Could not open file '%s'\n", inputFile);
-        fprintf(stderr, "%s\n", sf_strerror(NULL));
-        return NULL;
+// Open a pipe-mode endpoint; "-" means stdin/stdout
+static int open_pipe_end(const char *path, int output) {
+    if (strcmp(path, "-") == 0) {
+        return output ? STDOUT_FILENO : STDIN_FILENO;
     }
-
-    *numSamples = sfinfo->frames * sfinfo->channels;
-    float *buffer = (float *)malloc(*numSamples * sizeof(float));
-    if (!buffer) {
-        fprintf(stderr, "Error: Could not allocate memory for buffer\n");
-        sf_close(*infile);
-        return NULL;
+    int fd = output ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open %s '%s'\n", output ? "output" : "input", path);
     }
+    return fd;
+}
 
-    sf_count_t samplesRead = sf_read_float(*infile, buffer, *numSamples);
-    if (samplesRead != *numSamples) {
-        fprintf(stderr, "Warning: Expected %lld samples but read %lld samples\n", (long long)*numSamples, (long long)samplesRead);
+// Value of an option that takes an argument; NULL (with a message) if missing
+static const char *option_value(int argc, char *argv[], int *argi) {
+    if (*argi + 1 >= argc) {
+        fprintf(stderr, "Error: Option '%s' needs a value\n", argv[*argi]);
+        return NULL;
     }
-
-    return buffer;
+    return argv[++*argi];
 }
 
-// Function to write the WAV file
-void write_wav_file(const char *outputFile, float *buffer, sf_count_t numSamples, int sampleRate, int channels) {
-    SF_INFO sfinfo;
-    sfinfo.samplerate = sampleRate;
-    sfinfo.channels = channels;
-    sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-
-    SNDFILE *outfile = sf_open(outputFile, SFM_WRITE, &sfinfo);
-    if (outfile == NULL) {
-        fprintf(stderr, "Error: Could not open output file '%s'\n", outputFile);
-        fprintf(stderr, "%s\n", sf_strerror(NULL));
-        return;
+int main(int argc, char *argv[]) {
+    filter_options opts;
+    filter_options_default(&opts);
+    int hopGiven = 0;
+    int threads = 0;
+    int batchMode = 0;
+    int pipeMode = 0;
+    int pipeRate = 0;
+    int pipeChannels = 0;
+    pcm_format pipeFormat = PCM_S16;
+    const char *controlPath = NULL;
+    const char *cachePath = NULL;
+    int cachePrecision = SPECTRUM_F16;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        const char *opt = argv[argi];
+        const char *value = NULL;
+        if (strcmp(opt, "--complex-fft") == 0) {
+            opts.useComplexFft = 1;
+        } else if (strcmp(opt, "--fixed-point") == 0) {
+            opts.fixedPoint = 1;
+        } else if (strcmp(opt, "--threads") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            threads = atoi(value);
+            if (threads < 1) {
+                fprintf(stderr, "Error: --threads needs a positive count\n");
+                return 1;
+            }
+        } else if (strcmp(opt, "--kernels") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (dsp_kernels_select(value) != 0) {
+                fprintf(stderr, "Error: Kernel set '%s' is unknown or not supported by this CPU\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--io") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (wav_io_select(value) != 0) {
+                fprintf(stderr, "Error: Unknown I/O mode '%s' (mmap, uring, threads)\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--stats") == 0) {
+            // Enabled before any filter or worker exists so every buffer is counted
+            if (!stats_enabled) {
+                stats_enable();
+                atexit(print_stats);
+            }
+        } else if (strcmp(opt, "--batch") == 0) {
+            batchMode = 1;
+        } else if (strcmp(opt, "--pipe") == 0) {
+            pipeMode = 1;
+        } else if (strcmp(opt, "--rate") == 0 || strcmp(opt, "--channels") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            int n = atoi(value);
+            if (n < 1) {
+                fprintf(stderr, "Error: Invalid value for %s: '%s'\n", opt, value);
+                return 1;
+            }
+            *(strcmp(opt, "--rate") == 0 ? &pipeRate : &pipeChannels) = n;
+        } else if (strcmp(opt, "--format") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (strcmp(value, "s16") == 0) {
+                pipeFormat = PCM_S16;
+            } else if (strcmp(value, "f32") == 0) {
+                pipeFormat = PCM_F32;
+            } else {
+                fprintf(stderr, "Error: Unknown sample format '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--control") == 0) {
+            if ((controlPath = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+        } else if (strcmp(opt, "--spectrum-cache") == 0) {
+            if ((cachePath = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+        } else if (strcmp(opt, "--cache-format") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (strcmp(value, "f16") == 0) {
+                cachePrecision = SPECTRUM_F16;
+            } else if (strcmp(value, "f32") == 0) {
+                cachePrecision = SPECTRUM_F32;
+            } else {
+                fprintf(stderr, "Error: Unknown spectrum cache format '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--eq") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL || eq_load_preset(value, &opts.eq) != 0) {
+                return 1;
+            }
+        } else if (strcmp(opt, "--low-latency") == 0) {
+            opts.lowLatency = 1;
+        } else if (strcmp(opt, "--iir") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (strcmp(value, "f32") == 0) {
+                opts.iir = 32;
+            } else if (strcmp(value, "f64") == 0) {
+                opts.iir = 64;
+            } else {
+                fprintf(stderr, "Error: Unknown IIR precision '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--block") == 0 || strcmp(opt, "--taps") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            int n = atoi(value);
+            if (strcmp(opt, "--block") == 0 ? (n < 2 || n % 2 != 0) : n < 1) {
+                fprintf(stderr, "Error: Invalid value for %s: '%s'\n", opt, value);
+                return 1;
+            }
+            *(strcmp(opt, "--block") == 0 ? &opts.blockSize : &opts.taps) = n;
+        } else if (strcmp(opt, "--frame") == 0 || strcmp(opt, "--hop") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            if (strcmp(opt, "--frame") == 0) {
+                opts.stft.frameSize = atoi(value);
+            } else {
+                opts.stft.hopSize = atoi(value);
+                hopGiven = 1;
+            }
+        } else if (strcmp(opt, "--window") == 0 || strcmp(opt, "--synthesis-window") == 0) {
+            if ((value = option_value(argc, argv, &argi)) == NULL) {
+                return 1;
+            }
+            window_type *type = strcmp(opt, "--window") == 0 ? &opts.stft.analysisWindow : &opts.stft.synthesisWindow;
+            if (stft_parse_window(value, type) != 0) {
+                fprintf(stderr, "Error: Unknown window '%s'\n", value);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[argi]);
+            usage(argv[0]);
+            return 1;
+        }
     }
-
-    sf_count_t written = sf_write_float(outfile, buffer, numSamples);
-    if (written != numSamples) {
-        fprintf(stderr, "Error: Could not write all samples to file (wrote %lld out of %lld)\n", (long long)written, (long long)numSamples);
+    if (pipeMode ? argc - argi > 2 : argc - argi != 2) {
+        usage(argv[0]);
+        return 1;
     }
+    const char *inputFile = argc - argi > 0 ? argv[argi] : "-";
+    const char *outputFile = argc - argi > 1 ? argv[argi + 1] : "-";
 
-    sf_close(outfile);
-}
-
-void apply_filter(float *buffer, sf_count_t numSamples, int sampleRate) {
-    // Total number of blocks (with 50% overlap)
-    int numBlocks = (numSamples + (FFT_SIZE / 2)) / (FFT_SIZE / 2);
-
-    // Allocate temporary buffer for FFT/IFFT processing
-    kiss_fft_cfg cfg = kiss_fft_alloc(FFT_SIZE, 0, NULL, NULL);
-    kiss_fft_cfg ifft_cfg = kiss_fft_alloc(FFT_SIZE, 1, NULL, NULL);
-
-    // Check if kiss_fft_alloc failed
-    if (cfg == NULL || ifft_cfg == NULL) {
-        fprintf(stderr, "Error: Failed to allocate FFT configuration.\n");
-        return;
+    if (!hopGiven) {
+        opts.stft.hopSize = opts.stft.frameSize / 2;
     }
-
-    kiss_fft_cpx *fft_input = (kiss_fft_cpx*) malloc(sizeof(kiss_fft_cpx) * FFT_SIZE);
-    kiss_fft_cpx *fft_output = (kiss_fft_cpx*) malloc(sizeof(kiss_fft_cpx) * FFT_SIZE);
-    kiss_fft_cpx *ifft_output = (kiss_fft_cpx*) malloc(sizeof(kiss_fft_cpx) * FFT_SIZE);
-
-    // Check if memory allocation failed
-    if (fft_input == NULL || fft_output == NULL || ifft_output == NULL) {
-        fprintf(stderr, "Error: Failed to allocate memory for FFT buffers.\n");
-        kiss_fft_free(cfg);
-        kiss_fft_free(ifft_cfg);
-        return;
+    const char *problem = stft_config_check(&opts.stft);
+    if (problem != NULL) {
+        fprintf(stderr, "Error: Invalid STFT configuration: %s\n", problem);
+        return 1;
     }
 
-    // Prepare overlap-add buffer (initialize with zeroes)
-    float *overlapBuffer = (float *)calloc(FFT_SIZE, sizeof(float));
-
-    // Process each block of data with overlap
-    for (int block = 0; block < numBlocks; block++) {
-        // Calculate the start of the current block
-        int start = block * (FFT_SIZE / 2);  // 50% overlap
-
-        // Ensure that the end of the block does not exceed the buffer length
-        int end = start + FFT_SIZE;
-        if (end > numSamples) {
-            end = numSamples;
-        }
-
-        // Zero-pad the current block if needed
-        for (int i = 0; i < FFT_SIZE; i++) {
-            if (i + start < numSamples) {
-                fft_input[i].r = buffer[i + start];  // Real part
-            } else {
-                fft_input[i].r = 0.0f;  // Zero padding
-            }
-            fft_input[i].i = 0.0f;  // Imaginary part
-        }
+    if (opts.fixedPoint && opts.lowLatency) {
+        fprintf(stderr, "Error: --fixed-point runs the STFT filter and cannot be combined with --low-latency\n");
+        return 1;
+    }
 
-        // Apply a Hamming window to the signal before FFT
-        for (int i = 0; i < FFT_SIZE; i++) {
-            float window = 0.54 - 0.46 * cos(2 * M_PI * i / (FFT_SIZE - 1));
-            fft_input[i].r *= window;
-        }
+    if (opts.iir && (opts.lowLatency || opts.fixedPoint || opts.useComplexFft)) {
+        fprintf(stderr, "Error: --iir replaces the FFT filters and cannot be combined with --low-latency, "
+                        "--fixed-point or --complex-fft\n");
+        return 1;
+    }
 
-        // Apply FFT to the block
-        kiss_fft(cfg, fft_input, fft_output);
+    if (controlPath != NULL && (!pipeMode || opts.iir || opts.lowLatency || opts.fixedPoint || opts.useComplexFft)) {
+        fprintf(stderr, "Error: --control works in pipe mode with the float real-FFT STFT filter\n");
+        return 1;
+    }
 
-        // Apply lowpass filter in the frequency domain (remove frequencies above 80Hz)
-        for (int i = 0; i < FFT_SIZE; i++) {
-            float freq = i * (float)sampleRate / FFT_SIZE;
-            if (freq < 500) {
-                fft_output[i].r = 0;
-                fft_output[i].i = 0;
-            }
-        }
+    if (cachePath != NULL && (batchMode || pipeMode || opts.iir || opts.lowLatency || opts.fixedPoint || opts.useComplexFft)) {
+        fprintf(stderr, "Error: --spectrum-cache works on single files with the float real-FFT STFT filter\n");
+        return 1;
+    }
 
-        // Apply IFFT to get the filtered time-domain signal
-        kiss_fft(ifft_cfg, fft_output, ifft_output);
+    if (batchMode) {
+        // Whole files are the unit of work, so every core gets its own file
+        int workers = threads > 0 ? threads : thread_pool_cpu_count();
+        thread_pool *pool = workers > 1 ? thread_pool_create(workers) : NULL;
+        int status = batch_filter(inputFile, outputFile, &opts, pool);
+        thread_pool_destroy(pool);
+        return status == 0 ? 0 : 1;
+    }
 
-        // Add the result to the overlap buffer and copy to the output
-        for (int i = 0; i < FFT_SIZE; i++) {
-            // Scale by FFT_SIZE to prevent clipping
-            overlapBuffer[i] += ifft_output[i].r / FFT_SIZE;
+    if (pipeMode) {
+        // Raw PCM carries no header, so the stream layout comes from the command line
+        if (pipeRate == 0 || pipeChannels == 0) {
+            fprintf(stderr, "Error: --pipe needs --rate and --channels\n");
+            return 1;
         }
-
-        // Copy the non-overlapping part to the original buffer
-        for (int i = 0; i < FFT_SIZE / 2; i++) {  // Overlap section
-            if (start + i < numSamples) {
-                buffer[start + i] = overlapBuffer[i];
-            }
+        int inFd = open_pipe_end(inputFile, 0);
+        int outFd = inFd < 0 ? -1 : open_pipe_end(outputFile, 1);
+        int status = inFd < 0 || outFd < 0 ? -1
+                   : pipe_filter(inFd, outFd, pipeRate, pipeChannels, pipeFormat, &opts, controlPath);
+        if (inFd > STDERR_FILENO) {
+            close(inFd);
         }
-
-        // Copy the remaining part to the buffer
-        for (int i = FFT_SIZE / 2; i < (end - start); i++) {
-            if (start + i < numSamples) {
-                buffer[start + i] = overlapBuffer[i];
-            }
+        if (outFd > STDERR_FILENO) {
+            close(outFd);
         }
-
-        // Update the overlap buffer (shift the previous part)
-        memmove(overlapBuffer, overlapBuffer + FFT_SIZE / 2, (FFT_SIZE / 2) * sizeof(float));
-        memset(overlapBuffer + (FFT_SIZE / 2), 0, (FFT_SIZE / 2) * sizeof(float));
+        return status == 0 ? 0 : 1;
     }
 
-    // Clean up
-    free(fft_input);
-    free(fft_output);
-    free(ifft_output);
-    free(overlapBuffer);
-    kiss_fft_free(cfg);
-    kiss_fft_free(ifft_cfg);
-}
-
-
-
-
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Usage: %s <input_file.wav> <output_file.wav>\n", argv[0]);
+    wav_reader in;
+    if (wav_reader_open(&in, inputFile) != 0) {
         return 1;
     }
-    const char *inputFile = argv[1];
-    const char *outputFile = argv[2];
-
-    SNDFILE *infile = NULL;
-    SF_INFO sfinfo = {0};
-    sf_count_t numSamples = 0;
+    SF_INFO sfinfo = in.info;
 
-    // Load the WAV file
-    float *buffer = load_wav(inputFile, &infile, &sfinfo, &numSamples);
-    if (buffer != NULL) {
-        // Apply the lowpass filter
-        // printf("%d", sfinfo.samplerate);
-        apply_filter(buffer, numSamples, sfinfo.samplerate);
+    wav_writer out;
+    if (wav_writer_open(&out, outputFile, sfinfo.samplerate, sfinfo.channels, sfinfo.frames, &in) != 0) {
+        wav_reader_close(&in);
+        return 1;
+    }
 
-        // Write the filtered buffer to a new WAV file
-        write_wav_file(outputFile, buffer, numSamples, sfinfo.samplerate, sfinfo.channels);
+    // With --threads, split a seekable file into segments and keep every
+    // worker busy; otherwise channels are independent, so filter them concurrently
+    int segmented = threads > 1 && sfinfo.seekable && sfinfo.frames > 0 && !opts.lowLatency && !opts.iir && cachePath == NULL;
+    int workers = threads > 0 ? threads : thread_pool_cpu_count();
+    if (!segmented && workers > sfinfo.channels) {
+        workers = sfinfo.channels;
+    }
+    thread_pool *pool = workers > 1 ? thread_pool_create(workers) : NULL;
+    if (threads > 1 && !segmented) {
+        fprintf(stderr, "Warning: %s; filtering channels in parallel only\n",
+                opts.lowLatency ? "Low-latency mode runs as one stream"
+                : opts.iir ? "The IIR cascade runs as one stream"
+                : cachePath != NULL ? "The spectrum cache runs as one stream" : "Input is not seekable");
+    }
 
-        free(buffer);
+    int status;
+    if (segmented && pool != NULL) {
+        status = segment_filter(inputFile, &sfinfo, &out, &opts, pool);
+    } else if (cachePath != NULL) {
+        status = cache_filter(inputFile, &in, &out, &opts, cachePath, cachePrecision, pool);
+    } else {
+        // Stream the file through the filter chunk by chunk
+        status = stream_filter(&in, &out, &opts, pool);
     }
 
-    if (infile) {
-        sf_close(infile);
+    thread_pool_destroy(pool);
+
+    if (wav_writer_close(&out) != 0) {
+        status = -1;
     }
+    wav_reader_close(&in);
 
-    return 0;
+    return status == 0 ? 0 : 1;
 }
@@ -0,0 +1,52 @@
+#ifndef WAV_PROCESSOR_H
+#define WAV_PROCESSOR_H
+
+#include <sndfile.h>
+#include "wav_io.h"
+#include "channel_job.h"
+#include "eq_engine.h"
+
+// Hands engine output to a wav_writer (ctx); an eq_engine_sink
+int wav_writer_sink(void *ctx, const float *const *planes, int frames);
+
+// Filter in into out chunk by chunk; channels run on pool if non-NULL
+int stream_filter(wav_reader *in, wav_writer *out, const filter_options *opts, thread_pool *pool);
+
+// stream_filter on a caller-owned engine, fresh or reset, built for in's
+// sample rate and channel count
+int stream_filter_engine(wav_reader *in, wav_writer *out, eq_engine *e);
+
+// Filter a seekable file by splitting it into segments that run on every
+// worker of pool. Output is identical to stream_filter.
+int segment_filter(const char *inputFile, const SF_INFO *sfinfo, wav_writer *out, const filter_options *opts, thread_pool *pool);
+
+// Filter every input (the .wav files of a directory, or one path per line of
+// a list file) into outputDir on the pool. Each worker keeps its filters for
+// the whole run. Prints files/s and the realtime factor on stderr.
+int batch_filter(const char *input, const char *outputDir, const filter_options *opts, thread_pool *pool);
+
+// stream_filter with a spectrum cache (spectrum_cache.h) at cachePath. If it
+// holds the spectra of this input and STFT configuration they are replayed
+// and the input is never decoded; otherwise the file is filtered as usual
+// and its spectra saved, with precision bits (16 or 32) per value.
+int cache_filter(const char *inputFile, wav_reader *in, wav_writer *out, const filter_options *opts,
+                 const char *cachePath, int precision, thread_pool *pool);
+
+// Raw sample formats accepted by the pipe mode (native byte order)
+typedef enum {
+    PCM_S16,
+    PCM_F32
+} pcm_format;
+
+// Filter raw interleaved PCM from inFd to outFd in real time. A reader, a
+// DSP and a writer thread are joined by lock-free single-producer/single-
+// consumer rings, so a slow stage never blocks the others on a lock. The
+// latency bound, the reader's backpressure waits and the writer's underruns
+// (times a sink playing the output at sampleRate would have run dry; input
+// that arrives faster than real time has none) are reported on stderr.
+// With controlPath the EQ follows the commands written to that FIFO
+// (eq_live.h) while the stream runs; NULL keeps it fixed.
+int pipe_filter(int inFd, int outFd, int sampleRate, int channels, pcm_format format, const filter_options *opts,
+                const char *controlPath);
+
+#endif